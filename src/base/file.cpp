@@ -45,6 +45,12 @@ HANDLE OpenFileForGenericWrite(const std::wstring& path) {
                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
 }
 
+HANDLE OpenFileForAppend(const std::wstring& path) {
+  return ::CreateFile(GetExtendedLengthPath(path).c_str(),
+                      FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+                      OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 unsigned long GetFileAge(const std::wstring& path) {
@@ -457,6 +463,66 @@ bool SaveToFile(const std::string& data, const std::wstring& path,
                     path, take_backup);
 }
 
+bool AppendToFile(const std::string& data, const std::wstring& path) {
+  if (data.empty())
+    return false;
+
+  CreateFolder(GetPathOnly(path));
+
+  BOOL result = FALSE;
+  Handle file_handle{OpenFileForAppend(path)};
+  if (file_handle.get() != INVALID_HANDLE_VALUE) {
+    DWORD bytes_written = 0;
+    result = ::WriteFile(file_handle.get(), data.data(),
+                         static_cast<DWORD>(data.size()), &bytes_written,
+                         nullptr);
+  }
+
+  return result != FALSE;
+}
+
+bool SaveChunksToFile(const std::vector<std::string_view>& chunks,
+                      const std::wstring& path) {
+  size_t index = 0;
+  return SaveChunksToFile(
+      [&](std::string_view& chunk) {
+        if (index == chunks.size())
+          return false;
+        chunk = chunks[index++];
+        return true;
+      },
+      path);
+}
+
+bool SaveChunksToFile(const ChunkProvider& next_chunk,
+                      const std::wstring& path) {
+  CreateFolder(GetPathOnly(path));
+
+  // Chunks are written to a temporary file first, so that an interrupted write
+  // cannot leave us with a truncated file.
+  const std::wstring temp_path = path + L".tmp";
+
+  {
+    Handle file_handle{OpenFileForGenericWrite(temp_path)};
+    if (file_handle.get() == INVALID_HANDLE_VALUE)
+      return false;
+
+    std::string_view chunk;
+    while (next_chunk(chunk)) {
+      DWORD bytes_written = 0;
+      if (!::WriteFile(file_handle.get(), chunk.data(),
+                       static_cast<DWORD>(chunk.size()), &bytes_written,
+                       nullptr)) {
+        return false;
+      }
+    }
+  }
+
+  return ::MoveFileEx(temp_path.c_str(), path.c_str(),
+                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) !=
+         FALSE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 enum Unit : UINT64 {
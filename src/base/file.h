@@ -18,7 +18,9 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <windows.h>
@@ -65,6 +67,15 @@ bool SaveToFile(LPCVOID data, DWORD length, const std::wstring& path,
                 bool take_backup = false);
 bool SaveToFile(const std::string& data, const std::wstring& path,
                 bool take_backup = false);
+bool AppendToFile(const std::string& data, const std::wstring& path);
+bool SaveChunksToFile(const std::vector<std::string_view>& chunks,
+                      const std::wstring& path);
+
+// Called repeatedly for the next chunk to write, until it returns false. The
+// chunk only needs to remain valid until the next call.
+using ChunkProvider = std::function<bool(std::string_view& chunk)>;
+bool SaveChunksToFile(const ChunkProvider& next_chunk,
+                      const std::wstring& path);
 
 UINT64 ParseSizeString(std::wstring value);
 std::wstring ToSizeString(const UINT64 size);
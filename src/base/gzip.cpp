@@ -22,38 +22,66 @@
 
 #include "base/gzip.h"
 
-bool UncompressGzippedString(const std::string& input, std::string& output) {
-  z_stream stream;
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.opaque = NULL;
-  stream.total_out = 0;
-  stream.next_in = (BYTE*)&input[0];
-  stream.avail_in = (uInt)input.length();
-
-  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+GzipInflater::GzipInflater() : stream_{std::make_unique<z_stream>()} {
+  stream_->zalloc = Z_NULL;
+  stream_->zfree = Z_NULL;
+  stream_->opaque = Z_NULL;
+  stream_->next_in = Z_NULL;
+  stream_->avail_in = 0;
+
+  // Adding 32 to window bits enables automatic gzip/zlib header detection
+  if (inflateInit2(stream_.get(), MAX_WBITS + 32) != Z_OK)
+    failed_ = true;
+}
+
+GzipInflater::~GzipInflater() {
+  if (!failed_)
+    inflateEnd(stream_.get());
+}
+
+bool GzipInflater::Write(std::string_view input, std::string& output) {
+  if (failed_)
     return false;
+  if (finished_ || input.empty())
+    return true;
 
-  size_t buffer_length = input.length() * 2;
-  char* buffer = (char*)GlobalAlloc(GMEM_ZEROINIT, buffer_length);
+  stream_->next_in = (Bytef*)input.data();
+  stream_->avail_in = (uInt)input.size();
 
-  size_t total_length = 0;
-  int status = Z_OK;
+  char buffer[16384];
 
   do {
-    stream.next_out = (BYTE*)buffer;
-    stream.avail_out = (uInt)buffer_length;
-    status = inflate(&stream, Z_SYNC_FLUSH);
-    if (status == Z_OK || status == Z_STREAM_END) {
-      output.append(buffer, stream.total_out - total_length);
-      total_length = stream.total_out;
+    stream_->next_out = (Bytef*)buffer;
+    stream_->avail_out = (uInt)sizeof(buffer);
+
+    const int status = inflate(stream_.get(), Z_NO_FLUSH);
+
+    switch (status) {
+      case Z_STREAM_END:
+        finished_ = true;
+        [[fallthrough]];
+      case Z_OK:
+      case Z_BUF_ERROR:  // no progress is possible until more input arrives
+        output.append(buffer, sizeof(buffer) - stream_->avail_out);
+        break;
+      default:
+        inflateEnd(stream_.get());
+        failed_ = true;
+        return false;
     }
-  } while (status == Z_OK);
+  } while (!finished_ &&
+           (stream_->avail_in > 0 || stream_->avail_out == 0));
 
-  GlobalFree(buffer);
-  inflateEnd(&stream);
+  return true;
+}
+
+bool GzipInflater::finished() const {
+  return finished_;
+}
 
-  return status == Z_STREAM_END;
+bool UncompressGzippedString(const std::string& input, std::string& output) {
+  GzipInflater inflater;
+  return inflater.Write(input, output) && inflater.finished();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
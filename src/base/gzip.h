@@ -18,7 +18,28 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
+
+struct z_stream_s;
+
+// Decompresses gzip or zlib data incrementally, as it arrives
+class GzipInflater final {
+public:
+  GzipInflater();
+  ~GzipInflater();
+
+  // Appends the decompressed data to the output
+  bool Write(std::string_view input, std::string& output);
+
+  bool finished() const;
+
+private:
+  std::unique_ptr<z_stream_s> stream_;
+  bool failed_ = false;
+  bool finished_ = false;
+};
 
 bool UncompressGzippedString(const std::string& input, std::string& output);
 
@@ -17,17 +17,21 @@
  */
 
 #include <algorithm>
-#include <functional>
+#include <array>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 
 #include "base/html.h"
 
 #include "base/string.h"
 
+struct HtmlEntity {
+  std::wstring_view name;
+  wchar_t value;
+};
+
 // Source: https://www.w3.org/TR/html4/sgml/entities.html
-static const std::unordered_map<std::wstring_view, wchar_t> html_entities{
+static constexpr HtmlEntity html_entity_list[] = {
   //////////////////////////////////////////////////////////////////////////////
   // ISO 8859-1 characters
 
@@ -317,63 +321,161 @@ static const std::unordered_map<std::wstring_view, wchar_t> html_entities{
   {L"euro",     L'\u20AC'},
 };
 
-void DecodeHtmlEntities(std::wstring& str) {
+// Entities are sorted at compile time, and indexed by their first character.
+// A lookup is a binary search within a handful of entries, without hashing.
+static constexpr auto html_entities = [] {
+  std::array<HtmlEntity, std::size(html_entity_list)> entities{};
+  std::ranges::copy(html_entity_list, entities.begin());
+  std::ranges::sort(entities, {}, &HtmlEntity::name);
+  return entities;
+}();
+
+static constexpr auto html_entity_index = [] {
+  std::array<std::pair<size_t, size_t>, 128> index{};
+  for (size_t i = 0; i < html_entities.size(); ++i) {
+    auto& [begin, end] = index[html_entities[i].name.front()];
+    if (begin == end)
+      begin = i;
+    end = i + 1;
+  }
+  return index;
+}();
+
+static bool FindHtmlEntity(const std::wstring_view name, wchar_t& value) {
   constexpr size_t kMinEntityLength = 2;
   constexpr size_t kMaxEntityLength = 8;
 
-  const auto peek = [&str](const size_t pos) {
-    return pos < str.size() ? str[pos] : L'\0';
-  };
+  if (name.size() < kMinEntityLength || name.size() > kMaxEntityLength)
+    return false;
+  if (static_cast<size_t>(name.front()) >= html_entity_index.size())
+    return false;
+
+  const auto [begin, end] = html_entity_index[name.front()];
+  const auto first = html_entities.begin() + begin;
+  const auto last = html_entities.begin() + end;
+  const auto it = std::lower_bound(first, last, name,
+      [](const HtmlEntity& entity, const std::wstring_view name) {
+        return entity.name < name;
+      });
+
+  if (it == last || it->name != name)
+    return false;
+
+  value = it->value;
+  return true;
+}
+
+// Decodes the entity that starts at `pos` (i.e. the position of '&'). On
+// success, the decoded characters are written to `output` and the position of
+// the terminating ';' is returned.
+static size_t DecodeHtmlEntity(const std::wstring_view str, const size_t pos,
+                               wchar_t (&output)[2], size_t& output_length) {
+  constexpr size_t kMaxEntityLength = 10;
+
+  const auto semicolon = str.find(L';', pos + 1);
+  if (semicolon == str.npos || semicolon - pos > kMaxEntityLength)
+    return str.npos;
 
-  using predicate_t = std::function<bool(const wchar_t)>;
-  const auto read = [&str](const size_t pos, predicate_t pred) {
-    const auto it = std::find_if_not(str.begin() + pos, str.end(), pred);
-    if (it != str.end() && *it == L';') {
-      const auto count = std::distance(str.begin() + pos, it);
-      return std::wstring_view(str.data() + pos, count);
+  auto name = str.substr(pos + 1, semicolon - pos - 1);
+
+  if (name.size() > 1 && name.front() == L'#') {
+    name.remove_prefix(1);
+    int base = 10;
+    if (name.front() == L'x' || name.front() == L'X') {
+      name.remove_prefix(1);
+      base = 16;
     }
-    return std::wstring_view{};
-  };
-  
-  size_t pos = str.find(L'&');
-  for (; pos != str.npos; pos = str.find(L'&', ++pos)) {
-    if (peek(pos + 1) == L'#') {
-      if (peek(pos + 2) == L'x') {
-        if (const auto view = read(pos + 3, IsHexadecimalChar); !view.empty()) {
-          const auto c = static_cast<wchar_t>(wcstoul(view.data(), nullptr, 16));
-          str.replace(pos, 3 + view.size() + 1, 1, c);  // &#x26;
-        }
-      } else {
-        if (const auto view = read(pos + 2, IsNumericChar); !view.empty()) {
-          const auto c = static_cast<wchar_t>(ToInt(std::wstring{view}));
-          str.replace(pos, 2 + view.size() + 1, 1, c);  // &#38;
-        }
-      }
+    if (name.empty())
+      return str.npos;
+
+    const auto is_valid_char = base == 16 ? IsHexadecimalChar : IsNumericChar;
+    if (!std::all_of(name.begin(), name.end(), is_valid_char))
+      return str.npos;
+
+    uint32_t code_point = 0;
+    for (const auto c : name) {
+      const uint32_t digit = IsNumericChar(c) ? c - L'0' : (c | 0x20) - L'a' + 10;
+      code_point = code_point * base + digit;
+      if (code_point >= 0x110000)
+        return str.npos;
+    }
+
+    if (code_point >= 0x10000) {
+      output[0] = static_cast<wchar_t>(0xD800 + ((code_point - 0x10000) >> 10));
+      output[1] = static_cast<wchar_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+      output_length = 2;
     } else {
-      const auto view = read(pos + 1, IsAlphanumericChar);
-      if (kMinEntityLength <= view.size() && view.size() <= kMaxEntityLength) {
-        const auto it = html_entities.find(view);
-        if (it != html_entities.end()) {
-          str.replace(pos, 1 + view.size() + 1, 1, it->second);  // &amp;
-        }
-      }
+      output[0] = static_cast<wchar_t>(code_point);
+      output_length = 1;
     }
+    return semicolon;
   }
+
+  if (!std::all_of(name.begin(), name.end(), IsAlphanumericChar))
+    return str.npos;
+  if (!FindHtmlEntity(name, output[0]))
+    return str.npos;
+
+  output_length = 1;
+  return semicolon;
 }
 
-void StripHtmlTags(std::wstring& str) {
-  int index_begin = -1;
-  int index_end = -1;
-
-  do {
-    index_begin = InStr(str, L"<", 0);
-    if (index_begin > -1) {
-      index_end = InStr(str, L">", index_begin);
-      if (index_end > -1) {
-        str.erase(index_begin, index_end - index_begin + 1);
-      } else {
-        break;
+// Rewrites the string in place in a single pass. Decoded entities are never
+// longer than their source text, so the write position never overtakes the
+// read position.
+static void ProcessHtml(std::wstring& str, bool decode_entities,
+                        bool strip_tags) {
+  size_t write_pos = 0;
+  size_t tag_pos = str.npos;
+
+  const auto put = [&](const wchar_t c) {
+    if (strip_tags) {
+      if (c == L'<' && tag_pos == str.npos) {
+        tag_pos = write_pos;
+      } else if (c == L'>' && tag_pos != str.npos) {
+        write_pos = tag_pos;
+        tag_pos = str.npos;
+        return;
       }
     }
-  } while (index_begin > -1);
+    str[write_pos++] = c;
+  };
+
+  for (size_t read_pos = 0; read_pos < str.size(); ++read_pos) {
+    const wchar_t c = str[read_pos];
+    if (decode_entities && c == L'&') {
+      wchar_t output[2];
+      size_t output_length = 0;
+      const auto end = DecodeHtmlEntity(str, read_pos, output, output_length);
+      if (end != str.npos) {
+        for (size_t i = 0; i < output_length; ++i)
+          put(output[i]);
+        read_pos = end;
+        continue;
+      }
+    }
+    put(c);
+  }
+
+  // An unterminated tag is kept as is, because the characters were written
+  // regardless.
+  str.resize(write_pos);
+}
+
+void DecodeHtmlEntities(std::wstring& str) {
+  if (str.find(L'&') == str.npos)
+    return;
+  ProcessHtml(str, true, false);
+}
+
+void StripHtmlTags(std::wstring& str) {
+  if (str.find(L'<') == str.npos)
+    return;
+  ProcessHtml(str, false, true);
+}
+
+void DecodeHtmlEntitiesAndStripTags(std::wstring& str) {
+  if (str.find_first_of(L"&<") == str.npos)
+    return;
+  ProcessHtml(str, true, true);
 }
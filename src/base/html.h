@@ -22,3 +22,6 @@
 
 void DecodeHtmlEntities(std::wstring& str);
 void StripHtmlTags(std::wstring& str);
+
+// Equivalent to DecodeHtmlEntities followed by StripHtmlTags, in a single pass
+void DecodeHtmlEntitiesAndStripTags(std::wstring& str);
@@ -29,6 +29,16 @@ bool JsonParseString(const std::string& str, Json& output) {
   }
 }
 
+bool JsonParseString(const std::string& str, Json& output,
+                     const JsonParseCallback& callback) {
+  try {
+    output = Json::parse(str.begin(), str.end(), callback);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool JsonReadBool(const Json& json, const std::string& key) {
@@ -24,7 +24,13 @@
 
 using Json = nlohmann::json;
 
+// Called for each parse event. Returning false discards the element, which
+// allows processing large documents without keeping them in memory.
+using JsonParseCallback = Json::parser_callback_t;
+
 bool JsonParseString(const std::string& str, Json& output);
+bool JsonParseString(const std::string& str, Json& output,
+                     const JsonParseCallback& callback);
 
 bool JsonReadBool(const Json& json, const std::string& key);
 double JsonReadDouble(const Json& json, const std::string& key);
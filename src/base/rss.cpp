@@ -16,81 +16,419 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+
+#include <algorithm>
+#include <charconv>
+
 #include "base/rss.h"
 
 #include "base/html.h"
 #include "base/string.h"
-#include "base/xml.h"
 
 namespace rss {
 
-Channel ParseChannel(const XmlNode& node) {
-  Channel channel;
+constexpr std::string_view kWhitespace = " \t\r\n";
+
+static std::string_view TrimView(std::string_view str) {
+  const auto begin = str.find_first_not_of(kWhitespace);
+  if (begin == str.npos)
+    return {};
+  const auto end = str.find_last_not_of(kWhitespace);
+  return str.substr(begin, end - begin + 1);
+}
+
+static void AssignUtf8(std::wstring& output, std::string_view input) {
+  input = TrimView(input);
+  output.clear();
 
-  channel.title = node.child_value(L"title");
-  channel.link = node.child_value(L"link");
-  channel.description = node.child_value(L"description");
+  if (input.empty())
+    return;
 
-  return channel;
+  const auto input_length = static_cast<int>(input.size());
+  const int length = MultiByteToWideChar(CP_UTF8, 0, input.data(),
+                                         input_length, nullptr, 0);
+  if (length > 0) {
+    output.resize(length);
+    MultiByteToWideChar(CP_UTF8, 0, input.data(), input_length,
+                        output.data(), length);
+  }
 }
 
-Item ParseItem(const XmlNode& node) {
-  Item item;
+// Titles and descriptions often contain HTML that was escaped once more for
+// XML, which leaves HTML entities behind after XML entities are decoded.
+static void AssignDecodedUtf8(std::wstring& output, std::string_view input) {
+  AssignUtf8(output, input);
+  DecodeHtmlEntities(output);
+}
 
-  item.title = node.child_value(L"title");
-  item.link = node.child_value(L"link");
-  item.description = node.child_value(L"description");
-  item.author = node.child_value(L"author");
-  item.comments = node.child_value(L"comments");
-  item.pub_date = node.child_value(L"pubDate");
+static void AppendUtf8(std::string& output, const uint32_t code_point) {
+  if (code_point < 0x80) {
+    output.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x110000) {
+    output.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
 
-  if (const auto category_node = node.child(L"category")) {
-    item.category.domain = category_node.attribute(L"domain").as_string();
-    item.category.value = category_node.child_value();
+static bool DecodeXmlEntity(std::string& output, std::string_view name) {
+  if (name == "amp") {
+    output.push_back('&');
+  } else if (name == "lt") {
+    output.push_back('<');
+  } else if (name == "gt") {
+    output.push_back('>');
+  } else if (name == "quot") {
+    output.push_back('"');
+  } else if (name == "apos") {
+    output.push_back('\'');
+  } else if (name.size() > 1 && name.front() == '#') {
+    name.remove_prefix(1);
+    int base = 10;
+    if (name.front() == 'x' || name.front() == 'X') {
+      name.remove_prefix(1);
+      base = 16;
+    }
+    uint32_t code_point = 0;
+    const auto [ptr, ec] = std::from_chars(
+        name.data(), name.data() + name.size(), code_point, base);
+    if (ec != std::errc{} || ptr != name.data() + name.size())
+      return false;
+    AppendUtf8(output, code_point);
+  } else {
+    return false;
   }
 
-  if (const auto enclosure_node = node.child(L"enclosure")) {
-    item.enclosure.url = enclosure_node.attribute(L"url").as_string();
-    item.enclosure.length = enclosure_node.attribute(L"length").as_string();
-    item.enclosure.type = enclosure_node.attribute(L"type").as_string();
+  return true;
+}
+
+// Appends character data, decoding XML entities on the way. Unknown entities
+// are kept as is.
+static void AppendText(std::string& output, std::string_view text) {
+  constexpr size_t kMaxEntityLength = 10;
+
+  size_t pos = 0;
+
+  while (pos < text.size()) {
+    const auto amp = text.find('&', pos);
+    output.append(text.substr(pos, amp - pos));
+    if (amp == text.npos)
+      break;
+
+    const auto semicolon = text.find(';', amp);
+    if (semicolon == text.npos || semicolon - amp > kMaxEntityLength) {
+      output.push_back('&');
+      pos = amp + 1;
+      continue;
+    }
+
+    const auto name = text.substr(amp + 1, semicolon - amp - 1);
+    if (!DecodeXmlEntity(output, name))
+      output.append(text.substr(amp, semicolon - amp + 1));
+    pos = semicolon + 1;
   }
+}
+
+// Finds the closing bracket of a tag, skipping over quoted attribute values.
+static size_t FindTagEnd(std::string_view data, size_t pos) {
+  char quote = '\0';
+
+  for (; pos < data.size(); ++pos) {
+    const char c = data[pos];
+    if (quote) {
+      if (c == quote)
+        quote = '\0';
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    } else if (c == '>') {
+      return pos;
+    }
+  }
+
+  return data.npos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::wstring* Item::namespace_element(std::wstring_view name) const {
+  for (const auto& [key, value] : namespace_elements) {
+    if (key == name)
+      return &value;
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const Channel& Reader::channel() const {
+  return channel_;
+}
+
+bool Reader::Parse(std::string_view data) {
+  channel_ = {};
+  item_ = nullptr;
+  item_depth_ = 0;
+  path_.clear();
+  text_.clear();
+
+  constexpr std::string_view kByteOrderMark = "\xEF\xBB\xBF";
+  constexpr std::string_view kCdataBegin = "<![CDATA[";
+  constexpr std::string_view kCdataEnd = "]]>";
+  constexpr std::string_view kCommentBegin = "<!--";
+  constexpr std::string_view kCommentEnd = "-->";
+  constexpr std::string_view kDeclarationBegin = "<?";
+  constexpr std::string_view kDeclarationEnd = "?>";
+
+  size_t pos = 0;
+  bool has_root = false;
+  Attributes attributes;
+
+  if (data.substr(0, kByteOrderMark.size()) == kByteOrderMark)
+    pos = kByteOrderMark.size();
+
+  const auto skip_until = [&](size_t begin, std::string_view str) {
+    const auto end = data.find(str, begin);
+    if (end == data.npos)
+      return false;
+    pos = end + str.size();
+    return true;
+  };
+
+  while (pos < data.size()) {
+    const auto lt = data.find('<', pos);
+    if (lt == data.npos)
+      break;
+
+    if (lt > pos)
+      AppendText(text_, data.substr(pos, lt - pos));
 
-  if (const auto guid_node = node.child(L"guid")) {
-    item.guid.is_permalink = guid_node.attribute(L"isPermaLink").as_bool(true);
-    item.guid.value = guid_node.child_value();
+    const auto tag = data.substr(lt);
+
+    if (tag.substr(0, kCdataBegin.size()) == kCdataBegin) {
+      const auto begin = lt + kCdataBegin.size();
+      const auto end = data.find(kCdataEnd, begin);
+      if (end == data.npos)
+        return false;
+      text_.append(data.substr(begin, end - begin));
+      pos = end + kCdataEnd.size();
+      continue;
+    }
+    if (tag.substr(0, kCommentBegin.size()) == kCommentBegin) {
+      if (!skip_until(lt + kCommentBegin.size(), kCommentEnd))
+        return false;
+      continue;
+    }
+    if (tag.substr(0, kDeclarationBegin.size()) == kDeclarationBegin) {
+      if (!skip_until(lt + kDeclarationBegin.size(), kDeclarationEnd))
+        return false;
+      continue;
+    }
+
+    const auto gt = FindTagEnd(data, lt + 1);
+    if (gt == data.npos)
+      return false;
+    pos = gt + 1;
+
+    auto content = data.substr(lt + 1, gt - lt - 1);
+    if (content.empty())
+      return false;
+
+    // DOCTYPE and other markup declarations
+    if (content.front() == '!')
+      continue;
+
+    // End tag
+    if (content.front() == '/') {
+      const auto name = TrimView(content.substr(1));
+      if (path_.empty() || path_.back() != name)
+        return false;
+      path_.pop_back();
+      OnEndElement(name);
+      text_.clear();
+      continue;
+    }
+
+    // Start tag
+    const bool self_closing = content.back() == '/';
+    if (self_closing)
+      content.remove_suffix(1);
+
+    const auto name_end = std::min(content.find_first_of(kWhitespace),
+                                   content.size());
+    const auto name = content.substr(0, name_end);
+    if (name.empty())
+      return false;
+
+    attributes.clear();
+    for (auto rest = content.substr(name_end);;) {
+      const auto eq = rest.find('=');
+      if (eq == rest.npos)
+        break;
+      const auto quote_begin = rest.find_first_of("\"'", eq);
+      if (quote_begin == rest.npos)
+        return false;
+      const auto quote_end = rest.find(rest[quote_begin], quote_begin + 1);
+      if (quote_end == rest.npos)
+        return false;
+      attributes.emplace_back(
+          TrimView(rest.substr(0, eq)),
+          rest.substr(quote_begin + 1, quote_end - quote_begin - 1));
+      rest = rest.substr(quote_end + 1);
+    }
+
+    has_root = true;
+    text_.clear();
+    OnStartElement(name, attributes);
+
+    if (self_closing) {
+      OnEndElement(name);
+    } else {
+      path_.push_back(name);
+    }
   }
 
-  for (const auto& element : node.children()) {
-    if (InStr(element.name(), L":") > -1) {
-      item.namespace_elements[element.name()] = element.child_value();
+  return has_root && path_.empty();
+}
+
+std::wstring Reader::attribute(const Attributes& attributes,
+                               std::string_view name) {
+  std::wstring value;
+
+  for (const auto& [key, raw_value] : attributes) {
+    if (key == name) {
+      buffer_.clear();
+      AppendText(buffer_, raw_value);
+      AssignUtf8(value, buffer_);
+      break;
     }
   }
 
-  return item;
+  return value;
 }
 
-Feed ParseDocument(const XmlDocument& document) {
-  Feed feed;
+void Reader::OnStartElement(std::string_view name,
+                            const Attributes& attributes) {
+  const size_t depth = path_.size();
+
+  if (!item_) {
+    if (name == "item" || name == "entry") {
+      item_ = &OnItemBegin();
+      item_depth_ = depth;
+    } else if (name == "link" && !path_.empty() && path_.back() == "feed") {
+      const auto rel = attribute(attributes, "rel");
+      if (rel.empty() || rel == L"alternate")
+        channel_.link = attribute(attributes, "href");
+    }
+    return;
+  }
 
-  const auto channel_node = document.child(L"rss").child(L"channel");
+  if (depth != item_depth_ + 1)
+    return;
 
-  feed.channel = ParseChannel(channel_node);
+  if (name == "category") {
+    item_->category.domain = attribute(attributes, "domain");
+  } else if (name == "enclosure") {
+    item_->enclosure.url = attribute(attributes, "url");
+    item_->enclosure.length = attribute(attributes, "length");
+    item_->enclosure.type = attribute(attributes, "type");
+  } else if (name == "guid") {
+    const auto is_permalink = attribute(attributes, "isPermaLink");
+    item_->guid.is_permalink = is_permalink.empty() || ToBool(is_permalink);
+  } else if (name == "link") {
+    // Atom links are empty elements with attributes
+    const auto href = attribute(attributes, "href");
+    if (!href.empty()) {
+      const auto rel = attribute(attributes, "rel");
+      if (rel == L"enclosure") {
+        item_->enclosure.url = href;
+        item_->enclosure.length = attribute(attributes, "length");
+        item_->enclosure.type = attribute(attributes, "type");
+      } else if (rel.empty() || rel == L"alternate") {
+        item_->link = href;
+      }
+    }
+  }
+}
 
-  for (auto node : channel_node.children(L"item")) {
-    auto item = ParseItem(node);
+void Reader::OnEndElement(std::string_view name) {
+  const size_t depth = path_.size();
 
+  if (!item_) {
+    if (path_.empty())
+      return;
+    const auto parent = path_.back();
+    if (parent != "channel" && parent != "feed")
+      return;
+    if (name == "title") {
+      AssignUtf8(channel_.title, text_);
+    } else if (name == "link" && parent == "channel") {
+      AssignUtf8(channel_.link, text_);
+    } else if (name == "description" || name == "subtitle") {
+      AssignUtf8(channel_.description, text_);
+    }
+    return;
+  }
+
+  auto& item = *item_;
+
+  if (depth == item_depth_) {
     // All elements of an item are optional, however at least one of title or
     // description must be present.
-    if (item.title.empty() && item.description.empty())
-      continue;
-
-    DecodeHtmlEntities(item.title);
-    DecodeHtmlEntities(item.description);
+    const bool valid = !item.title.empty() || !item.description.empty();
+    item_ = nullptr;
+    OnItemEnd(item, valid);
+    return;
+  }
 
-    feed.items.push_back(item);
+  // Atom: <author><name>...</name></author>
+  if (depth == item_depth_ + 2 && name == "name" && path_.back() == "author") {
+    AssignUtf8(item.author, text_);
+    return;
   }
 
-  return feed;
+  if (depth != item_depth_ + 1)
+    return;
+
+  if (name == "title") {
+    AssignDecodedUtf8(item.title, text_);
+  } else if (name == "link") {
+    if (!TrimView(text_).empty())
+      AssignUtf8(item.link, text_);
+  } else if (name == "description" || name == "summary") {
+    AssignDecodedUtf8(item.description, text_);
+  } else if (name == "content") {
+    if (item.description.empty())
+      AssignDecodedUtf8(item.description, text_);
+  } else if (name == "author") {
+    if (!TrimView(text_).empty())
+      AssignUtf8(item.author, text_);
+  } else if (name == "comments") {
+    AssignUtf8(item.comments, text_);
+  } else if (name == "pubDate" || name == "published") {
+    AssignUtf8(item.pub_date, text_);
+  } else if (name == "updated") {
+    if (item.pub_date.empty())
+      AssignUtf8(item.pub_date, text_);
+  } else if (name == "category") {
+    AssignUtf8(item.category.value, text_);
+  } else if (name == "guid") {
+    AssignUtf8(item.guid.value, text_);
+  } else if (name == "id") {
+    item.guid.is_permalink = false;
+    AssignUtf8(item.guid.value, text_);
+  } else if (name.find(':') != name.npos) {
+    auto& [key, value] = item.namespace_elements.emplace_back();
+    AssignUtf8(key, name);
+    AssignUtf8(value, text_);
+  }
 }
 
 }  // namespace rss
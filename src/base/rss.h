@@ -19,17 +19,14 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-namespace pugi {
-class xml_document;
-class xml_node;
-}
-
 namespace rss {
 
 // Reference: http://www.rssboard.org/rss-specification
+//            https://www.rfc-editor.org/rfc/rfc4287 (Atom)
 
 struct Channel {
   std::wstring title;
@@ -71,16 +68,45 @@ struct Item {
   std::wstring pub_date;     // Indicates when the item was published.
   Source source;             // The RSS channel that the item came from.
 
-  std::unordered_map<std::wstring, std::wstring> namespace_elements;
-};
+  // Elements such as <nyaa:seeders>, in the order they appear. Items have only
+  // a handful of them, so a linear search is faster than a map lookup.
+  std::vector<std::pair<std::wstring, std::wstring>> namespace_elements;
 
-struct Feed {
-  Channel channel;
-  std::vector<Item> items;
+  const std::wstring* namespace_element(std::wstring_view name) const;
 };
 
-Channel ParseChannel(const pugi::xml_node& node);
-Item ParseItem(const pugi::xml_node& node);
-Feed ParseDocument(const pugi::xml_document& document);
+// Streaming reader for RSS 2.0 and Atom feeds. Input must be UTF-8 encoded.
+// Items are built in place in the storage provided by the derived class,
+// without an intermediate document tree.
+class Reader {
+public:
+  virtual ~Reader() = default;
+
+  bool Parse(std::string_view data);
+
+  const Channel& channel() const;
+
+protected:
+  // Returns the object that the next item will be read into.
+  virtual Item& OnItemBegin() = 0;
+  // Called after the item is read. Invalid items should be discarded.
+  virtual void OnItemEnd(Item& item, bool valid) = 0;
+
+private:
+  using Attributes = std::vector<std::pair<std::string_view, std::string_view>>;
+
+  void OnStartElement(std::string_view name, const Attributes& attributes);
+  void OnEndElement(std::string_view name);
+
+  std::wstring attribute(const Attributes& attributes, std::string_view name);
+
+  Channel channel_;
+
+  Item* item_ = nullptr;
+  size_t item_depth_ = 0;
+  std::vector<std::string_view> path_;
+  std::string text_;
+  std::string buffer_;
+};
 
 }  // namespace rss
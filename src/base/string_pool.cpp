@@ -0,0 +1,110 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+
+#include "base/string_pool.h"
+
+#include "base/string.h"
+
+namespace base {
+
+StringPool::id_t StringPool::Intern(const std::wstring_view str) {
+  {
+    std::shared_lock lock{mutex_};
+    if (const auto it = ids_.find(str); it != ids_.end())
+      return it->second;
+  }
+
+  std::unique_lock lock{mutex_};
+  return InternLocked(str);
+}
+
+std::vector<StringPool::id_t> StringPool::Intern(
+    const std::vector<std::wstring>& strings) {
+  std::vector<id_t> ids;
+  ids.reserve(strings.size());
+
+  std::unique_lock lock{mutex_};
+
+  for (const auto& str : strings) {
+    ids.push_back(InternLocked(str));
+  }
+
+  return ids;
+}
+
+const std::wstring& StringPool::Get(const id_t id) const {
+  std::shared_lock lock{mutex_};
+  return id < strings_.size() ? strings_[id] : EmptyString();
+}
+
+StringPool::View StringPool::Get(const std::vector<id_t>& ids) const {
+  return View{*this, ids};
+}
+
+std::vector<StringPool::id_t> StringPool::FindContaining(
+    const std::wstring& str) const {
+  std::vector<id_t> ids;
+
+  std::shared_lock lock{mutex_};
+
+  for (id_t id = 0; id < strings_.size(); ++id) {
+    if (InStr(strings_[id], str, 0, true) > -1)
+      ids.push_back(id);
+  }
+
+  return ids;
+}
+
+size_t StringPool::size() const {
+  std::shared_lock lock{mutex_};
+  return strings_.size();
+}
+
+size_t StringPool::memory_usage() const {
+  std::shared_lock lock{mutex_};
+
+  size_t bytes = 0;
+
+  for (const auto& str : strings_) {
+    bytes += sizeof(str) + str.capacity() * sizeof(wchar_t);
+  }
+
+  // Hash table nodes hold a view, an ID and a pointer to the next node
+  bytes += ids_.size() * (sizeof(std::wstring_view) + sizeof(id_t) +
+                          sizeof(void*)) +
+           ids_.bucket_count() * sizeof(void*);
+
+  return bytes;
+}
+
+// Expects the caller to hold an exclusive lock
+StringPool::id_t StringPool::InternLocked(const std::wstring_view str) {
+  if (const auto it = ids_.find(str); it != ids_.end())
+    return it->second;
+
+  // Strings are stored in a deque, so that the views used as keys remain valid
+  const auto id = static_cast<id_t>(strings_.size());
+  const auto& stored = strings_.emplace_back(str);
+  ids_.emplace(stored, id);
+
+  return id;
+}
+
+}  // namespace base
@@ -0,0 +1,106 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+
+// Stores each distinct string once, and refers to it by a small integer ID.
+// Strings are never removed, so references to them remain valid. The pool can
+// be used from any thread (e.g. the search index is built on a worker thread,
+// and lists are exported in parallel).
+class StringPool {
+public:
+  using id_t = uint32_t;
+
+  // Strings of a list of IDs, which are looked up as they are accessed rather
+  // than copied. The list of IDs must outlive the view.
+  class View {
+  public:
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::wstring;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const std::wstring*;
+      using reference = const std::wstring&;
+
+      iterator() = default;
+      iterator(const StringPool* pool, const id_t* id) : pool_(pool), id_(id) {}
+
+      reference operator*() const { return pool_->Get(*id_); }
+      pointer operator->() const { return &pool_->Get(*id_); }
+      iterator& operator++() { ++id_; return *this; }
+      iterator operator++(int) { auto it = *this; ++id_; return it; }
+      bool operator==(const iterator& it) const { return id_ == it.id_; }
+
+    private:
+      const StringPool* pool_ = nullptr;
+      const id_t* id_ = nullptr;
+    };
+
+    View(const StringPool& pool, const std::vector<id_t>& ids)
+        : pool_(pool), ids_(ids) {}
+
+    iterator begin() const { return {&pool_, ids_.data()}; }
+    iterator end() const { return {&pool_, ids_.data() + ids_.size()}; }
+    bool empty() const { return ids_.empty(); }
+    size_t size() const { return ids_.size(); }
+    const std::wstring& operator[](size_t index) const {
+      return pool_.Get(ids_[index]);
+    }
+
+    operator std::vector<std::wstring>() const { return {begin(), end()}; }
+
+  private:
+    const StringPool& pool_;
+    const std::vector<id_t>& ids_;
+  };
+
+  id_t Intern(const std::wstring_view str);
+  std::vector<id_t> Intern(const std::vector<std::wstring>& strings);
+
+  const std::wstring& Get(const id_t id) const;
+  View Get(const std::vector<id_t>& ids) const;
+
+  // Returns the sorted IDs of the strings that contain the given string,
+  // ignoring case
+  std::vector<id_t> FindContaining(const std::wstring& str) const;
+
+  size_t size() const;
+  size_t memory_usage() const;
+
+private:
+  id_t InternLocked(const std::wstring_view str);
+
+  std::deque<std::wstring> strings_;
+  std::unordered_map<std::wstring_view, id_t> ids_;
+  mutable std::shared_mutex mutex_;
+};
+
+}  // namespace base
@@ -40,6 +40,10 @@ XmlNode XmlChild(XmlNode& node, const std::wstring_view name) {
 ////////////////////////////////////////////////////////////////////////////////
 
 std::wstring XmlDump(const XmlNode node) {
+  return StrToWstr(XmlPrint(node));
+}
+
+std::string XmlPrint(const XmlNode node, const unsigned int depth) {
   struct xml_string_writer : pugi::xml_writer {
     std::string result;
     void write(const void* data, size_t size) override {
@@ -49,9 +53,9 @@ std::wstring XmlDump(const XmlNode node) {
 
   xml_string_writer writer;
   node.print(writer, PUGIXML_TEXT("\t"), pugi::format_default,
-             pugi::encoding_utf8);
+             pugi::encoding_utf8, depth);
 
-  return StrToWstr(writer.result);
+  return writer.result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -102,7 +106,16 @@ bool XmlSaveDocumentToFile(const XmlDocument& document,
                            const unsigned int flags,
                            const pugi::xml_encoding encoding) {
   CreateFolder(GetPathOnly(std::wstring{path}));
-  return document.save_file(path.data(), indent.data(), flags, encoding);
+
+  // The document is written to a temporary file first, so that an interrupted
+  // write cannot leave us with a truncated file.
+  const std::wstring temp_path = std::wstring{path} + L".tmp";
+  if (!document.save_file(temp_path.c_str(), indent.data(), flags, encoding))
+    return false;
+
+  return ::MoveFileEx(temp_path.c_str(), std::wstring{path}.c_str(),
+                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) !=
+         FALSE;
 }
 
 std::wstring XmlReadMetaVersion(const XmlDocument& document) {
@@ -32,6 +32,7 @@ XmlAttribute XmlAttr(XmlNode& node, const std::wstring_view name);
 XmlNode XmlChild(XmlNode& node, const std::wstring_view name);
 
 std::wstring XmlDump(const XmlNode node);
+std::string XmlPrint(const XmlNode node, const unsigned int depth = 0);
 
 int XmlReadInt(const XmlNode& node, const std::wstring_view name);
 std::wstring XmlReadStr(const XmlNode& node, const std::wstring_view name);
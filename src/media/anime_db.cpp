@@ -16,13 +16,19 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <string_view>
+#include <vector>
+
 #include <nstd/algorithm.hpp>
 
 #include "media/anime_db.h"
 
+#include "base/file.h"
 #include "base/log.h"
 #include "base/string.h"
 #include "base/xml.h"
+#include "media/anime_search.h"
 #include "media/anime_season_db.h"
 #include "media/anime_util.h"
 #include "media/library/history.h"
@@ -30,11 +36,38 @@
 #include "sync/service.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "taiga/version.h"
+#include "track/recognition.h"
 #include "ui/ui.h"
 
 namespace anime {
 
+static void LogMetadataStringUsage(
+    const std::pmr::unordered_map<int, Item>& items) {
+  size_t references = 0;
+  size_t string_bytes = 0;
+
+  for (const auto& [id, item] : items) {
+    for (const auto ids : {&item.GetGenreIds(), &item.GetTagIds(),
+                           &item.GetProducerIds(), &item.GetStudioIds()}) {
+      for (const auto string_id : *ids) {
+        const auto& str = metadata_strings.Get(string_id);
+        string_bytes += sizeof(str) + (str.size() + 1) * sizeof(wchar_t);
+      }
+      references += ids->size();
+    }
+  }
+
+  const size_t interned_bytes =
+      metadata_strings.memory_usage() +
+      references * sizeof(base::StringPool::id_t);
+
+  LOGD(L"Metadata strings: {} references to {} unique strings, {} bytes "
+       L"interned ({} bytes as separate copies).",
+       references, metadata_strings.size(), interned_bytes, string_bytes);
+}
+
 bool Database::LoadDatabase() {
   const auto path = taiga::GetPath(taiga::Path::DatabaseAnime);
   constexpr auto options = pugi::parse_default & ~pugi::parse_eol;
@@ -52,10 +85,16 @@ bool Database::LoadDatabase() {
 
   HandleCompatibility(meta_version);
 
+  OnListChange();
+
+  LogMetadataStringUsage(items);
+
   return true;
 }
 
 void Database::ReadDatabaseNode(XmlNode& database_node) {
+  reading_ = true;
+
   for (auto node : database_node.children(L"anime")) {
     std::map<sync::ServiceId, std::wstring> id_map;
 
@@ -81,6 +120,7 @@ void Database::ReadDatabaseNode(XmlNode& database_node) {
 
     const int id = ToInt(id_map[sync::GetCurrentServiceId()]);
     Item& item = items[id];  // Creates the item if it doesn't exist
+    dirty_items_.insert(id);  // setters below do not mark it while reading
 
     for (const auto& [service, id] : id_map) {
       item.SetId(id, service);
@@ -114,79 +154,197 @@ void Database::ReadDatabaseNode(XmlNode& database_node) {
     item.SetLastAiredEpisodeNumber(XmlReadInt(node, L"last_aired_episode"));
     item.SetNextEpisodeTime(ToTime(XmlReadStr(node, L"next_episode_time")));
   }
+
+  reading_ = false;
 }
 
-bool Database::SaveDatabase() const {
-  XmlDocument document;
+Database::~Database() {
+  WaitForSave();
+}
 
-  XmlWriteMetaVersion(document, StrToWstr(taiga::version().to_string()));
-  WriteDatabaseNode(XmlChild(document, L"database"));
+bool Database::SaveDatabase() {
+  // Items are serialized here, but the file is written on another thread
+  WaitForSave();
+
+  const auto start_time = std::chrono::steady_clock::now();
+
+  for (auto it = node_cache_.begin(); it != node_cache_.end(); ) {
+    if (!items.contains(it->first) || dirty_items_.contains(it->first)) {
+      it = node_cache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  dirty_items_.clear();
+
+  size_t serialized_count = 0;
+  std::vector<std::shared_ptr<const std::string>> nodes;
+  nodes.reserve(items.size());
+
+  for (const auto& [id, item] : items) {
+    auto& node = node_cache_[id];
+    if (!node) {
+      XmlDocument document;
+      auto anime_node = document.append_child(L"anime");
+      WriteAnimeNode(anime_node, item);
+      node = std::make_shared<const std::string>(XmlPrint(anime_node, 1));
+      ++serialized_count;
+    }
+    nodes.push_back(node);
+  }
+
+  XmlDocument meta_document;
+  XmlWriteMetaVersion(meta_document,
+                      StrToWstr(taiga::version().to_string()));
+  std::string header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" +
+                       XmlPrint(meta_document) + "<database>\n";
 
   const auto path = taiga::GetPath(taiga::Path::DatabaseAnime);
-  return XmlSaveDocumentToFile(document, path);
+
+  save_thread_ = std::thread([header = std::move(header),
+                              nodes = std::move(nodes), path,
+                              serialized_count, start_time]() {
+    static const std::string footer{"</database>\n"};
+
+    std::vector<std::string_view> chunks;
+    chunks.reserve(nodes.size() + 2);
+    chunks.push_back(header);
+    for (const auto& node : nodes) {
+      chunks.push_back(*node);
+    }
+    chunks.push_back(footer);
+
+    size_t bytes = 0;
+    for (const auto& chunk : chunks) {
+      bytes += chunk.size();
+    }
+
+    if (!SaveChunksToFile(chunks, path)) {
+      LOGE(L"Could not save database: {}", path);
+      return;
+    }
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time);
+    LOGD(L"Saved {} items ({} serialized), {} bytes in {} ms.", nodes.size(),
+         serialized_count, bytes, elapsed.count());
+  });
+
+  return true;
+}
+
+void Database::WaitForSave() {
+  if (save_thread_.joinable())
+    save_thread_.join();
+}
+
+void Database::MarkItemDirty(int id) {
+  // The whole list is invalidated once the database is read
+  if (reading_)
+    return;
+
+  if (batch_depth_ > 0) {
+    batched_items_.insert(id);
+    return;
+  }
+
+  dirty_items_.insert(id);
+  OnItemChange(id);
+}
+
+Database::ChangeBatch::ChangeBatch(Database& db) : db_(db) {
+  ++db_.batch_depth_;
+}
+
+Database::ChangeBatch::~ChangeBatch() {
+  if (--db_.batch_depth_ > 0)
+    return;
+
+  const auto ids = std::move(db_.batched_items_);
+  db_.batched_items_.clear();
+  for (const auto id : ids) {
+    db_.MarkItemDirty(id);
+  }
+}
+
+Database::ChangeBatch Database::BatchChanges() {
+  return ChangeBatch{*this};
+}
+
+void Database::OnItemChange(int id) {
+  taiga::stats.OnItemChange(id);
+  search_index.OnItemChange(id);
+}
+
+void Database::OnListChange() {
+  OnListChange();
 }
 
 void Database::WriteDatabaseNode(XmlNode& database_node) const {
   for (const auto& [id, item] : items) {
     auto anime_node = database_node.append_child(L"anime");
+    WriteAnimeNode(anime_node, item);
+  }
+}
 
-    for (const auto service_id : sync::kServiceIds) {
-      const auto id = item.GetId(service_id);
-      if (!id.empty()) {
-        auto child = anime_node.append_child(L"id");
-        const auto slug = sync::GetServiceSlugById(service_id);
-        child.append_attribute(L"name") = slug.c_str();
-        child.append_child(pugi::node_pcdata).set_value(id.c_str());
-      }
+void Database::WriteAnimeNode(XmlNode& anime_node, const Item& item) const {
+  for (const auto service_id : sync::kServiceIds) {
+    const auto id = item.GetId(service_id);
+    if (!id.empty()) {
+      auto child = anime_node.append_child(L"id");
+      const auto slug = sync::GetServiceSlugById(service_id);
+      child.append_attribute(L"name") = slug.c_str();
+      child.append_child(pugi::node_pcdata).set_value(id.c_str());
     }
-
-    const std::wstring source = sync::GetServiceSlugById(
-        static_cast<sync::ServiceId>(item.GetSource()));
-
-    #define XML_WC(n, v, t) \
-      if (!v.empty()) XmlWriteChildNodes(anime_node, v, n, t)
-    #define XML_WD(n, v) \
-      if (!v.empty()) XmlWriteStr(anime_node, n, v.to_string())
-    #define XML_WI(n, v) \
-      if (v > 0) XmlWriteInt(anime_node, n, v)
-    #define XML_WS(n, v, t) \
-      if (!v.empty()) XmlWriteStr(anime_node, n, v, t)
-    #define XML_WF(n, v, t) \
-      if (v > 0.0) XmlWriteStr(anime_node, n, ToWstr(v), t)
-    #define XML_WT(n, v, t) \
-      if (v > 0) XmlWriteStr(anime_node, n, ToWstr(v), t)
-    XML_WS(L"source", source, pugi::node_pcdata);
-    XML_WS(L"slug", item.GetSlug(), pugi::node_pcdata);
-    XML_WS(L"title", item.GetTitle(), pugi::node_cdata);
-    XML_WS(L"english", item.GetEnglishTitle(), pugi::node_cdata);
-    XML_WS(L"japanese", item.GetJapaneseTitle(), pugi::node_cdata);
-    XML_WC(L"synonym", item.GetSynonyms(), pugi::node_cdata);
-    XML_WI(L"type", static_cast<int>(item.GetType()));
-    XML_WI(L"status", static_cast<int>(item.GetAiringStatus(false)));
-    XML_WI(L"episode_count", item.GetEpisodeCount());
-    XML_WI(L"episode_length", item.GetEpisodeLength());
-    XML_WD(L"date_start", item.GetDateStart());
-    XML_WD(L"date_end", item.GetDateEnd());
-    XML_WS(L"image", item.GetImageUrl(), pugi::node_pcdata);
-    XML_WS(L"trailer_id", item.GetTrailerId(), pugi::node_pcdata);
-    XML_WI(L"age_rating", static_cast<int>(item.GetAgeRating()));
-    XML_WS(L"genres", Join(item.GetGenres(), L", "), pugi::node_pcdata);
-    XML_WS(L"tags", Join(item.GetTags(), L", "), pugi::node_pcdata);
-    XML_WS(L"producers", Join(item.GetProducers(), L", "), pugi::node_pcdata);
-    XML_WS(L"studios", Join(item.GetStudios(), L", "), pugi::node_pcdata);
-    XML_WF(L"score", item.GetScore(), pugi::node_pcdata);
-    XML_WI(L"popularity", item.GetPopularity());
-    XML_WS(L"synopsis", item.GetSynopsis(), pugi::node_cdata);
-    XML_WI(L"last_aired_episode", item.GetLastAiredEpisodeNumber());
-    XML_WT(L"next_episode_time", item.GetNextEpisodeTime(), pugi::node_pcdata);
-    XML_WT(L"modified", item.GetLastModified(), pugi::node_pcdata);
-    #undef XML_WT
-    #undef XML_WF
-    #undef XML_WS
-    #undef XML_WI
-    #undef XML_WD
-    #undef XML_WC
   }
+
+  const std::wstring source = sync::GetServiceSlugById(
+      static_cast<sync::ServiceId>(item.GetSource()));
+
+  #define XML_WC(n, v, t) \
+    if (!v.empty()) XmlWriteChildNodes(anime_node, v, n, t)
+  #define XML_WD(n, v) \
+    if (!v.empty()) XmlWriteStr(anime_node, n, v.to_string())
+  #define XML_WI(n, v) \
+    if (v > 0) XmlWriteInt(anime_node, n, v)
+  #define XML_WS(n, v, t) \
+    if (!v.empty()) XmlWriteStr(anime_node, n, v, t)
+  #define XML_WF(n, v, t) \
+    if (v > 0.0) XmlWriteStr(anime_node, n, ToWstr(v), t)
+  #define XML_WT(n, v, t) \
+    if (v > 0) XmlWriteStr(anime_node, n, ToWstr(v), t)
+  XML_WS(L"source", source, pugi::node_pcdata);
+  XML_WS(L"slug", item.GetSlug(), pugi::node_pcdata);
+  XML_WS(L"title", item.GetTitle(), pugi::node_cdata);
+  XML_WS(L"english", item.GetEnglishTitle(), pugi::node_cdata);
+  XML_WS(L"japanese", item.GetJapaneseTitle(), pugi::node_cdata);
+  XML_WC(L"synonym", item.GetSynonyms(), pugi::node_cdata);
+  XML_WI(L"type", static_cast<int>(item.GetType()));
+  XML_WI(L"status", static_cast<int>(item.GetAiringStatus(false)));
+  XML_WI(L"episode_count", item.GetEpisodeCount());
+  XML_WI(L"episode_length", item.GetEpisodeLength());
+  XML_WD(L"date_start", item.GetDateStart());
+  XML_WD(L"date_end", item.GetDateEnd());
+  XML_WS(L"image", item.GetImageUrl(), pugi::node_pcdata);
+  XML_WS(L"trailer_id", item.GetTrailerId(), pugi::node_pcdata);
+  XML_WI(L"age_rating", static_cast<int>(item.GetAgeRating()));
+  XML_WS(L"genres", Join(item.GetGenres(), L", "), pugi::node_pcdata);
+  XML_WS(L"tags", Join(item.GetTags(), L", "), pugi::node_pcdata);
+  XML_WS(L"producers", Join(item.GetProducers(), L", "), pugi::node_pcdata);
+  XML_WS(L"studios", Join(item.GetStudios(), L", "), pugi::node_pcdata);
+  XML_WF(L"score", item.GetScore(), pugi::node_pcdata);
+  XML_WI(L"popularity", item.GetPopularity());
+  XML_WS(L"synopsis", item.GetSynopsis(), pugi::node_cdata);
+  XML_WI(L"last_aired_episode", item.GetLastAiredEpisodeNumber());
+  XML_WT(L"next_episode_time", item.GetNextEpisodeTime(), pugi::node_pcdata);
+  XML_WT(L"modified", item.GetLastModified(), pugi::node_pcdata);
+  #undef XML_WT
+  #undef XML_WF
+  #undef XML_WS
+  #undef XML_WI
+  #undef XML_WD
+  #undef XML_WC
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -206,9 +364,14 @@ Item* Database::Find(int id, bool log_error) {
 Item* Database::Find(const std::wstring& id, sync::ServiceId service,
                      bool log_error) {
   if (!id.empty()) {
-    for (auto& pair : items)
-      if (id == pair.second.GetId(service))
-        return &pair.second;
+    if (const auto index = id_index_.find(service); index != id_index_.end()) {
+      if (const auto it = index->second.find(id); it != index->second.end()) {
+        if (const auto item = Find(it->second, false)) {
+          if (item->GetId(service) == id)
+            return item;
+        }
+      }
+    }
     if (log_error)
       LOGE(L"Could not find ID: {}", id);
   }
@@ -218,55 +381,130 @@ Item* Database::Find(const std::wstring& id, sync::ServiceId service,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void Database::Clear() {
+  items.clear();
+  id_index_.clear();
+  node_cache_.clear();
+  dirty_items_.clear();
+
+  OnListChange();
+}
+
 void Database::ClearInvalidItems() {
   for (auto it = items.begin(); it != items.end(); ) {
     if (!anime::IsValidId(it->second.GetId()) ||
         it->first != it->second.GetId()) {
       LOGD(L"ID: {}", it->first);
-      items.erase(it++);
+      RemoveFromIdIndex(it->first, it->second);
+      it = items.erase(it);
     } else {
       ++it;
     }
   }
+
+  OnListChange();
 }
 
 bool Database::DeleteItem(int id) {
+  return DeleteItems({id}) > 0;
+}
+
+size_t Database::DeleteItems(const std::set<int>& ids) {
+  std::set<int> deleted_ids;
   std::wstring title;
 
-  auto anime_item = Find(id, false);
-  if (anime_item)
-    title = anime::GetPreferredTitle(*anime_item);
+  for (const auto id : ids) {
+    const auto it = items.find(id);
+    if (it == items.end())
+      continue;
 
-  if (items.erase(id) > 0) {
+    title = anime::GetPreferredTitle(it->second);
     LOGW(L"ID: {} | Title: {}", id, title);
 
-    library::history.items.erase(
-        std::remove_if(library::history.items.begin(),
-                       library::history.items.end(),
-                       [&id](const library::HistoryItem& item) {
-                         return item.anime_id == id;
-                       }),
-        library::history.items.end());
-
-    library::queue.items.erase(
-        std::remove_if(library::queue.items.begin(),
-                       library::queue.items.end(),
-                       [&id](const library::QueueItem& item) {
-                         return item.anime_id == id;
-                       }),
-        library::queue.items.end());
-
-    auto& items = anime::season_db.items;
-    items.erase(std::remove(items.begin(), items.end(), id), items.end());
-
-    if (CurrentEpisode.anime_id == id)
-      CurrentEpisode.Set(anime::ID_UNKNOWN);
-
-    ui::OnAnimeDelete(id, title);
-    return true;
+    RemoveFromIdIndex(it->first, it->second);
+    Meow.EraseTitles(it->second);
+    items.erase(it);
+    deleted_ids.insert(id);
+    OnItemChange(id);
+  }
+
+  if (deleted_ids.empty())
+    return 0;
+
+  // Dependent collections are compacted once, regardless of how many items
+  // were deleted.
+  const auto is_deleted = [&deleted_ids](const int anime_id) {
+    return deleted_ids.contains(anime_id);
+  };
+
+  library::history.items.erase(
+      std::remove_if(library::history.items.begin(),
+                     library::history.items.end(),
+                     [&is_deleted](const library::HistoryItem& item) {
+                       return is_deleted(item.anime_id);
+                     }),
+      library::history.items.end());
+
+  library::queue.items.erase(
+      std::remove_if(library::queue.items.begin(),
+                     library::queue.items.end(),
+                     [&is_deleted](const library::QueueItem& item) {
+                       return is_deleted(item.anime_id);
+                     }),
+      library::queue.items.end());
+  library::queue.RebuildIndex();
+
+  auto& season_items = anime::season_db.items;
+  season_items.erase(
+      std::remove_if(season_items.begin(), season_items.end(), is_deleted),
+      season_items.end());
+
+  if (is_deleted(CurrentEpisode.anime_id))
+    CurrentEpisode.Set(anime::ID_UNKNOWN);
+
+  ui::OnAnimeDelete(deleted_ids, title);
+
+  return deleted_ids.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Database::UpdateIdIndex(const Item& item, sync::ServiceId service,
+                             const std::wstring& previous_id) {
+  // Items that are not stored in the database (e.g. dummies) are not indexed
+  const auto it = items.find(item.GetId());
+  if (it == items.end() || &it->second != &item)
+    return;
+
+  auto& index = id_index_[service];
+
+  if (!previous_id.empty()) {
+    const auto previous = index.find(previous_id);
+    if (previous != index.end() && previous->second == item.GetId())
+      index.erase(previous);
   }
 
-  return false;
+  // The item may not have been indexed yet, if its ID for the current service
+  // was set after the others.
+  for (const auto service_id : sync::kServiceIds) {
+    const auto& id = item.GetId(service_id);
+    if (!id.empty())
+      id_index_[service_id][id] = item.GetId();
+  }
+}
+
+// Entries point to the key of the item in the map, which differs from its ID
+// for invalid items that are being cleared.
+void Database::RemoveFromIdIndex(int key, const Item& item) {
+  for (const auto service_id : sync::kServiceIds) {
+    const auto& id = item.GetId(service_id);
+    if (id.empty())
+      continue;
+    auto& index = id_index_[service_id];
+    const auto indexed = index.find(id);
+    if (indexed != index.end() && indexed->second == key)
+      index.erase(indexed);
+  }
 }
 
 }  // namespace anime
@@ -18,8 +18,14 @@
 
 #pragma once
 
-#include <string>
+#include <ctime>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 #include "media/anime.h"
 #include "media/anime_item.h"
@@ -39,19 +45,54 @@ namespace anime {
 
 class Database {
 public:
+  ~Database();
+
   bool LoadDatabase();
-  bool SaveDatabase() const;
+  bool SaveDatabase();
+  void WaitForSave();
+
+  // Only the items that are marked as changed are serialized again when the
+  // database is saved.
+  void MarkItemDirty(int id);
+
+  // Items that change while a batch is alive are reported once each, when
+  // the outermost batch ends, rather than once for every setter.
+  class ChangeBatch final {
+  public:
+    explicit ChangeBatch(Database& db);
+    ~ChangeBatch();
+    ChangeBatch(const ChangeBatch&) = delete;
+    ChangeBatch& operator=(const ChangeBatch&) = delete;
+
+  private:
+    Database& db_;
+  };
+  [[nodiscard]] ChangeBatch BatchChanges();
+
+  // Invalidates the data that is derived from the list (e.g. statistics and
+  // the search index), for a single item or for the whole list.
+  void OnItemChange(int id);
+  void OnListChange();
 
   Item* Find(int id, bool log_error = true);
   Item* Find(const std::wstring& id, sync::ServiceId service,
              bool log_error = true);
 
+  void Clear();
   void ClearInvalidItems();
   bool DeleteItem(int id);
+  size_t DeleteItems(const std::set<int>& ids);
+
+  // Called by items when their service IDs change, so that they can be found
+  // by those IDs without scanning the whole database.
+  void UpdateIdIndex(const Item& item, sync::ServiceId service,
+                     const std::wstring& previous_id);
 
 public:
   bool LoadList();
   bool SaveList(bool include_database = false) const;
+  bool SaveListToFile(const std::wstring& path,
+                      bool include_database = false) const;
 
   int GetItemCount(MyStatus status, bool check_history = true);
 
@@ -60,15 +101,37 @@ public:
   bool DeleteListItem(int anime_id);
   void UpdateItem(const library::QueueItem& queue_item);
 
+private:
+  // Items are allocated from pools rather than individually, so that they are
+  // laid out close together in memory. Must be declared before the items.
+  std::pmr::unsynchronized_pool_resource item_resource_;
+
 public:
-  std::map<int, Item> items;
+  std::pmr::unordered_map<int, Item> items{&item_resource_};
+
+  // Most recent modification time of the remote list, and the time that it
+  // was last downloaded in its entirety. Used for delta synchronization.
+  time_t list_watermark = 0;
+  time_t list_full_sync_time = 0;
 
 private:
+  void RemoveFromIdIndex(int key, const Item& item);
+
   void ReadDatabaseNode(pugi::xml_node& database_node);
   void WriteDatabaseNode(pugi::xml_node& database_node) const;
+  void WriteAnimeNode(pugi::xml_node& anime_node, const Item& item) const;
 
   void HandleCompatibility(const std::wstring& meta_version);
   void HandleListCompatibility(const std::wstring& meta_version);
+
+  std::map<sync::ServiceId, std::unordered_map<std::wstring, int>> id_index_;
+
+  std::unordered_map<int, std::shared_ptr<const std::string>> node_cache_;
+  std::set<int> dirty_items_;
+  std::set<int> batched_items_;
+  int batch_depth_ = 0;
+  bool reading_ = false;
+  std::thread save_thread_;
 };
 
 inline Database db;
@@ -18,12 +18,14 @@
 
 #include <algorithm>
 #include <map>
+#include <optional>
 #include <regex>
 
 #include "media/anime_filter.h"
 
 #include "base/string.h"
 #include "media/anime_item.h"
+#include "media/anime_search.h"
 #include "media/anime_util.h"
 #include "ui/translate.h"
 
@@ -44,6 +46,7 @@ enum class SearchField {
   Rewatch,
   Duration,
   Score,
+  Text,
   Debug,
 };
 
@@ -59,6 +62,12 @@ struct SearchTerm {
   SearchField field = SearchField::None;
   SearchOperator op = SearchOperator::EQ;
   std::wstring value;
+
+  // Values are prepared when the query is compiled, rather than for each item
+  int number = 0;
+  SeriesType type = SeriesType::Unknown;
+  std::vector<base::StringPool::id_t> string_ids;
+  std::vector<int> anime_ids;
 };
 
 SearchTerm GetSearchTerm(const std::wstring& str) {
@@ -81,6 +90,7 @@ SearchTerm GetSearchTerm(const std::wstring& str) {
     {L"rewatch", SearchField::Rewatch},
     {L"duration", SearchField::Duration},
     {L"score", SearchField::Score},
+    {L"text", SearchField::Text},
     {L"debug", SearchField::Debug},
   };
 
@@ -111,6 +121,36 @@ SearchTerm GetSearchTerm(const std::wstring& str) {
   return term;
 }
 
+// Terms are evaluated in this order, so that items can be rejected by cheap
+// comparisons before their strings are looked at.
+int GetSearchTermCost(const SearchField field) {
+  switch (field) {
+    case SearchField::Id:
+    case SearchField::Episodes:
+    case SearchField::Type:
+    case SearchField::Year:
+    case SearchField::Rewatch:
+    case SearchField::Duration:
+    case SearchField::Score:
+    case SearchField::Debug:
+      return 0;
+    case SearchField::Genre:
+    case SearchField::Producer:
+    case SearchField::Tag:
+    case SearchField::Text:
+      return 1;
+    case SearchField::Season:
+      return 2;
+    case SearchField::Note:
+      return 3;
+    case SearchField::Title:
+      return 4;
+    case SearchField::None:
+    default:
+      return 5;
+  }
+}
+
 bool CheckNumber(const SearchOperator op, const int a, const int b) {
   switch (op) {
     default:
@@ -123,153 +163,205 @@ bool CheckNumber(const SearchOperator op, const int a, const int b) {
 }
 
 bool CheckString(const std::wstring& a, const std::wstring& b) {
-  return InStr(a, b, 0, true) > -1;
+  return a.find(b) != std::wstring::npos;
 }
 
 bool CheckStrings(const std::vector<std::wstring>& v, const std::wstring& w) {
   for (const auto& s : v) {
-    if (InStr(s, w, 0, true) > -1)
+    if (CheckString(s, w))
       return true;
   }
   return false;
 };
 
+bool CheckIds(const std::vector<base::StringPool::id_t>& ids,
+              const std::vector<base::StringPool::id_t>& matches) {
+  for (const auto id : ids) {
+    if (std::binary_search(matches.begin(), matches.end(), id))
+      return true;
+  }
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-bool Filters::CheckItem(const Item& item, int text_index) const {
-  const auto it = text.find(text_index);
+struct Filters::Query {
+  std::wstring text;
+  size_t string_pool_size = 0;
+  std::optional<unsigned int> search_index_generation;
+  std::vector<SearchTerm> terms;
+};
 
-  if (it == text.end() || it->second.empty())
+// Titles and notes are matched against the case-folded copies kept by the
+// search index, so that they are not folded again for every search.
+static bool CheckTerm(const SearchTerm& term, const Item& item) {
+  switch (term.field) {
+    case SearchField::None:
+      return CheckIds(item.GetGenreIds(), term.string_ids) ||
+             CheckIds(item.GetTagIds(), term.string_ids) ||
+             CheckString(search_index.GetFoldedFields(item).notes,
+                         term.value) ||
+             CheckStrings(search_index.GetFoldedFields(item).titles,
+                          term.value);
+
+    case SearchField::Id:
+      return CheckNumber(term.op, item.GetId(), term.number);
+
+    case SearchField::Episodes:
+      return CheckNumber(term.op, item.GetEpisodeCount(), term.number);
+
+    case SearchField::Title:
+      return CheckStrings(search_index.GetFoldedFields(item).titles,
+                          term.value);
+
+    case SearchField::Genre:
+      return CheckIds(item.GetGenreIds(), term.string_ids);
+
+    case SearchField::Producer:
+      return CheckIds(item.GetProducerIds(), term.string_ids) ||
+             CheckIds(item.GetStudioIds(), term.string_ids);
+
+    case SearchField::Tag:
+      return CheckIds(item.GetTagIds(), term.string_ids);
+
+    case SearchField::Note:
+      return CheckString(search_index.GetFoldedFields(item).notes,
+                         term.value);
+
+    case SearchField::Type:
+      return item.GetType() == term.type;
+
+    case SearchField::Season: {
+      const auto season =
+          ToLower_Copy(ui::TranslateDateToSeasonString(item.GetDateStart()));
+      return CheckString(season, term.value);
+    }
+
+    case SearchField::Year:
+      return CheckNumber(term.op, item.GetDateStart().year(), term.number);
+
+    case SearchField::Rewatch:
+      return CheckNumber(term.op, item.GetMyRewatchedTimes(), term.number);
+
+    case SearchField::Duration:
+      return CheckNumber(term.op, item.GetEpisodeLength(), term.number);
+
+    case SearchField::Score:
+      return CheckNumber(term.op, item.GetMyScore(), term.number);
+
+    case SearchField::Text:
+      return std::binary_search(term.anime_ids.begin(), term.anime_ids.end(),
+                                item.GetId());
+
+    case SearchField::Debug:
+      if (term.value == L"watched") {
+        const int eps_watched = item.GetMyLastWatchedEpisode();
+        const int eps_total = item.GetEpisodeCount();
+        return !anime::IsValidEpisodeNumber(eps_watched, eps_total) ||
+               (eps_watched < eps_total &&
+                item.GetMyStatus() == anime::MyStatus::Completed);
+      }
+      return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Filters::CheckItem(const Item& item, const Query* query) {
+  if (!query)
     return true;
 
-  std::vector<std::wstring> words;
-  Split(it->second, L" ", words);
-  RemoveEmptyStrings(words);
+  for (const auto& term : query->terms) {
+    if (!CheckTerm(term, item))
+      return false;
+  }
 
-  std::vector<std::wstring> titles;
-  GetAllTitles(item.GetId(), titles);
+  return true;
+}
 
-  const auto& genres = item.GetGenres();
-  const auto& tags = item.GetTags();
-  const auto& producers = item.GetProducers();
-  const auto& studios = item.GetStudios();
-  const auto& notes = item.GetMyNotes();
+std::shared_ptr<const Filters::Query> Filters::GetQuery(int text_index) const {
+  const auto it = text.find(text_index);
 
-  std::vector<SearchTerm> search_terms;
-  for (const auto& word : words) {
-    search_terms.push_back(GetSearchTerm(word));
+  if (it == text.end() || it->second.empty())
+    return nullptr;
+
+  // Queries are compiled again when the text changes, or when new strings are
+  // interned or the search index changes, since those may match the terms.
+  search_index.ApplyChanges();
+  auto& query = queries_[text_index];
+  if (!query || query->text != it->second ||
+      query->string_pool_size != metadata_strings.size() ||
+      (query->search_index_generation &&
+       *query->search_index_generation != search_index.generation())) {
+    query = CompileQuery(it->second);
   }
 
-  for (const auto& term : search_terms) {
-    switch (term.field) {
-      case SearchField::None:
-        if (!CheckStrings(titles, term.value) &&
-            !CheckStrings(genres, term.value) &&
-            !CheckStrings(tags, term.value) &&
-            !CheckString(notes, term.value)) {
-          return false;
-        }
-        break;
+  return query;
+}
 
-      case SearchField::Id:
-        if (!CheckNumber(term.op, item.GetId(), ToInt(term.value)))
-          return false;
-        break;
+std::shared_ptr<const Filters::Query> Filters::CompileQuery(
+    const std::wstring& text) {
+  auto query = std::make_shared<Query>();
+  query->text = text;
+  query->string_pool_size = metadata_strings.size();
 
-      case SearchField::Episodes:
-        if (!CheckNumber(term.op, item.GetEpisodeCount(), ToInt(term.value)))
-          return false;
-        break;
+  std::vector<std::wstring> words;
+  Split(text, L" ", words);
+  RemoveEmptyStrings(words);
 
-      case SearchField::Title:
-        if (!CheckStrings(titles, term.value))
-          return false;
-        break;
+  for (const auto& word : words) {
+    auto term = GetSearchTerm(word);
 
+    switch (term.field) {
+      case SearchField::None:
       case SearchField::Genre:
-        if (!CheckStrings(genres, term.value))
-          return false;
-        break;
-
       case SearchField::Producer:
-        if (!CheckStrings(producers, term.value) &&
-            !CheckStrings(studios, term.value)) {
-          return false;
-        }
-        break;
-
       case SearchField::Tag:
-        if (!CheckStrings(tags, term.value)) {
-          return false;
-        }
+        term.string_ids = metadata_strings.FindContaining(term.value);
         break;
-
-      case SearchField::Note:
-        if (!CheckString(notes, term.value))
-          return false;
-        break;
-
       case SearchField::Type:
-        if (item.GetType() != ui::TranslateType(term.value))
-          return false;
+        term.type = ui::TranslateType(term.value);
         break;
-
-      case SearchField::Season: {
-        const auto season =
-            ui::TranslateDateToSeasonString(item.GetDateStart());
-        if (!CheckString(season, term.value))
-          return false;
+      case SearchField::Text:
+        term.anime_ids = search_index.Search(term.value);
+        std::sort(term.anime_ids.begin(), term.anime_ids.end());
         break;
-      }
-
-      case SearchField::Year: {
-        const auto year = item.GetDateStart().year();
-        if (!CheckNumber(term.op, year, ToInt(term.value)))
-          return false;
+      case SearchField::Id:
+      case SearchField::Episodes:
+      case SearchField::Year:
+      case SearchField::Rewatch:
+      case SearchField::Duration:
+      case SearchField::Score:
+        term.number = ToInt(term.value);
         break;
-      }
-
-      case SearchField::Rewatch: {
-        const auto rewatches = item.GetMyRewatchedTimes();
-        if (!CheckNumber(term.op, rewatches, ToInt(term.value)))
-          return false;
+      default:
         break;
-      }
+    }
 
-      case SearchField::Duration: {
-        const auto duration = item.GetEpisodeLength();
-        if (!CheckNumber(term.op, duration, ToInt(term.value)))
-          return false;
-        break;
-      }
+    if (term.field != SearchField::Debug)
+      ToLower(term.value);
 
-      case SearchField::Score: {
-        const auto score = item.GetMyScore();
-        if (!CheckNumber(term.op, score, ToInt(term.value)))
-          return false;
-        break;
-      }
+    query->terms.push_back(std::move(term));
+  }
 
-      case SearchField::Debug: {
-        if (term.value == L"watched") {
-          const int eps_watched = item.GetMyLastWatchedEpisode();
-          const int eps_total = item.GetEpisodeCount();
-          if (!anime::IsValidEpisodeNumber(eps_watched, eps_total) ||
-              (eps_watched < eps_total &&
-               item.GetMyStatus() == anime::MyStatus::Completed)) {
-            continue;
-          } else {
-            return false;
-          }
-        } else {
-          return false;
-        }
-        break;
-      }
-    }
+  // Searching can apply pending changes to the index, so the generation is
+  // only known afterwards.
+  if (std::any_of(query->terms.begin(), query->terms.end(),
+                  [](const SearchTerm& term) {
+                    return term.field == SearchField::Text;
+                  })) {
+    query->search_index_generation = search_index.generation();
   }
 
-  return true;
+  std::stable_sort(query->terms.begin(), query->terms.end(),
+                   [](const SearchTerm& a, const SearchTerm& b) {
+                     return GetSearchTermCost(a.field) <
+                            GetSearchTermCost(b.field);
+                   });
+
+  return query;
 }
 
 }  // namespace anime
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 
 namespace anime {
@@ -27,9 +28,19 @@ class Item;
 
 class Filters {
 public:
-  bool CheckItem(const Item& item, int text_index) const;
+  struct Query;
+
+  // Search text is compiled into a query once per refresh, rather than for
+  // each item. Returns null if there is no text to filter by.
+  std::shared_ptr<const Query> GetQuery(int text_index) const;
+  static bool CheckItem(const Item& item, const Query* query);
 
   std::map<int, std::wstring> text;
+
+private:
+  static std::shared_ptr<const Query> CompileQuery(const std::wstring& text);
+
+  mutable std::map<int, std::shared_ptr<const Query>> queries_;
 };
 
 }  // namespace anime
@@ -23,6 +23,7 @@
 
 #include "base/string.h"
 #include "base/time.h"
+#include "media/anime_db.h"
 #include "media/anime_util.h"
 #include "media/library/queue.h"
 #include "sync/service.h"
@@ -102,24 +103,24 @@ AgeRating Item::GetAgeRating() const {
   return series_.age_rating;
 }
 
-const std::vector<std::wstring>& Item::GetGenres() const {
-  return series_.genres;
+base::StringPool::View Item::GetGenres() const {
+  return metadata_strings.Get(genres_);
 }
 
-const std::vector<std::wstring>& Item::GetTags() const {
-  return series_.tags;
+base::StringPool::View Item::GetTags() const {
+  return metadata_strings.Get(tags_);
 }
 
 int Item::GetPopularity() const {
   return series_.popularity_rank;
 }
 
-const std::vector<std::wstring>& Item::GetProducers() const {
-  return series_.producers;
+base::StringPool::View Item::GetProducers() const {
+  return metadata_strings.Get(producers_);
 }
 
-const std::vector<std::wstring>& Item::GetStudios() const {
-  return series_.studios;
+base::StringPool::View Item::GetStudios() const {
+  return metadata_strings.Get(studios_);
 }
 
 double Item::GetScore() const {
@@ -148,53 +149,75 @@ time_t Item::GetNextEpisodeTime() const {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Metadata is stored in the database, which only serializes the items that
+// are marked as changed. Scratch items that are not in the database (e.g.
+// copies) are left alone.
+void Item::MarkDirty() const {
+  if (db.Find(GetId(), false) == this)
+    db.MarkItemDirty(GetId());
+}
+
 void Item::SetId(const std::wstring& id, sync::ServiceId service) {
+  const auto previous_id = GetId(service);
+
   series_.uids[service] = id;
 
   if (service == sync::GetCurrentServiceId()) {
     series_.id = ToInt(id);
   }
+
+  db.UpdateIdIndex(*this, service, previous_id);
+  MarkDirty();
 }
 
 void Item::SetSlug(const std::wstring& slug) {
   series_.slug = slug;
+  MarkDirty();
 }
 
 void Item::SetSource(sync::ServiceId source) {
   series_.source = source;
+  MarkDirty();
 }
 
 void Item::SetType(SeriesType type) {
   series_.type = type;
+  MarkDirty();
 }
 
 void Item::SetEpisodeCount(int number) {
   series_.episode_count = std::clamp(number, 0, kMaxEpisodeCount);
+  MarkDirty();
 
   // TODO: Call it separately
   if (number >= 0)
-    if (static_cast<size_t>(number) > local_info_.available_episodes.size())
-      local_info_.available_episodes.resize(number);
+    if (static_cast<size_t>(number) > available_episodes_.size())
+      available_episodes_.resize(number);
 }
 
 void Item::SetEpisodeLength(int number) {
   series_.episode_length = number;
+  MarkDirty();
 }
 
 void Item::SetAiringStatus(SeriesStatus status) {
   series_.status = status;
+  MarkDirty();
 }
 
 void Item::SetTitle(const std::wstring& title) {
   series_.titles.romaji = title;
+  MarkDirty();
 }
 
 void Item::SetEnglishTitle(const std::wstring& title) {
   series_.titles.english = title;
+  MarkDirty();
 }
 
 void Item::SetJapaneseTitle(const std::wstring& title) {
   series_.titles.japanese = title;
+  MarkDirty();
 }
 
 void Item::InsertSynonym(const std::wstring& synonym) {
@@ -202,6 +225,7 @@ void Item::InsertSynonym(const std::wstring& synonym) {
       synonym == GetEnglishTitle() || synonym == GetJapaneseTitle())
     return;
   series_.titles.synonyms.push_back(synonym);
+  MarkDirty();
 }
 
 void Item::SetSynonyms(const std::wstring& synonyms) {
@@ -217,6 +241,7 @@ void Item::SetSynonyms(const std::vector<std::wstring>& synonyms) {
     return;
 
   series_.titles.synonyms.clear();
+  MarkDirty();
 
   for (const auto& synonym : synonyms) {
     InsertSynonym(synonym);
@@ -225,6 +250,7 @@ void Item::SetSynonyms(const std::vector<std::wstring>& synonyms) {
 
 void Item::SetDateStart(const Date& date) {
   series_.start_date = date;
+  MarkDirty();
 }
 
 void Item::SetDateStart(const std::wstring& date) {
@@ -233,6 +259,7 @@ void Item::SetDateStart(const std::wstring& date) {
 
 void Item::SetDateEnd(const Date& date) {
   series_.end_date = date;
+  MarkDirty();
 }
 
 void Item::SetDateEnd(const std::wstring& date) {
@@ -241,10 +268,12 @@ void Item::SetDateEnd(const std::wstring& date) {
 
 void Item::SetImageUrl(const std::wstring& url) {
   series_.image_url = url;
+  MarkDirty();
 }
 
 void Item::SetAgeRating(AgeRating rating) {
   series_.age_rating = rating;
+  MarkDirty();
 }
 
 void Item::SetGenres(const std::wstring& genres) {
@@ -256,7 +285,8 @@ void Item::SetGenres(const std::wstring& genres) {
 }
 
 void Item::SetGenres(const std::vector<std::wstring>& genres) {
-  series_.genres = genres;
+  genres_ = metadata_strings.Intern(genres);
+  MarkDirty();
 }
 
 void Item::SetTags(const std::wstring& tags) {
@@ -268,11 +298,13 @@ void Item::SetTags(const std::wstring& tags) {
 }
 
 void Item::SetTags(const std::vector<std::wstring>& tags) {
-  series_.tags = tags;
+  tags_ = metadata_strings.Intern(tags);
+  MarkDirty();
 }
 
 void Item::SetPopularity(int popularity) {
   series_.popularity_rank = popularity;
+  MarkDirty();
 }
 
 void Item::SetProducers(const std::wstring& producers) {
@@ -284,7 +316,8 @@ void Item::SetProducers(const std::wstring& producers) {
 }
 
 void Item::SetProducers(const std::vector<std::wstring>& producers) {
-  series_.producers = producers;
+  producers_ = metadata_strings.Intern(producers);
+  MarkDirty();
 }
 
 void Item::SetStudios(const std::wstring& studios) {
@@ -296,141 +329,164 @@ void Item::SetStudios(const std::wstring& studios) {
 }
 
 void Item::SetStudios(const std::vector<std::wstring>& studios) {
-  series_.studios = studios;
+  studios_ = metadata_strings.Intern(studios);
+  MarkDirty();
 }
 
 void Item::SetScore(double score) {
   series_.score = score > 0.0 ? static_cast<float>(score) : 0.0f;
+  MarkDirty();
 }
 
 void Item::SetSynopsis(const std::wstring& synopsis) {
   series_.synopsis = synopsis;
+  MarkDirty();
 }
 
 void Item::SetTrailerId(const std::wstring& trailer_id) {
   series_.trailer_id = trailer_id;
+  MarkDirty();
 }
 
 void Item::SetLastModified(time_t modified) {
   series_.last_modified = modified;
+  MarkDirty();
 }
 
 void Item::SetLastAiredEpisodeNumber(int number) {
   if (number > series_.last_aired_episode) {
     series_.last_aired_episode = number;
+    MarkDirty();
   }
 }
 
 void Item::SetNextEpisodeTime(const time_t time) {
   series_.next_episode_time = time;
+  MarkDirty();
+}
+
+const std::vector<base::StringPool::id_t>& Item::GetGenreIds() const {
+  return genres_;
+}
+
+const std::vector<base::StringPool::id_t>& Item::GetTagIds() const {
+  return tags_;
+}
+
+const std::vector<base::StringPool::id_t>& Item::GetProducerIds() const {
+  return producers_;
+}
+
+const std::vector<base::StringPool::id_t>& Item::GetStudioIds() const {
+  return studios_;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 const std::wstring& Item::GetMyId() const {
-  if (!my_info_.get())
+  if (!my_info_)
     return EmptyString();
 
   return my_info_->id;
 }
 
 int Item::GetMyLastWatchedEpisode(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return 0;
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::Episode) : nullptr;
 
   return queue_item ? *queue_item->episode : my_info_->watched_episodes;
 }
 
 int Item::GetMyScore(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return 0;
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::Score) : nullptr;
 
   return queue_item ? *queue_item->score : my_info_->score;
 }
 
 MyStatus Item::GetMyStatus(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return MyStatus::NotInList;
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::Status) : nullptr;
 
   return queue_item ? *queue_item->status : my_info_->status;
 }
 
 bool Item::GetMyPrivate() const {
-  if (!my_info_.get())
+  if (!my_info_)
     return false;
 
   return my_info_->is_private;
 }
 
 int Item::GetMyRewatchedTimes(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return 0;
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::RewatchedTimes) : nullptr;
 
   return queue_item ? *queue_item->rewatched_times : my_info_->rewatched_times;
 }
 
 bool Item::GetMyRewatching(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return false;
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::Rewatching) : nullptr;
 
   return queue_item ? *queue_item->enable_rewatching : my_info_->rewatching;
 }
 
 int Item::GetMyRewatchingEp() const {
-  if (!my_info_.get())
+  if (!my_info_)
     return 0;
 
   return my_info_->rewatching_ep;
 }
 
 const Date& Item::GetMyDateStart(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return EmptyDate();
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::DateStart) : nullptr;
 
   return queue_item ? *queue_item->date_start : my_info_->date_start;
 }
 
 const Date& Item::GetMyDateEnd(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return EmptyDate();
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::DateEnd) : nullptr;
 
   return queue_item ? *queue_item->date_finish : my_info_->date_finish;
 }
 
 const std::wstring& Item::GetMyLastUpdated() const {
-  if (!my_info_.get())
+  if (!my_info_)
     return EmptyString();
 
   return my_info_->last_updated;
 }
 
 const std::wstring& Item::GetMyNotes(bool check_queue) const {
-  if (!my_info_.get())
+  if (!my_info_)
     return EmptyString();
 
-  library::QueueItem* queue_item = check_queue ?
+  const library::QueueItem* queue_item = check_queue ?
       SearchQueue(library::QueueSearch::Notes) : nullptr;
 
   return queue_item ? *queue_item->notes : my_info_->notes;
@@ -439,55 +495,55 @@ const std::wstring& Item::GetMyNotes(bool check_queue) const {
 ////////////////////////////////////////////////////////////////////////////////
 
 void Item::SetMyId(const std::wstring& id) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->id = id;
 }
 
 void Item::SetMyLastWatchedEpisode(int number) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->watched_episodes = std::clamp(number, 0, kMaxEpisodeCount);
 }
 
 void Item::SetMyScore(int score) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->score = score;
 }
 
 void Item::SetMyStatus(MyStatus status) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->status = status;
 }
 
 void Item::SetMyPrivate(bool is_private) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->is_private = is_private;
 }
 
 void Item::SetMyRewatchedTimes(int rewatched_times) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->rewatched_times = rewatched_times;
 }
 
 void Item::SetMyRewatching(bool rewatching) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->rewatching = rewatching;
 }
 
 void Item::SetMyRewatchingEp(int rewatching_ep) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->rewatching_ep = rewatching_ep;
 }
 
 void Item::SetMyDateStart(const Date& date) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->date_start = date;
 }
@@ -497,7 +553,7 @@ void Item::SetMyDateStart(const std::wstring& date) {
 }
 
 void Item::SetMyDateEnd(const Date& date) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->date_finish = date;
 }
@@ -507,13 +563,13 @@ void Item::SetMyDateEnd(const std::wstring& date) {
 }
 
 void Item::SetMyLastUpdated(const std::wstring& last_updated) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->last_updated = last_updated;
 }
 
 void Item::SetMyNotes(const std::wstring& notes) {
-  assert(my_info_.get());
+  assert(my_info_);
 
   my_info_->notes = notes;
 }
@@ -522,7 +578,7 @@ void Item::SetMyNotes(const std::wstring& notes) {
 ////////////////////////////////////////////////////////////////////////////////
 
 int Item::GetAvailableEpisodeCount() const {
-  return static_cast<int>(local_info_.available_episodes.size());
+  return static_cast<int>(available_episodes_.size());
 }
 
 std::wstring Item::GetFolder() const {
@@ -549,10 +605,10 @@ bool Item::SetEpisodeAvailability(int number, bool available,
     number = 1;
 
   if (number <= GetEpisodeCount() || !IsValidEpisodeCount(GetEpisodeCount())) {
-    if (static_cast<size_t>(number) > local_info_.available_episodes.size()) {
-      local_info_.available_episodes.resize(number);
+    if (static_cast<size_t>(number) > available_episodes_.size()) {
+      available_episodes_.resize(number);
     }
-    local_info_.available_episodes.at(number - 1) = available;
+    available_episodes_.set(number - 1, available);
     if (number == GetMyLastWatchedEpisode() + 1) {
       SetNextEpisodePath(path);
     }
@@ -588,6 +644,7 @@ void Item::SetUserSynonyms(std::vector<std::wstring> synonyms) {
   RemoveEmptyStrings(synonyms);
 
   taiga::settings.SetAnimeUserSynonyms(GetId(), synonyms);
+  db.OnItemChange(GetId());
 
   if (!synonyms.empty() && CurrentEpisode.anime_id == anime::ID_NOTINLIST) {
     CurrentEpisode.Set(anime::ID_UNKNOWN);
@@ -599,10 +656,10 @@ void Item::SetUserSynonyms(std::vector<std::wstring> synonyms) {
 bool Item::IsEpisodeAvailable(int number) const {
   if (number < 1)
     number = 1;
-  if (static_cast<size_t>(number) > local_info_.available_episodes.size())
+  if (static_cast<size_t>(number) > available_episodes_.size())
     return false;
 
-  return local_info_.available_episodes.at(number - 1);
+  return available_episodes_.test(number - 1);
 }
 
 bool Item::IsNextEpisodeAvailable() const {
@@ -613,25 +670,60 @@ bool Item::IsNextEpisodeAvailable() const {
 ////////////////////////////////////////////////////////////////////////////////
 
 void Item::AddtoUserList() {
-  if (!my_info_.get()) {
-    my_info_.reset(new MyInformation);
+  if (!my_info_) {
+    my_info_.emplace();
   }
 }
 
 bool Item::IsInList() const {
-  return my_info_.get() && GetMyStatus() != MyStatus::NotInList;
+  return my_info_ && GetMyStatus() != MyStatus::NotInList;
 }
 
 void Item::RemoveFromUserList() {
-  assert(my_info_.use_count() <= 1);
   my_info_.reset();
-  assert(my_info_.use_count() == 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-library::QueueItem* Item::SearchQueue(library::QueueSearch search_mode) const {
-  return library::queue.FindItem(GetId(), search_mode);
+size_t Item::EpisodeAvailability::size() const {
+  return size_;
+}
+
+void Item::EpisodeAvailability::resize(size_t size) {
+  // Episodes beyond the new size are cleared, so that they are not available
+  // again if the size grows back.
+  for (size_t i = size; i < std::min(size_, kInlineSize); ++i) {
+    inline_.reset(i);
+  }
+
+  overflow_.resize(size > kInlineSize ? size - kInlineSize : 0);
+  size_ = size;
+}
+
+bool Item::EpisodeAvailability::test(size_t index) const {
+  if (index >= size_)
+    return false;
+
+  return index < kInlineSize ? inline_.test(index)
+                             : overflow_[index - kInlineSize];
+}
+
+void Item::EpisodeAvailability::set(size_t index, bool available) {
+  if (index >= size_)
+    resize(index + 1);
+
+  if (index < kInlineSize) {
+    inline_.set(index, available);
+  } else {
+    overflow_[index - kInlineSize] = available;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const library::QueueItem* Item::SearchQueue(
+    library::QueueSearch search_mode) const {
+  return library::queue.FindPendingChange(GetId(), search_mode);
 }
 
 }  // namespace anime
@@ -18,10 +18,12 @@
 
 #pragma once
 
+#include <bitset>
+#include <optional>
 #include <string>
 #include <vector>
-#include <memory>
 
+#include "base/string_pool.h"
 #include "media/anime.h"
 
 class Date;
@@ -57,11 +59,11 @@ public:
   const Date& GetDateEnd() const;
   const std::wstring& GetImageUrl() const;
   AgeRating GetAgeRating() const;
-  const std::vector<std::wstring>& GetGenres() const;
-  const std::vector<std::wstring>& GetTags() const;
+  base::StringPool::View GetGenres() const;
+  base::StringPool::View GetTags() const;
   int GetPopularity() const;
-  const std::vector<std::wstring>& GetProducers() const;
-  const std::vector<std::wstring>& GetStudios() const;
+  base::StringPool::View GetProducers() const;
+  base::StringPool::View GetStudios() const;
   double GetScore() const;
   const std::wstring& GetSynopsis() const;
   const std::wstring& GetTrailerId() const;
@@ -104,6 +106,12 @@ public:
   void SetLastAiredEpisodeNumber(int number);
   void SetNextEpisodeTime(const time_t time);
 
+  // Genres, tags, producers and studios are interned in a shared pool
+  const std::vector<base::StringPool::id_t>& GetGenreIds() const;
+  const std::vector<base::StringPool::id_t>& GetTagIds() const;
+  const std::vector<base::StringPool::id_t>& GetProducerIds() const;
+  const std::vector<base::StringPool::id_t>& GetStudioIds() const;
+
   //////////////////////////////////////////////////////////////////////////////
   // Library data
 
@@ -162,18 +170,42 @@ public:
   void RemoveFromUserList();
 
 private:
-  // Helper function
-  library::QueueItem* SearchQueue(library::QueueSearch search_mode) const;
+  // Availability of episodes, stored inline for all but the longest series
+  class EpisodeAvailability {
+  public:
+    size_t size() const;
+    void resize(size_t size);
+    bool test(size_t index) const;
+    void set(size_t index, bool available);
+
+  private:
+    static constexpr size_t kInlineSize = 64;
+    std::bitset<kInlineSize> inline_;
+    std::vector<bool> overflow_;
+    size_t size_ = 0;
+  };
+
+  // Helper functions
+  void MarkDirty() const;
+  const library::QueueItem* SearchQueue(
+      library::QueueSearch search_mode) const;
 
   // Series information, stored in db\anime.xml
   SeriesInformation series_;
+  std::vector<base::StringPool::id_t> genres_;
+  std::vector<base::StringPool::id_t> producers_;
+  std::vector<base::StringPool::id_t> studios_;
+  std::vector<base::StringPool::id_t> tags_;
 
   // User information, stored in user\<username>\anime.xml - some items are not
   // in user's list, thus this member is not valid for every item.
-  std::shared_ptr<MyInformation> my_info_;
+  std::optional<MyInformation> my_info_;
 
   // Local information, stored temporarily
   LocalInformation local_info_;
+  EpisodeAvailability available_episodes_;
 };
 
+inline base::StringPool metadata_strings;
+
 }  // namespace anime
@@ -0,0 +1,302 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+
+#include "media/anime_search.h"
+
+#include "base/log.h"
+#include "base/string.h"
+#include "media/anime_db.h"
+#include "media/anime_util.h"
+
+namespace anime {
+
+// Words that are shorter than this are not indexed
+constexpr size_t kMinWordLength = 2;
+
+// Words that only match as a prefix are ranked lower than whole words
+constexpr float kPrefixMatchWeight = 0.5f;
+
+static std::vector<std::wstring> GetWords(const std::wstring& text) {
+  std::vector<std::wstring> words;
+  std::wstring word;
+
+  const auto add_word = [&words, &word]() {
+    if (word.size() >= kMinWordLength)
+      words.push_back(word);
+    word.clear();
+  };
+
+  for (const auto c : text) {
+    if (std::iswalnum(c)) {
+      word.push_back(static_cast<wchar_t>(std::towlower(c)));
+    } else {
+      add_word();
+    }
+  }
+  add_word();
+
+  return words;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SearchIndex::~SearchIndex() {
+  WaitForBuild();
+}
+
+void SearchIndex::Build() {
+  WaitForBuild();
+
+  // Documents are collected here, because items cannot be accessed from
+  // another thread.
+  std::vector<Document> documents;
+  documents.reserve(db.items.size());
+  for (const auto& [id, item] : db.items) {
+    documents.push_back(GetDocument(item));
+  }
+
+  changed_items_.clear();
+  list_changed_ = false;
+  building_ = true;
+
+  thread_ = std::thread([this, documents = std::move(documents)]() {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    Index index;
+    for (const auto& document : documents) {
+      index.Add(document);
+    }
+
+    size_t posting_count = 0;
+    for (const auto& [word, postings] : index.postings) {
+      posting_count += postings.size();
+    }
+    const size_t word_count = index.postings.size();
+
+    {
+      std::lock_guard lock{mutex_};
+      index_ = std::move(index);
+    }
+
+    building_ = false;
+    ++generation_;
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time);
+    LOGD(L"Indexed {} items, {} words and {} postings in {} ms.",
+         documents.size(), word_count, posting_count, elapsed.count());
+  });
+}
+
+void SearchIndex::WaitForBuild() {
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void SearchIndex::OnItemChange(const int anime_id) {
+  changed_items_.insert(anime_id);
+  folded_fields_.erase(anime_id);
+}
+
+void SearchIndex::OnListChange() {
+  list_changed_ = true;
+  folded_fields_.clear();
+}
+
+std::vector<int> SearchIndex::Search(const std::wstring& text) {
+  ApplyChanges();
+
+  const auto words = GetWords(text);
+  if (words.empty())
+    return {};
+
+  std::unordered_map<int, float> scores;
+
+  {
+    std::lock_guard lock{mutex_};
+
+    for (size_t i = 0; i < words.size(); ++i) {
+      const auto& word = words[i];
+      std::unordered_map<int, float> word_scores;
+
+      for (auto it = index_.postings.lower_bound(word);
+           it != index_.postings.end() && StartsWith(it->first, word); ++it) {
+        const float weight =
+            it->first.size() == word.size() ? 1.0f : kPrefixMatchWeight;
+        for (const auto& [anime_id, score] : it->second) {
+          word_scores[anime_id] += score * weight;
+        }
+      }
+
+      // Items must contain every word of the text
+      if (i == 0) {
+        scores = std::move(word_scores);
+      } else {
+        for (auto it = scores.begin(); it != scores.end(); ) {
+          const auto word_score = word_scores.find(it->first);
+          if (word_score == word_scores.end()) {
+            it = scores.erase(it);
+          } else {
+            it->second += word_score->second;
+            ++it;
+          }
+        }
+      }
+
+      if (scores.empty())
+        break;
+    }
+  }
+
+  std::vector<std::pair<int, float>> results{scores.begin(), scores.end()};
+  std::sort(results.begin(), results.end(),
+            [](const auto& a, const auto& b) {
+              return a.second != b.second ? a.second > b.second
+                                          : a.first < b.first;
+            });
+
+  std::vector<int> anime_ids;
+  anime_ids.reserve(results.size());
+  for (const auto& [anime_id, score] : results) {
+    anime_ids.push_back(anime_id);
+  }
+
+  return anime_ids;
+}
+
+unsigned int SearchIndex::generation() const {
+  return generation_;
+}
+
+const SearchIndex::FoldedFields& SearchIndex::GetFoldedFields(
+    const Item& item) {
+  const auto [it, inserted] = folded_fields_.try_emplace(item.GetId());
+  auto& fields = it->second;
+
+  if (inserted) {
+    GetAllTitles(item.GetId(), fields.titles);
+    for (auto& title : fields.titles) {
+      ToLower(title);
+    }
+    fields.notes = ToLower_Copy(item.GetMyNotes());
+  }
+
+  return fields;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SearchIndex::Document SearchIndex::GetDocument(const Item& item) {
+  Document document;
+  document.anime_id = item.GetId();
+
+  const auto add_field = [&document](const std::wstring& text,
+                                     const float weight) {
+    if (!text.empty())
+      document.fields.emplace_back(text, weight);
+  };
+
+  std::vector<std::wstring> titles;
+  GetAllTitles(item.GetId(), titles);
+  for (const auto& title : titles) {
+    add_field(title, 5.0f);
+  }
+
+  for (const auto& tag : item.GetTags()) {
+    add_field(tag, 2.0f);
+  }
+  for (const auto& studio : item.GetStudios()) {
+    add_field(studio, 2.0f);
+  }
+  add_field(item.GetMyNotes(), 2.0f);
+  add_field(item.GetSynopsis(), 1.0f);
+
+  return document;
+}
+
+void SearchIndex::ApplyChanges() {
+  // Changes are held back while the index is being built, and applied to the
+  // new index once it is complete.
+  if (building_)
+    return;
+
+  if (list_changed_) {
+    Build();
+    return;
+  }
+
+  if (changed_items_.empty())
+    return;
+
+  std::vector<Document> documents;
+  for (const auto anime_id : changed_items_) {
+    if (const auto item = db.Find(anime_id, false)) {
+      documents.push_back(GetDocument(*item));
+    }
+  }
+
+  {
+    std::lock_guard lock{mutex_};
+    for (const auto anime_id : changed_items_) {
+      index_.Remove(anime_id);
+    }
+    for (const auto& document : documents) {
+      index_.Add(document);
+    }
+  }
+
+  changed_items_.clear();
+  ++generation_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SearchIndex::Index::Add(const Document& document) {
+  auto& item_words = words[document.anime_id];
+
+  for (const auto& [text, weight] : document.fields) {
+    for (auto& word : GetWords(text)) {
+      postings[word][document.anime_id] += weight;
+      item_words.insert(std::move(word));
+    }
+  }
+}
+
+void SearchIndex::Index::Remove(const int anime_id) {
+  const auto it = words.find(anime_id);
+  if (it == words.end())
+    return;
+
+  for (const auto& word : it->second) {
+    const auto posting = postings.find(word);
+    if (posting != postings.end()) {
+      posting->second.erase(anime_id);
+      if (posting->second.empty())
+        postings.erase(posting);
+    }
+  }
+
+  words.erase(it);
+}
+
+}  // namespace anime
@@ -0,0 +1,100 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace anime {
+
+class Item;
+
+// Inverted index of the words in titles, synopses, tags, studios and notes.
+class SearchIndex {
+public:
+  ~SearchIndex();
+
+  // Builds the index on another thread. Until it is complete, searches use
+  // the previous index.
+  void Build();
+
+  // Blocks until the index that is being built is complete
+  void WaitForBuild();
+
+  void OnItemChange(const int anime_id);
+  void OnListChange();
+
+  // Updates the index with the items that changed since the last call. The
+  // generation changes if there were any.
+  void ApplyChanges();
+
+  // Returns the IDs of the items that contain all words of the text, either
+  // as a whole word or as a prefix, ordered by relevance.
+  std::vector<int> Search(const std::wstring& text);
+
+  // Incremented whenever the index changes, so that callers can tell if their
+  // results are outdated
+  unsigned int generation() const;
+
+  // Lowercase titles and notes of an item, for substring matching. These are
+  // kept until the item changes.
+  struct FoldedFields {
+    std::vector<std::wstring> titles;
+    std::wstring notes;
+  };
+  const FoldedFields& GetFoldedFields(const Item& item);
+
+private:
+  struct Document {
+    int anime_id = 0;
+    std::vector<std::pair<std::wstring, float>> fields;
+  };
+
+  struct Index {
+    // Sorted by word, so that the words beginning with a prefix are adjacent
+    std::map<std::wstring, std::unordered_map<int, float>> postings;
+    std::unordered_map<int, std::set<std::wstring>> words;
+
+    void Add(const Document& document);
+    void Remove(const int anime_id);
+  };
+
+  static Document GetDocument(const Item& item);
+
+  Index index_;
+  std::mutex mutex_;
+  std::thread thread_;
+  std::atomic<bool> building_ = false;
+  std::atomic<unsigned int> generation_ = 0;
+
+  std::set<int> changed_items_;
+  bool list_changed_ = false;
+
+  std::unordered_map<int, FoldedFields> folded_fields_;
+};
+
+inline SearchIndex search_index;
+
+}  // namespace anime
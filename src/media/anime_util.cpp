@@ -172,7 +172,7 @@ bool MetadataNeedsRefresh(const Item& item) {
 
   if (item.GetSynopsis().empty())
     return true;
-  if (item.GetGenres().empty())
+  if (item.GetGenreIds().empty())
     return true;
   if (item.GetScore() == kUnknownScore && IsAiredYet(item))
     return true;
@@ -187,7 +187,8 @@ bool IsNsfw(const Item& item) {
     return true;
 
   if (item.GetAgeRating() == anime::AgeRating::Unknown) {
-    if (nstd::contains(item.GetGenres(), std::wstring{L"Hentai"}))
+    static const auto hentai = metadata_strings.Intern(L"Hentai");
+    if (nstd::contains(item.GetGenreIds(), hentai))
       return true;
   }
 
@@ -619,8 +620,7 @@ std::wstring NormalizeSynopsis(std::wstring str) {
   while (ReplaceString(str, L"\n\n\n", L"\n\n"));
   ReplaceString(str, L"\n", L"\r\n");
 
-  DecodeHtmlEntities(str);
-  StripHtmlTags(str);
+  DecodeHtmlEntitiesAndStripTags(str);
 
   return str;
 }
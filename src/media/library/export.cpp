@@ -17,12 +17,21 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <execution>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include "media/library/export.h"
 
 #include "base/file.h"
 #include "base/format.h"
+#include "base/json.h"
 #include "base/log.h"
 #include "base/string.h"
 #include "base/time.h"
@@ -32,140 +41,492 @@
 #include "media/anime_util.h"
 #include "media/library/queue.h"
 #include "sync/myanimelist_util.h"
+#include "sync/service.h"
 #include "taiga/settings.h"
 #include "taiga/version.h"
+#include "ui/dialog.h"
 #include "ui/translate.h"
 
 namespace library {
 
-bool ExportAsMalXml(const std::wstring& path) {
-  constexpr auto count_total_anime = []() {
-    int count = 0;
-    for (const auto& [id, item] : anime::db.items) {
-      if (item.IsInList()) {
-        count += 1;
+namespace {
+
+// A copy of the list data that is needed for exporting, so that entries can be
+// formatted in parallel without touching the database.
+struct ExportEntry {
+  int id = 0;
+  std::wstring mal_id;
+  std::wstring kitsu_id;
+  std::wstring anilist_id;
+  std::wstring title;
+  std::wstring preferred_title;
+  anime::SeriesType type = anime::SeriesType::Unknown;
+  int episode_count = 0;
+  int watched_episodes = 0;
+  int score = 0;
+  anime::MyStatus status = anime::MyStatus::NotInList;
+  Date date_start;
+  Date date_end;
+  int rewatched_times = 0;
+  bool rewatching = false;
+  int rewatching_ep = 0;
+  std::wstring notes;
+  bool queued = false;
+};
+
+struct ExportList {
+  std::vector<ExportEntry> entries;
+  std::map<anime::MyStatus, int> status_counts;
+};
+
+// Formats the entry at the given index. Must be safe to call from any thread.
+using EntryFormatter = std::function<std::string(size_t index)>;
+
+}  // namespace
+
+// Collects the entries and their status counts in a single pass over the
+// database. Entries are sorted by ID, so that the output is deterministic.
+static ExportList GetExportList() {
+  ExportList list;
+
+  for (const auto& [id, item] : anime::db.items) {
+    if (!item.IsInList())
+      continue;
+
+    auto& entry = list.entries.emplace_back();
+    entry.id = id;
+    entry.mal_id = item.GetId(sync::ServiceId::MyAnimeList);
+    entry.kitsu_id = item.GetId(sync::ServiceId::Kitsu);
+    entry.anilist_id = item.GetId(sync::ServiceId::AniList);
+    entry.title = item.GetTitle();
+    entry.preferred_title = anime::GetPreferredTitle(item);
+    entry.type = item.GetType();
+    entry.episode_count = item.GetEpisodeCount();
+    entry.watched_episodes = item.GetMyLastWatchedEpisode();
+    entry.score = item.GetMyScore();
+    entry.status = item.GetMyStatus();
+    entry.date_start = item.GetMyDateStart();
+    entry.date_end = item.GetMyDateEnd();
+    entry.rewatched_times = item.GetMyRewatchedTimes();
+    entry.rewatching = item.GetMyRewatching();
+    entry.rewatching_ep = item.GetMyRewatchingEp();
+    entry.notes = item.GetMyNotes();
+    entry.queued = library::queue.IsQueued(id);
+
+    list.status_counts[entry.status] += 1;
+  }
+
+  std::sort(list.entries.begin(), list.entries.end(),
+            [](const ExportEntry& a, const ExportEntry& b) {
+              return a.id < b.id;
+            });
+
+  return list;
+}
+
+// Entries are formatted in parallel one batch at a time, and each batch is
+// written to disk in order before the next one is formatted. This keeps memory
+// usage bounded regardless of the size of the list.
+static bool WriteExport(const std::wstring& path, const std::string& header,
+                        const size_t count, const EntryFormatter& format_entry,
+                        const std::string& footer,
+                        const ExportProgress& progress) {
+  constexpr size_t kBatchSize = 500;
+
+  const auto start_time = std::chrono::steady_clock::now();
+
+  enum class Stage { Header, Entries, Footer, Done };
+  Stage stage = Stage::Header;
+  size_t exported = 0;
+  size_t bytes = 0;
+  std::vector<std::string> lines;
+  std::string batch;
+
+  const auto next_chunk = [&](std::string_view& chunk) {
+    switch (stage) {
+      case Stage::Header:
+        chunk = header;
+        stage = count ? Stage::Entries : Stage::Footer;
+        break;
+
+      case Stage::Entries: {
+        const size_t offset = exported;
+        lines.resize(std::min(kBatchSize, count - offset));
+        std::for_each(std::execution::par, lines.begin(), lines.end(),
+                      [&](std::string& line) {
+                        line = format_entry(offset + (&line - lines.data()));
+                      });
+
+        batch.clear();
+        for (const auto& line : lines) {
+          batch += line;
+        }
+        chunk = batch;
+
+        exported += lines.size();
+        if (exported == count)
+          stage = Stage::Footer;
+        if (progress)
+          progress(exported, count);
+        break;
       }
-    }
-    return count;
-  };
 
-  constexpr auto tr_series_type = [](anime::SeriesType type) {
-    switch (type) {
-      default:
-      case anime::SeriesType::Unknown: return L"Unknown";
-      case anime::SeriesType::Tv: return L"TV";
-      case anime::SeriesType::Ova: return L"OVA";
-      case anime::SeriesType::Movie: return L"Movie";
-      case anime::SeriesType::Special: return L"Special";
-      case anime::SeriesType::Ona: return L"ONA";
-      case anime::SeriesType::Music: return L"Music";
-    }
-  };
+      case Stage::Footer:
+        chunk = footer;
+        stage = Stage::Done;
+        break;
 
-  constexpr auto tr_my_status = [](anime::MyStatus status) {
-    switch (status) {
-      default:
-      case anime::MyStatus::Watching: return L"Watching";
-      case anime::MyStatus::Completed: return L"Completed";
-      case anime::MyStatus::OnHold: return L"On-Hold";
-      case anime::MyStatus::Dropped: return L"Dropped";
-      case anime::MyStatus::PlanToWatch: return L"Plan to Watch";
+      case Stage::Done:
+        return false;
     }
+
+    bytes += chunk.size();
+    return true;
   };
 
-  XmlDocument document;
+  if (!SaveChunksToFile(next_chunk, path)) {
+    LOGE(L"Could not export list to: {}", path);
+    return false;
+  }
 
-  auto node_decl = document.prepend_child(pugi::node_declaration);
-  node_decl.append_attribute(L"version") = L"1.0";
-  node_decl.append_attribute(L"encoding") = L"UTF-8";
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time);
+  LOGD(L"Exported {} entries, {} bytes in {} ms: {}", count, bytes,
+       duration.count(), path);
 
-  auto node_comment = document.append_child(pugi::node_comment);
-  node_comment.set_value(L" Generated by Taiga v{} on {} {} "_format(
-      StrToWstr(taiga::version().to_string()),
-      GetDate().to_string(),
-      GetTime()).c_str());
+  return true;
+}
 
-  auto node_myanimelist = document.append_child(L"myanimelist");
+////////////////////////////////////////////////////////////////////////////////
 
-  auto node_myinfo = node_myanimelist.append_child(L"myinfo");
-  XmlWriteInt(node_myinfo, L"user_id", 0);
-  XmlWriteStr(node_myinfo, L"user_name", taiga::GetCurrentUsername());
-  XmlWriteInt(node_myinfo, L"user_export_type", 1);  // anime
-  XmlWriteInt(node_myinfo, L"user_total_anime", count_total_anime());
-  XmlWriteInt(node_myinfo, L"user_total_watching", anime::db.GetItemCount(anime::MyStatus::Watching));
-  XmlWriteInt(node_myinfo, L"user_total_completed", anime::db.GetItemCount(anime::MyStatus::Completed));
-  XmlWriteInt(node_myinfo, L"user_total_onhold", anime::db.GetItemCount(anime::MyStatus::OnHold));
-  XmlWriteInt(node_myinfo, L"user_total_dropped", anime::db.GetItemCount(anime::MyStatus::Dropped));
-  XmlWriteInt(node_myinfo, L"user_total_plantowatch", anime::db.GetItemCount(anime::MyStatus::PlanToWatch));
+static std::thread export_thread;
+static std::atomic<bool> exporting = false;
 
-  for (const auto& [id, item] : anime::db.items) {
-    if (item.IsInList()) {
-      const auto mal_id = ToInt(item.GetId(sync::ServiceId::MyAnimeList));
-      if (!mal_id) {
-        LOGW(L"MAL ID unavailable for #{} ({})", id, item.GetTitle());
-        continue;
+static HWND callback_window = nullptr;
+static std::vector<std::function<void()>> callbacks;
+static std::mutex callbacks_mutex;
+
+static void PostExportCallback(std::function<void()> callback) {
+  {
+    std::lock_guard lock{callbacks_mutex};
+    callbacks.push_back(std::move(callback));
+  }
+  ::PostMessage(callback_window, WM_EXPORTCALLBACK, 0, 0);
+}
+
+// Everything that is passed here must be owned by the caller, as the export
+// continues on another thread after this function returns.
+static bool StartExport(const std::wstring& path, const std::string& header,
+                        const size_t count, const EntryFormatter& format_entry,
+                        const std::string& footer,
+                        const ExportProgress& on_progress,
+                        const ExportCallback& on_complete) {
+  if (exporting) {
+    LOGW(L"Another export is still in progress.");
+    return false;
+  }
+
+  WaitForExport();
+
+  exporting = true;
+  callback_window = ui::GetWindowHandle(ui::Dialog::Main);
+
+  export_thread = std::thread([path, header, count, format_entry, footer,
+                               on_progress, on_complete]() {
+    const auto progress = [&on_progress](size_t exported, size_t total) {
+      if (on_progress) {
+        PostExportCallback([on_progress, exported, total]() {
+          on_progress(exported, total);
+        });
       }
+    };
 
-      auto node = node_myanimelist.append_child(L"anime");
-      XmlWriteInt(node, L"series_animedb_id", mal_id);
-      XmlWriteStr(node, L"series_title", item.GetTitle(), pugi::node_cdata);
-      XmlWriteStr(node, L"series_type", tr_series_type(item.GetType()));
-      XmlWriteInt(node, L"series_episodes", item.GetEpisodeCount());
-
-      XmlWriteInt(node, L"my_id", 0);
-      XmlWriteInt(node, L"my_watched_episodes", item.GetMyLastWatchedEpisode());
-      XmlWriteStr(node, L"my_start_date", item.GetMyDateStart().to_string());
-      XmlWriteStr(node, L"my_finish_date", item.GetMyDateEnd().to_string());
-      XmlWriteStr(node, L"my_fansub_group", L"", pugi::node_cdata);
-      XmlWriteStr(node, L"my_rated", L"");
-      XmlWriteInt(node, L"my_score", sync::myanimelist::TranslateMyRatingTo(item.GetMyScore()));
-      XmlWriteStr(node, L"my_dvd", L"");
-      XmlWriteStr(node, L"my_storage", L"");
-      XmlWriteStr(node, L"my_status", tr_my_status(item.GetMyStatus()));
-      XmlWriteStr(node, L"my_comments", item.GetMyNotes(), pugi::node_cdata);
-      XmlWriteInt(node, L"my_times_watched", item.GetMyRewatchedTimes());
-      XmlWriteStr(node, L"my_rewatch_value", L"");
-      XmlWriteInt(node, L"my_downloaded_eps", 0);
-      XmlWriteStr(node, L"my_tags", L"");
-      XmlWriteInt(node, L"my_rewatching", item.GetMyRewatching());
-      XmlWriteInt(node, L"my_rewatching_ep", item.GetMyRewatchingEp());
-      XmlWriteInt(node, L"update_on_import", library::queue.IsQueued(item.GetId()));
+    const bool success =
+        WriteExport(path, header, count, format_entry, footer, progress);
+
+    exporting = false;
+
+    if (on_complete) {
+      PostExportCallback([on_complete, success]() { on_complete(success); });
     }
+  });
+
+  return true;
+}
+
+void ProcessExportCallbacks() {
+  std::vector<std::function<void()>> pending_callbacks;
+
+  {
+    std::lock_guard lock{callbacks_mutex};
+    std::swap(pending_callbacks, callbacks);
   }
 
-  return XmlSaveDocumentToFile(document, path);
+  for (const auto& callback : pending_callbacks) {
+    callback();
+  }
 }
 
-bool ExportAsMarkdown(const std::wstring& path) {
-  std::map<anime::MyStatus, std::vector<std::wstring>> status_lists;
+void WaitForExport() {
+  if (export_thread.joinable())
+    export_thread.join();
+}
 
-  for (const auto& [id, item] : anime::db.items) {
-    if (item.IsInList()) {
-      status_lists[item.GetMyStatus()].push_back(L"{} ({}/{})"_format(
-          anime::GetPreferredTitle(item),
-          item.GetMyLastWatchedEpisode(),
-          ui::TranslateNumber(item.GetEpisodeCount(), L"?")));
-    }
+////////////////////////////////////////////////////////////////////////////////
+
+static std::wstring GetGeneratorInfo() {
+  return L"Taiga v{} on {} {}"_format(StrToWstr(taiga::version().to_string()),
+                                      GetDate().to_string(), GetTime());
+}
+
+static std::string EscapeCsvField(const std::wstring& str) {
+  auto field = WstrToStr(str);
+  if (field.find_first_of(",\"\r\n") == field.npos)
+    return field;
+
+  std::string escaped = "\"";
+  for (const auto c : field) {
+    if (c == '"')
+      escaped += '"';
+    escaped += c;
   }
+  escaped += '"';
+  return escaped;
+}
 
-  for (auto& [status, list] : status_lists) {
-    std::sort(list.begin(), list.end(),
-              [](const std::wstring& a, const std::wstring& b) {
-                return CompareStrings(a, b, true) < 0;
-              });
+static const wchar_t* TranslateMalSeriesType(anime::SeriesType type) {
+  switch (type) {
+    default:
+    case anime::SeriesType::Unknown: return L"Unknown";
+    case anime::SeriesType::Tv: return L"TV";
+    case anime::SeriesType::Ova: return L"OVA";
+    case anime::SeriesType::Movie: return L"Movie";
+    case anime::SeriesType::Special: return L"Special";
+    case anime::SeriesType::Ona: return L"ONA";
+    case anime::SeriesType::Music: return L"Music";
   }
+}
+
+static const wchar_t* TranslateMalMyStatus(anime::MyStatus status) {
+  switch (status) {
+    default:
+    case anime::MyStatus::Watching: return L"Watching";
+    case anime::MyStatus::Completed: return L"Completed";
+    case anime::MyStatus::OnHold: return L"On-Hold";
+    case anime::MyStatus::Dropped: return L"Dropped";
+    case anime::MyStatus::PlanToWatch: return L"Plan to Watch";
+  }
+}
 
-  std::wstring text;
-  for (const auto& [status, list] : status_lists) {
-    if (!text.empty())
-      text += L"\r\n";
-    text += L"# {}\r\n\r\n"_format(ui::TranslateMyStatus(status, true));
-    for (const auto& line : list) {
-      text += L"- {}\r\n"_format(line);
+////////////////////////////////////////////////////////////////////////////////
+
+bool ExportAsCsv(const std::wstring& path, const ExportProgress& on_progress,
+                 const ExportCallback& on_complete) {
+  const auto list = std::make_shared<ExportList>(GetExportList());
+
+  const std::string header =
+      "id,myanimelist_id,kitsu_id,anilist_id,title,type,episodes,"
+      "watched_episodes,score,status,date_start,date_end,rewatched_times,"
+      "rewatching,notes\r\n";
+
+  const auto format_entry = [list](size_t index) {
+    const auto& entry = list->entries[index];
+    return "{},{},{},{},{},{},{},{},{},{},{},{},{},{},{}\r\n"_format(
+        entry.id,
+        EscapeCsvField(entry.mal_id),
+        EscapeCsvField(entry.kitsu_id),
+        EscapeCsvField(entry.anilist_id),
+        EscapeCsvField(entry.title),
+        WstrToStr(TranslateMalSeriesType(entry.type)),
+        entry.episode_count,
+        entry.watched_episodes,
+        entry.score,
+        WstrToStr(TranslateMalMyStatus(entry.status)),
+        WstrToStr(entry.date_start.to_string()),
+        WstrToStr(entry.date_end.to_string()),
+        entry.rewatched_times,
+        entry.rewatching ? 1 : 0,
+        EscapeCsvField(entry.notes));
+  };
+
+  return StartExport(path, header, list->entries.size(), format_entry, "",
+                     on_progress, on_complete);
+}
+
+bool ExportAsJson(const std::wstring& path, const ExportProgress& on_progress,
+                  const ExportCallback& on_complete) {
+  const auto list = std::make_shared<ExportList>(GetExportList());
+
+  Json status_counts = Json::object();
+  for (const auto& [status, count] : list->status_counts) {
+    status_counts[WstrToStr(TranslateMalMyStatus(status))] = count;
+  }
+
+  const std::string header = "{{\n"
+      "  \"generator\": {},\n"
+      "  \"user_name\": {},\n"
+      "  \"service\": {},\n"
+      "  \"status_counts\": {},\n"
+      "  \"anime\": [\n"_format(
+          Json(WstrToStr(GetGeneratorInfo())).dump(),
+          Json(WstrToStr(taiga::GetCurrentUsername())).dump(),
+          Json(WstrToStr(sync::GetCurrentServiceSlug())).dump(),
+          status_counts.dump());
+
+  const auto format_entry = [list](size_t index) {
+    const auto& entry = list->entries[index];
+    const Json json = {
+      {"id", entry.id},
+      {"ids", {
+        {WstrToStr(sync::GetServiceSlugById(sync::ServiceId::MyAnimeList)),
+         WstrToStr(entry.mal_id)},
+        {WstrToStr(sync::GetServiceSlugById(sync::ServiceId::Kitsu)),
+         WstrToStr(entry.kitsu_id)},
+        {WstrToStr(sync::GetServiceSlugById(sync::ServiceId::AniList)),
+         WstrToStr(entry.anilist_id)},
+      }},
+      {"title", WstrToStr(entry.title)},
+      {"type", WstrToStr(TranslateMalSeriesType(entry.type))},
+      {"episodes", entry.episode_count},
+      {"watched_episodes", entry.watched_episodes},
+      {"score", entry.score},
+      {"status", WstrToStr(TranslateMalMyStatus(entry.status))},
+      {"date_start", WstrToStr(entry.date_start.to_string())},
+      {"date_end", WstrToStr(entry.date_end.to_string())},
+      {"rewatched_times", entry.rewatched_times},
+      {"rewatching", entry.rewatching},
+      {"notes", WstrToStr(entry.notes)},
+    };
+    return "{}    {}"_format(index ? ",\n" : "", json.dump());
+  };
+
+  return StartExport(path, header, list->entries.size(), format_entry,
+                     list->entries.empty() ? "  ]\n}\n" : "\n  ]\n}\n",
+                     on_progress, on_complete);
+}
+
+bool ExportAsMalXml(const std::wstring& path, const ExportProgress& on_progress,
+                    const ExportCallback& on_complete) {
+  const auto list = std::make_shared<ExportList>(GetExportList());
+
+  std::erase_if(list->entries, [](const ExportEntry& entry) {
+    if (!ToInt(entry.mal_id)) {
+      LOGW(L"MAL ID unavailable for #{} ({})", entry.id, entry.title);
+      return true;
     }
+    return false;
+  });
+
+  // Counts include the entries without a MAL ID, as they always have
+  const auto total_count = [&list]() {
+    int count = 0;
+    for (const auto& [status, status_count] : list->status_counts) {
+      count += status_count;
+    }
+    return count;
+  };
+  const auto status_count = [&list](anime::MyStatus status) {
+    const auto it = list->status_counts.find(status);
+    return it != list->status_counts.end() ? it->second : 0;
+  };
+
+  std::string header;
+  {
+    XmlDocument document;
+
+    auto node_decl = document.prepend_child(pugi::node_declaration);
+    node_decl.append_attribute(L"version") = L"1.0";
+    node_decl.append_attribute(L"encoding") = L"UTF-8";
+
+    auto node_comment = document.append_child(pugi::node_comment);
+    node_comment.set_value(
+        L" Generated by {} "_format(GetGeneratorInfo()).c_str());
+
+    header = XmlPrint(document);
+
+    auto node_myinfo = document.append_child(L"myinfo");
+    XmlWriteInt(node_myinfo, L"user_id", 0);
+    XmlWriteStr(node_myinfo, L"user_name", taiga::GetCurrentUsername());
+    XmlWriteInt(node_myinfo, L"user_export_type", 1);  // anime
+    XmlWriteInt(node_myinfo, L"user_total_anime", total_count());
+    XmlWriteInt(node_myinfo, L"user_total_watching", status_count(anime::MyStatus::Watching));
+    XmlWriteInt(node_myinfo, L"user_total_completed", status_count(anime::MyStatus::Completed));
+    XmlWriteInt(node_myinfo, L"user_total_onhold", status_count(anime::MyStatus::OnHold));
+    XmlWriteInt(node_myinfo, L"user_total_dropped", status_count(anime::MyStatus::Dropped));
+    XmlWriteInt(node_myinfo, L"user_total_plantowatch", status_count(anime::MyStatus::PlanToWatch));
+
+    header += "<myanimelist>\n" + XmlPrint(node_myinfo, 1);
   }
 
-  return SaveToFile(WstrToStr(text), path, false);
+  const auto format_entry = [list](size_t index) {
+    const auto& entry = list->entries[index];
+
+    XmlDocument document;
+    auto node = document.append_child(L"anime");
+    XmlWriteInt(node, L"series_animedb_id", ToInt(entry.mal_id));
+    XmlWriteStr(node, L"series_title", entry.title, pugi::node_cdata);
+    XmlWriteStr(node, L"series_type", TranslateMalSeriesType(entry.type));
+    XmlWriteInt(node, L"series_episodes", entry.episode_count);
+
+    XmlWriteInt(node, L"my_id", 0);
+    XmlWriteInt(node, L"my_watched_episodes", entry.watched_episodes);
+    XmlWriteStr(node, L"my_start_date", entry.date_start.to_string());
+    XmlWriteStr(node, L"my_finish_date", entry.date_end.to_string());
+    XmlWriteStr(node, L"my_fansub_group", L"", pugi::node_cdata);
+    XmlWriteStr(node, L"my_rated", L"");
+    XmlWriteInt(node, L"my_score", sync::myanimelist::TranslateMyRatingTo(entry.score));
+    XmlWriteStr(node, L"my_dvd", L"");
+    XmlWriteStr(node, L"my_storage", L"");
+    XmlWriteStr(node, L"my_status", TranslateMalMyStatus(entry.status));
+    XmlWriteStr(node, L"my_comments", entry.notes, pugi::node_cdata);
+    XmlWriteInt(node, L"my_times_watched", entry.rewatched_times);
+    XmlWriteStr(node, L"my_rewatch_value", L"");
+    XmlWriteInt(node, L"my_downloaded_eps", 0);
+    XmlWriteStr(node, L"my_tags", L"");
+    XmlWriteInt(node, L"my_rewatching", entry.rewatching);
+    XmlWriteInt(node, L"my_rewatching_ep", entry.rewatching_ep);
+    XmlWriteInt(node, L"update_on_import", entry.queued);
+
+    return XmlPrint(node, 1);
+  };
+
+  return StartExport(path, header, list->entries.size(), format_entry,
+                     "</myanimelist>\n", on_progress, on_complete);
+}
+
+bool ExportAsMarkdown(const std::wstring& path,
+                      const ExportProgress& on_progress,
+                      const ExportCallback& on_complete) {
+  const auto list = std::make_shared<ExportList>(GetExportList());
+
+  std::stable_sort(list->entries.begin(), list->entries.end(),
+                   [](const ExportEntry& a, const ExportEntry& b) {
+                     if (a.status != b.status)
+                       return a.status < b.status;
+                     return CompareStrings(a.preferred_title,
+                                           b.preferred_title, true) < 0;
+                   });
+
+  // Each entry that starts a new status begins with the section heading
+  const auto format_entry = [list](size_t index) {
+    const auto& entry = list->entries[index];
+
+    std::wstring text;
+    if (!index || list->entries[index - 1].status != entry.status) {
+      if (index)
+        text += L"\r\n";
+      text += L"# {}\r\n\r\n"_format(ui::TranslateMyStatus(entry.status, true));
+    }
+    text += L"- {} ({}/{})\r\n"_format(
+        entry.preferred_title,
+        entry.watched_episodes,
+        ui::TranslateNumber(entry.episode_count, L"?"));
+
+    return WstrToStr(text);
+  };
+
+  return StartExport(path, "", list->entries.size(), format_entry, "",
+                     on_progress, on_complete);
 }
 
 }  // namespace library
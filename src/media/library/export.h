@@ -18,11 +18,35 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 
+#include <windows.h>
+
 namespace library {
 
-bool ExportAsMalXml(const std::wstring& path);
-bool ExportAsMarkdown(const std::wstring& path);
+// Posted to the main window when export callbacks are ready to be processed
+constexpr unsigned int WM_EXPORTCALLBACK = WM_APP + 0x34;
+
+// Callbacks are called on the main thread, after each batch of entries is
+// written to disk, and once the export is complete.
+using ExportProgress = std::function<void(size_t exported, size_t total)>;
+using ExportCallback = std::function<void(bool success)>;
+
+// The list is copied on the calling thread, and then written to disk on
+// another thread. Returns false if another export is still in progress.
+bool ExportAsCsv(const std::wstring& path, const ExportProgress& on_progress,
+                 const ExportCallback& on_complete);
+bool ExportAsJson(const std::wstring& path, const ExportProgress& on_progress,
+                  const ExportCallback& on_complete);
+bool ExportAsMalXml(const std::wstring& path,
+                    const ExportProgress& on_progress,
+                    const ExportCallback& on_complete);
+bool ExportAsMarkdown(const std::wstring& path,
+                      const ExportProgress& on_progress,
+                      const ExportCallback& on_complete);
+
+void ProcessExportCallbacks();
+void WaitForExport();
 
 }  // namespace library
@@ -16,10 +16,14 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include <semaver.hpp>
 
 #include "media/library/history.h"
 
+#include "base/file.h"
+#include "base/format.h"
 #include "base/log.h"
 #include "base/string.h"
 #include "base/xml.h"
@@ -31,6 +35,24 @@
 
 namespace library {
 
+// Items that are added between saves are appended to a journal next to the
+// history file, which is merged into the file on the next save.
+static std::wstring GetJournalPath(const std::wstring& path) {
+  return path + L".journal";
+}
+
+void History::AddItem(const HistoryItem& item) {
+  items.push_back(item);
+  if (limit > 0 && static_cast<int>(items.size()) > limit) {
+    items.erase(items.begin());
+  }
+
+  const auto path = taiga::GetPath(taiga::Path::UserHistory);
+  AppendToFile(WstrToStr(L"{}\t{}\t{}\n"_format(item.anime_id, item.episode,
+                                                  item.time)),
+               GetJournalPath(path));
+}
+
 void History::Clear(bool save) {
   items.clear();
 
@@ -43,13 +65,16 @@ void History::Clear(bool save) {
 bool History::Load() {
   items.clear();
   queue.items.clear();
+  queue.RebuildIndex();
 
   XmlDocument document;
   const auto path = taiga::GetPath(taiga::Path::UserHistory);
   const auto parse_result = XmlLoadFileToDocument(document, path);
 
-  if (!parse_result)
+  if (!parse_result) {
+    ReadJournal(path);
     return false;
+  }
 
   // Meta
   const auto meta_version = XmlReadMetaVersion(document);
@@ -71,6 +96,8 @@ bool History::Load() {
            history_item.anime_id, history_item.episode, history_item.time);
     }
   }
+  // Journal
+  ReadJournal(path);
   // Queue events
   ReadQueue(document);
   HandleCompatibility(meta_version);
@@ -78,6 +105,44 @@ bool History::Load() {
   return true;
 }
 
+void History::ReadJournal(const std::wstring& path) {
+  std::string journal;
+  if (!ReadFromFile(GetJournalPath(path), journal))
+    return;
+
+  std::vector<std::wstring> lines;
+  Split(StrToWstr(journal), L"\n", lines);
+
+  for (const auto& line : lines) {
+    std::vector<std::wstring> fields;
+    Split(line, L"\t", fields);
+    if (fields.size() != 3)
+      continue;
+
+    HistoryItem history_item;
+    history_item.anime_id = ToInt(fields[0]);
+    history_item.episode = ToInt(fields[1]);
+    history_item.time = fields[2];
+
+    // Items may have been saved to the file before the journal was removed
+    const auto is_same_item = [&history_item](const HistoryItem& item) {
+      return item.anime_id == history_item.anime_id &&
+             item.episode == history_item.episode &&
+             item.time == history_item.time;
+    };
+    if (std::any_of(items.begin(), items.end(), is_same_item))
+      continue;
+
+    if (anime::db.Find(history_item.anime_id)) {
+      items.push_back(history_item);
+    }
+  }
+
+  if (limit > 0 && static_cast<int>(items.size()) > limit) {
+    items.erase(items.begin(), items.end() - limit);
+  }
+}
+
 void History::ReadQueue(const XmlDocument& document) {
   auto node_queue = document.child(L"history").child(L"queue");
 
@@ -121,6 +186,10 @@ void History::ReadQueue(const XmlDocument& document) {
 }
 
 bool History::Save() {
+  return SaveToFile(taiga::GetPath(taiga::Path::UserHistory));
+}
+
+bool History::SaveToFile(const std::wstring& path) {
   XmlDocument document;
 
   // Write meta
@@ -164,8 +233,13 @@ bool History::Save() {
     #undef APPEND_ATTRIBUTE
   }
 
-  const auto path = taiga::GetPath(taiga::Path::UserHistory);
-  return XmlSaveDocumentToFile(document, path);
+  if (!XmlSaveDocumentToFile(document, path))
+    return false;
+
+  // Journal items are now a part of the file
+  ::DeleteFile(GetJournalPath(path).c_str());
+
+  return true;
 }
 
 }  // namespace library
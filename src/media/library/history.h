@@ -33,9 +33,11 @@ struct HistoryItem {
 
 class History {
 public:
+  void AddItem(const HistoryItem& item);
   void Clear(bool save = true);
   bool Load();
   bool Save();
+  bool SaveToFile(const std::wstring& path);
 
   void HandleCompatibility(const std::wstring& meta_version);
 
@@ -43,6 +45,7 @@ public:
   int limit = 0;  // 0 for unlimited
 
 private:
+  void ReadJournal(const std::wstring& path);
   void ReadQueue(const XmlDocument& document);
 };
 
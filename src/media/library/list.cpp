@@ -25,7 +25,9 @@
 #include "media/library/queue.h"
 #include "sync/service.h"
 #include "taiga/path.h"
+#include "taiga/persistence.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "taiga/version.h"
 #include "ui/ui.h"
 
@@ -50,6 +52,10 @@ bool Database::LoadList() {
 
   const auto meta_version = XmlReadMetaVersion(document);
 
+  auto node_meta = document.child(L"meta");
+  list_watermark = ToTime(XmlReadStr(node_meta, L"watermark"));
+  list_full_sync_time = ToTime(XmlReadStr(node_meta, L"full_sync"));
+
   auto node_database = document.child(L"database");
   ReadDatabaseNode(node_database);
 
@@ -79,6 +85,12 @@ bool Database::LoadList() {
 }
 
 bool Database::SaveList(bool include_database) const {
+  return SaveListToFile(taiga::GetPath(taiga::Path::UserLibrary),
+                        include_database);
+}
+
+bool Database::SaveListToFile(const std::wstring& path,
+                              bool include_database) const {
   if (items.empty())
     return false;
 
@@ -86,6 +98,10 @@ bool Database::SaveList(bool include_database) const {
 
   XmlWriteMetaVersion(document, StrToWstr(taiga::version().to_string()));
 
+  auto node_meta = XmlChild(document, L"meta");
+  XmlWriteStr(node_meta, L"watermark", ToWstr(list_watermark));
+  XmlWriteStr(node_meta, L"full_sync", ToWstr(list_full_sync_time));
+
   if (include_database) {
     WriteDatabaseNode(XmlChild(document, L"database"));
   }
@@ -111,44 +127,15 @@ bool Database::SaveList(bool include_database) const {
     }
   }
 
-  const auto path = taiga::GetPath(taiga::Path::UserLibrary);
   return XmlSaveDocumentToFile(document, path);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// @TODO: Move to util
 int Database::GetItemCount(MyStatus status, bool check_history) {
-  int count = 0;
-
-  // Get current count
-  for (const auto& [id, item] : items) {
-    if (item.GetMyRewatching()) {
-      if (status == MyStatus::Watching)
-        ++count;
-    } else {
-      if (status == item.GetMyStatus(false))
-        ++count;
-    }
-  }
-
-  // Search queued items for status changes
-  if (check_history) {
-    for (const auto& queue_item : library::queue.items) {
-      if (queue_item.status ||
-          queue_item.mode == library::QueueItemMode::Delete) {
-        if (queue_item.status && status == *queue_item.status) {
-          ++count;
-        } else {
-          auto anime_item = Find(queue_item.anime_id);
-          if (anime_item && status == anime_item->GetMyStatus(false))
-            --count;
-        }
-      }
-    }
-  }
-
-  return count;
+  // Counts are maintained by statistics, which only recalculates the items
+  // that have changed since the last call.
+  return taiga::stats.GetStatusCount(status, check_history);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -179,6 +166,7 @@ void Database::AddToList(int anime_id, MyStatus status) {
                                               anime::MyStatus::PlanToWatch;
 
   anime_item->AddtoUserList();
+  db.OnItemChange(anime_id);
 
   library::QueueItem queue_item;
   queue_item.anime_id = anime_id;
@@ -192,8 +180,8 @@ void Database::AddToList(int anime_id, MyStatus status) {
   queue_item.mode = library::QueueItemMode::Add;
   library::queue.Add(queue_item);
 
-  SaveDatabase();
-  SaveList();
+  taiga::persistence.MarkDirty(taiga::Store::Database);
+  taiga::persistence.MarkDirty(taiga::Store::List);
 
   ui::OnLibraryEntryAdd(anime_id);
 
@@ -205,6 +193,11 @@ void Database::ClearUserData() {
   for (auto& [id, item] : items) {
     item.RemoveFromUserList();
   }
+
+  list_watermark = 0;
+  list_full_sync_time = 0;
+
+  db.OnListChange();
 }
 
 bool Database::DeleteListItem(int anime_id) {
@@ -216,6 +209,7 @@ bool Database::DeleteListItem(int anime_id) {
     return false;
 
   anime_item->RemoveFromUserList();
+  db.OnItemChange(anime_id);
 
   ui::ChangeStatusText(L"Item deleted. (" +
                        anime::GetPreferredTitle(*anime_item) + L")");
@@ -261,6 +255,8 @@ void Database::UpdateItem(const library::QueueItem& queue_item) {
       break;
   }
 
+  db.OnItemChange(queue_item.anime_id);
+
   ui::OnLibraryEntryChange(queue_item.anime_id);
 }
 
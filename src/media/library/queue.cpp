@@ -16,6 +16,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <set>
+
 #include "media/library/queue.h"
 
 #include "base/log.h"
@@ -25,7 +27,9 @@
 #include "media/library/history.h"
 #include "sync/sync.h"
 #include "taiga/announce.h"
+#include "taiga/persistence.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "track/media.h"
 #include "track/scanner.h"
 #include "ui/ui.h"
@@ -59,6 +63,48 @@ static void ValidateQueueItem(QueueItem& item, const anime::Item& anime_item) {
       item.date_finish.reset();
 }
 
+static bool HasValue(const QueueItem& item, const QueueSearch search_mode) {
+  switch (search_mode) {
+    case QueueSearch::DateStart:
+      return item.date_start.has_value();
+    case QueueSearch::DateEnd:
+      return item.date_finish.has_value();
+    case QueueSearch::Episode:
+      return item.episode.has_value();
+    case QueueSearch::Notes:
+      return item.notes.has_value();
+    case QueueSearch::RewatchedTimes:
+      return item.rewatched_times.has_value();
+    case QueueSearch::Rewatching:
+      return item.enable_rewatching.has_value();
+    case QueueSearch::Score:
+      return item.score.has_value();
+    case QueueSearch::Status:
+      return item.status.has_value();
+    default:
+      return false;
+  }
+}
+
+static void CoalesceQueueItem(QueueItem& item, const QueueItem& next_item) {
+  if (next_item.episode)
+    item.episode = next_item.episode;
+  if (next_item.status)
+    item.status = next_item.status;
+  if (next_item.score)
+    item.score = next_item.score;
+  if (next_item.date_start)
+    item.date_start = next_item.date_start;
+  if (next_item.date_finish)
+    item.date_finish = next_item.date_finish;
+  if (next_item.enable_rewatching)
+    item.enable_rewatching = next_item.enable_rewatching;
+  if (next_item.rewatched_times)
+    item.rewatched_times = next_item.rewatched_times;
+  if (next_item.notes)
+    item.notes = next_item.notes;
+}
+
 void Queue::Add(QueueItem& item, bool save) {
   const auto anime_item = anime::db.Find(item.anime_id);
 
@@ -127,9 +173,11 @@ void Queue::Add(QueueItem& item, bool save) {
     items.push_back(item);
   }
 
+  UpdateIndex(item.anime_id);
+
   if (anime_item && save) {
     // Save
-    history.Save();
+    taiga::persistence.MarkDirty(taiga::Store::History);
 
     // Announce
     if (item.episode) {
@@ -185,27 +233,92 @@ void Queue::Check(bool automatic) {
   }
 
   updating = true;
+  sending_.clear();
 
-  switch (queue_item.mode) {
-    case QueueItemMode::Add:
-      sync::AddLibraryEntry(queue_item);
-      break;
-    case QueueItemMode::Delete:
-      sync::DeleteLibraryEntry(queue_item.anime_id);
-      break;
-    case QueueItemMode::Update:
-      sync::UpdateLibraryEntry(queue_item);
+  if (queue_item.mode == QueueItemMode::Delete) {
+    sending_count_ = 1;
+    sending_[queue_item.anime_id] = std::nullopt;
+    sync::DeleteLibraryEntry(queue_item.anime_id);
+    return;
+  }
+
+  // Leading additions and updates are sent together, with the items of each
+  // anime coalesced into a single entry, so that their order is preserved.
+  std::vector<QueueItem> batch;
+  std::map<int, size_t> batch_indexes;
+
+  sending_count_ = 0;
+  for (const auto& item : items) {
+    if (!item.enabled || item.mode == QueueItemMode::Delete ||
+        !anime::db.Find(item.anime_id)) {
       break;
+    }
+    if (const auto it = batch_indexes.find(item.anime_id);
+        it != batch_indexes.end()) {
+      CoalesceQueueItem(batch.at(it->second), item);
+    } else {
+      if (batch.size() == kMaxBatchSize)
+        break;
+      batch_indexes[item.anime_id] = batch.size();
+      batch.push_back(item);
+      sending_[item.anime_id] = std::nullopt;
+    }
+    ++sending_count_;
   }
+
+  sync::UpdateLibraryEntries(batch);
+}
+
+void Queue::OnResponse(int anime_id, bool success) {
+  const auto it = sending_.find(anime_id);
+  if (it == sending_.end() || it->second.has_value())
+    return;
+
+  it->second = success;
+
+  for (const auto& [id, result] : sending_) {
+    if (!result)
+      return;
+  }
+
+  // All results are in; items that have failed are kept for the next attempt
+  bool failed = false;
+  size_t index = 0;
+  for (size_t i = 0; i < sending_count_ && index < items.size(); ++i) {
+    const auto& queue_item = items.at(index);
+    const auto result = sending_.find(queue_item.anime_id);
+    if (result != sending_.end() && *result->second) {
+      anime::db.UpdateItem(queue_item);
+      Remove(static_cast<int>(index), false, true, true);
+    } else {
+      failed = true;
+      ++index;
+    }
+  }
+
+  sending_count_ = 0;
+  sending_.clear();
+
+  taiga::persistence.MarkDirty(taiga::Store::List);
+  taiga::persistence.MarkDirty(taiga::Store::History);
+
+  updating = false;
+
+  if (!failed)
+    Check(false);
 }
 
 void Queue::Clear(bool save) {
   items.clear();
+  for (const auto& [anime_id, pending_change] : pending_changes_) {
+    anime::db.OnItemChange(anime_id);
+  }
+  pending_changes_.clear();
 
   ui::OnHistoryChange();
 
   if (save)
-    history.Save();
+    taiga::persistence.MarkDirty(taiga::Store::History);
 }
 
 void Queue::Merge(bool save) {
@@ -217,8 +330,8 @@ void Queue::Merge(bool save) {
   ui::OnHistoryChange();
 
   if (save) {
-    history.Save();
-    anime::db.SaveList();
+    taiga::persistence.MarkDirty(taiga::Store::History);
+    taiga::persistence.MarkDirty(taiga::Store::List);
   }
 }
 
@@ -231,32 +344,13 @@ bool Queue::IsQueued(int anime_id) const {
 }
 
 QueueItem* Queue::FindItem(int anime_id, QueueSearch search_mode) {
-  const auto has_value = [&search_mode](const QueueItem& item) {
-    switch (search_mode) {
-      case QueueSearch::DateStart:
-        return item.date_start.has_value();
-      case QueueSearch::DateEnd:
-        return item.date_finish.has_value();
-      case QueueSearch::Episode:
-        return item.episode.has_value();
-      case QueueSearch::Notes:
-        return item.notes.has_value();
-      case QueueSearch::RewatchedTimes:
-        return item.rewatched_times.has_value();
-      case QueueSearch::Rewatching:
-        return item.enable_rewatching.has_value();
-      case QueueSearch::Score:
-        return item.score.has_value();
-      case QueueSearch::Status:
-        return item.status.has_value();
-      default:
-        return false;
-    }
-  };
+  if (!FindPendingChange(anime_id, search_mode))
+    return nullptr;
 
   for (auto it = items.rbegin(); it != items.rend(); ++it) {
-    auto& item = *it; 
-    if (item.anime_id == anime_id && item.enabled && has_value(item)) {
+    auto& item = *it;
+    if (item.anime_id == anime_id && item.enabled &&
+        HasValue(item, search_mode)) {
       return &item;
     }
   }
@@ -264,6 +358,15 @@ QueueItem* Queue::FindItem(int anime_id, QueueSearch search_mode) {
   return nullptr;
 }
 
+const QueueItem* Queue::FindPendingChange(int anime_id,
+                                          QueueSearch search_mode) const {
+  const auto it = pending_changes_.find(anime_id);
+  if (it != pending_changes_.end() && HasValue(it->second, search_mode))
+    return &it->second;
+
+  return nullptr;
+}
+
 QueueItem* Queue::GetCurrentItem() {
   if (!items.empty())
     return &items.front();
@@ -292,11 +395,7 @@ void Queue::Remove(int index, bool save, bool refresh, bool to_history) {
       history_item.anime_id = queue_item.anime_id;
       history_item.episode = *queue_item.episode;
       history_item.time = queue_item.time;
-      history.items.push_back(history_item);
-      if (history.limit > 0 &&
-          static_cast<int>(history.items.size()) > history.limit) {
-        history.items.erase(history.items.begin());
-      }
+      history.AddItem(history_item);
     }
 
     if (queue_item.episode) {
@@ -309,13 +408,14 @@ void Queue::Remove(int index, bool save, bool refresh, bool to_history) {
     }
 
     items.erase(it);
+    UpdateIndex(queue_item.anime_id);
 
     if (refresh)
       ui::OnHistoryChange(&queue_item);
   }
 
   if (save)
-    history.Save();
+    taiga::persistence.MarkDirty(taiga::Store::History);
 }
 
 void Queue::RemoveDisabled(bool save, bool refresh) {
@@ -329,11 +429,59 @@ void Queue::RemoveDisabled(bool save, bool refresh) {
     }
   }
 
+  if (needs_refresh)
+    RebuildIndex();
+
   if (refresh && needs_refresh)
     ui::OnHistoryChange();
 
   if (save)
-    history.Save();
+    taiga::persistence.MarkDirty(taiga::Store::History);
+}
+
+void Queue::RebuildIndex() {
+  // Only the items that had or have pending changes are affected
+  std::set<int> anime_ids;
+  for (const auto& [anime_id, pending_change] : pending_changes_) {
+    anime_ids.insert(anime_id);
+  }
+
+  pending_changes_.clear();
+
+  for (const auto& item : items) {
+    if (item.enabled) {
+      auto& pending_change = pending_changes_[item.anime_id];
+      pending_change.anime_id = item.anime_id;
+      CoalesceQueueItem(pending_change, item);
+      anime_ids.insert(item.anime_id);
+    }
+  }
+
+  for (const auto anime_id : anime_ids) {
+    anime::db.OnItemChange(anime_id);
+  }
+}
+
+void Queue::UpdateIndex(int anime_id) {
+  std::optional<QueueItem> pending_change;
+
+  for (const auto& item : items) {
+    if (item.anime_id == anime_id && item.enabled) {
+      if (!pending_change) {
+        pending_change.emplace();
+        pending_change->anime_id = anime_id;
+      }
+      CoalesceQueueItem(*pending_change, item);
+    }
+  }
+
+  if (pending_change) {
+    pending_changes_[anime_id] = std::move(*pending_change);
+  } else {
+    pending_changes_.erase(anime_id);
+  }
+
+  anime::db.OnItemChange(anime_id);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,9 +18,11 @@
 
 #pragma once
 
+#include <map>
 #include <optional>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/time.h"
@@ -69,15 +71,33 @@ public:
   void Check(bool automatic = true);
   void Clear(bool save = true);
   void Merge(bool save = true);
+  void OnResponse(int anime_id, bool success);
   bool IsQueued(int anime_id) const;
   QueueItem* FindItem(int anime_id, QueueSearch search_mode);
+  const QueueItem* FindPendingChange(int anime_id,
+                                     QueueSearch search_mode) const;
   QueueItem* GetCurrentItem();
   int GetItemCount();
   void Remove(int index = 0, bool save = true, bool refresh = true, bool to_history = true);
   void RemoveDisabled(bool save = true, bool refresh = true);
+  void RebuildIndex();
 
   std::vector<QueueItem> items;
   bool updating = false;
+
+private:
+  void UpdateIndex(int anime_id);
+
+  static constexpr size_t kMaxBatchSize = 10;
+
+  // Effective pending changes for each anime, with the fields of enabled items
+  // merged in order. Must be updated whenever `items` is modified.
+  std::unordered_map<int, QueueItem> pending_changes_;
+
+  // Number of items at the front of the queue that are being sent, and the
+  // result for each anime that they belong to
+  size_t sending_count_ = 0;
+  std::map<int, std::optional<bool>> sending_;
 };
 
 class ConfirmationQueue {
@@ -16,6 +16,16 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <windows/win/string.h>
 
 #include "sync/anilist.h"
@@ -31,6 +41,7 @@
 #include "media/anime_util.h"
 #include "media/library/queue.h"
 #include "sync/anilist_util.h"
+#include "sync/pagination.h"
 #include "sync/sync.h"
 #include "taiga/http.h"
 #include "taiga/settings.h"
@@ -128,18 +139,17 @@ taiga::http::Request BuildRequest() {
   return request;
 }
 
-std::string GetGraphQlQuery(const std::wstring_view gql) {
-  const auto get_query = [](const std::wstring_view gql) {
-    std::wstring query;
-    win::ReadStringFromResource(gql.data(), L"DATA", query);
-    return query;
-  };
-
-  std::wstring query = get_query(gql);
+std::wstring ReadGraphQlQuery(const std::wstring_view gql) {
+  std::wstring query;
+  win::ReadStringFromResource(gql.data(), L"DATA", query);
+  return query;
+}
 
-  ReplaceString(query, L"{mediaFields}", get_query(L"IDR_ANILIST_MEDIAFIELDS"));
+std::string ExpandGraphQlQuery(std::wstring query) {
+  ReplaceString(query, L"{mediaFields}",
+                ReadGraphQlQuery(L"IDR_ANILIST_MEDIAFIELDS"));
   ReplaceString(query, L"{mediaListFields}",
-                get_query(L"IDR_ANILIST_MEDIALISTFIELDS"));
+                ReadGraphQlQuery(L"IDR_ANILIST_MEDIALISTFIELDS"));
 
   EraseChars(query, L"\r");
   ReplaceChar(query, '\n', ' ');
@@ -149,6 +159,10 @@ std::string GetGraphQlQuery(const std::wstring_view gql) {
   return WstrToStr(query);
 }
 
+std::string GetGraphQlQuery(const std::wstring_view gql) {
+  return ExpandGraphQlQuery(ReadGraphQlQuery(gql));
+}
+
 hypr::Body BuildRequestBody(const std::wstring_view gql,
                             const Json& variables) {
   const Json json{
@@ -208,6 +222,7 @@ int ParseMediaObject(const Json& json) {
     return anime::ID_UNKNOWN;
   }
 
+  const auto batch = anime::db.BatchChanges();
   auto& anime_item = anime::db.items[anime_id];
 
   anime_item.SetSource(ServiceId::AniList);
@@ -377,6 +392,38 @@ bool HasError(const taiga::http::Response& response) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+Json BuildMediaListEntryVariables(const library::QueueItem& queue_item) {
+  Json variables{
+    {"mediaId", queue_item.anime_id},
+  };
+
+  if (const auto anime_item = anime::db.Find(queue_item.anime_id)) {
+    if (const auto library_id = ToInt(anime_item->GetMyId())) {
+      variables["id"] = library_id;
+    }
+  }
+
+  if (queue_item.enable_rewatching && *queue_item.enable_rewatching) {
+    variables["status"] = kRepeatingMediaListStatus;
+  } else if (queue_item.status) {
+    variables["status"] = TranslateMyStatusTo(*queue_item.status);
+  }
+  if (queue_item.score)
+    variables["scoreRaw"] = *queue_item.score;
+  if (queue_item.episode)
+    variables["progress"] = *queue_item.episode;
+  if (queue_item.rewatched_times)
+    variables["repeat"] = *queue_item.rewatched_times;
+  if (queue_item.notes)
+    variables["notes"] = WstrToStr(*queue_item.notes);
+  if (queue_item.date_start)
+    variables["startedAt"] = TranslateFuzzyDateTo(*queue_item.date_start);
+  if (queue_item.date_finish)
+    variables["completedAt"] = TranslateFuzzyDateTo(*queue_item.date_finish);
+
+  return variables;
+}
+
 void AuthenticateUser() {
   auto request = BuildRequest();
   request.set_body(BuildRequestBody(gql::kAuthenticateUser, nullptr));
@@ -416,7 +463,85 @@ void AuthenticateUser() {
   taiga::http::Send(request, on_transfer, on_response);
 }
 
+// MediaListCollection cannot be filtered by modification time, so changed
+// entries are requested page by page, most recently updated first.
+static void GetLibraryEntriesSince(const time_t since, const int page = 1) {
+  const std::wstring query =
+      L"query ($userName: String, $page: Int) {"
+      L"  Page (page: $page, perPage: 50) {"
+      L"    pageInfo { hasNextPage }"
+      L"    mediaList (userName: $userName, type: ANIME,"
+      L"               sort: UPDATED_TIME_DESC) {"
+      L"      ...mediaListFragment"
+      L"    }"
+      L"  }"
+      L"}"
+      L"fragment mediaListFragment on MediaList {"
+      L"  {mediaListFields}"
+      L"  media { ...mediaFragment }"
+      L"}"
+      L"fragment mediaFragment on Media {"
+      L"  {mediaFields}"
+      L"}";
+
+  const Json json{
+    {"query", ExpandGraphQlQuery(query)},
+    {"variables", {
+      {"userName", Account::username()},
+      {"page", page},
+    }},
+  };
+
+  auto request = BuildRequest();
+  request.set_body(hypr::Body{json.dump()});
+
+  const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+    return OnTransfer(RequestType::GetLibraryEntries, transfer,
+                      L"AniList: Retrieving anime list...");
+  };
+
+  const auto on_response = [since, page](
+                               const taiga::http::Response& response) {
+    if (HasError(response)) {
+      sync::OnError(RequestType::GetLibraryEntries);
+      return;
+    }
+
+    Json root;
+
+    if (!JsonParseString(response.body(), root)) {
+      ui::ChangeStatusText(L"AniList: Could not parse anime list.");
+      sync::OnError(RequestType::GetLibraryEntries);
+      return;
+    }
+
+    const auto& page_object = root["data"]["Page"];
+
+    bool reached_watermark = true;
+    for (const auto& value : page_object["mediaList"]) {
+      ParseMediaListObject(value);
+      reached_watermark = JsonReadInt(value, "updatedAt") < since;
+    }
+
+    if (!reached_watermark &&
+        JsonReadBool(page_object["pageInfo"], "hasNextPage")) {
+      GetLibraryEntriesSince(since, page + 1);
+      return;
+    }
+
+    sync::UpdateLibraryWatermark(false);
+    sync::OnResponse(RequestType::GetLibraryEntries);
+  };
+
+  taiga::http::Send(request, on_transfer, on_response);
+}
+
 void GetLibraryEntries() {
+  if (const auto since = sync::GetLibraryWatermark()) {
+    GetLibraryEntriesSince(*since);
+    return;
+  }
+
   const Json variables{
     {"userName", Account::username()},
   };
@@ -435,24 +560,62 @@ void GetLibraryEntries() {
       return;
     }
 
+    // Entries are taken out of the document as soon as they are complete,
+    // and staged until the whole response has been parsed, so that a broken
+    // response cannot leave the list half-replaced. The path to an entry is
+    // data.MediaListCollection.lists[].entries[], and `keys` holds the current
+    // key at each depth.
+    std::vector<std::string> keys;
+    std::vector<Json> entries;
+    bool found_lists = false;
+
+    const auto callback = [&keys, &entries, &found_lists](
+                              int depth, Json::parse_event_t event,
+                              Json& parsed) {
+      const auto is_path = [&keys](const int depth) {
+        return keys.size() >= 3 && keys[0] == "data" &&
+               keys[1] == "MediaListCollection" && keys[2] == "lists" &&
+               (depth == 3 || (keys.size() >= 5 && keys[4] == "entries"));
+      };
+
+      switch (event) {
+        case Json::parse_event_t::key:
+          keys.resize(depth);
+          keys[depth - 1] = parsed.get<std::string>();
+          if (depth == 3 && is_path(depth)) {
+            found_lists = true;
+          }
+          break;
+        case Json::parse_event_t::object_end:
+          if (depth == 6 && is_path(depth)) {
+            entries.push_back(std::move(parsed));
+            return false;
+          }
+          break;
+        default:
+          break;
+      }
+
+      return true;
+    };
+
     Json root;
 
-    if (!JsonParseString(response.body(), root)) {
+    if (!JsonParseString(response.body(), root, callback) ||
+        root.contains("errors")) {
       ui::ChangeStatusText(L"AniList: Could not parse anime list.");
       sync::OnError(RequestType::GetLibraryEntries);
       return;
     }
 
-    anime::db.ClearUserData();
-
-    const auto& lists = root["data"]["MediaListCollection"]["lists"];
-    for (const auto& list : lists) {
-      const auto& entries = list["entries"];
-      for (const auto& entry : entries) {
-        ParseMediaListObject(entry);
-      }
+    if (found_lists) {
+      anime::db.ClearUserData();
+    }
+    for (const auto& entry : entries) {
+      ParseMediaListObject(entry);
     }
 
+    sync::UpdateLibraryWatermark(true);
     sync::OnResponse(RequestType::GetLibraryEntries);
   };
 
@@ -479,7 +642,7 @@ void GetMetadataById(const int id) {
       } else {
         ui::OnLibraryEntryChangeFailure(id);
       }
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
@@ -488,73 +651,185 @@ void GetMetadataById(const int id) {
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"AniList: Could not parse anime data.");
       ui::OnLibraryEntryChangeFailure(id);
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
     const int anime_id = ParseMediaObject(root["data"]["Media"]);
 
     ui::OnLibraryEntryChange(anime_id);
-    sync::OnResponse(RequestType::GetMetadataById);
+    sync::OnResponse(RequestType::GetMetadataById, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
 }
 
-void GetSeason(const anime::Season season, const int page) {
-  const Json variables{
-    {"season", TranslateSeasonTo(ui::TranslateSeasonName(season.name))},
-    {"seasonYear", static_cast<int>(season.year)},
-    {"page", page},
-  };
+static bool ParseSeasonPage(const taiga::http::Response& response,
+                            const int page_number, Pagination& pagination) {
+  Json root;
 
-  auto request = BuildRequest();
-  request.set_body(BuildRequestBody(gql::kGetSeason, variables));
+  if (!JsonParseString(response.body(), root)) {
+    ui::ChangeStatusText(L"AniList: Could not parse season data.");
+    return false;
+  }
 
-  const auto on_transfer = [season](const taiga::http::Transfer& transfer) {
-    return OnTransfer(RequestType::GetSeason, transfer,
-        L"AniList: Retrieving {} anime season..."_format(
-            ui::TranslateSeason(season)));
-  };
+  const auto& page = root["data"]["Page"];
+  const auto& page_info = page["pageInfo"];
 
-  const auto on_response = [season](const taiga::http::Response& response) {
-    if (HasError(response)) {
-      sync::OnError(RequestType::GetSeason);
-      return;
+  if (page_number <= 1) {  // first page
+    anime::season_db.items.clear();
+
+    // Now that we know how many pages there are, the rest can be requested
+    // at once
+    const int last_page = JsonReadInt(page_info, "lastPage");
+    for (int i = page_number + 1; i <= last_page; ++i) {
+      pagination.Add(i);
     }
+  }
 
-    Json root;
+  for (const auto& media : page["media"]) {
+    const auto anime_id = ParseMediaObject(media);
+    anime::season_db.items.push_back(anime_id);
+    ui::OnLibraryEntryChange(anime_id);
+  }
 
-    if (!JsonParseString(response.body(), root)) {
-      ui::ChangeStatusText(L"AniList: Could not parse season data.");
-      sync::OnError(RequestType::GetSeason);
-      return;
-    }
+  if (JsonReadBool(page_info, "hasNextPage")) {
+    pagination.Add(page_number + 1);
+  }
 
-    const auto& page = root["data"]["Page"];
+  return true;
+}
 
-    const auto& page_info = page["pageInfo"];
-    const int current_page = JsonReadInt(page_info, "currentPage");
-    const bool has_next_page = JsonReadBool(page_info, "hasNextPage");
+static void GetSeasonPages(const anime::Season season,
+                           std::shared_ptr<Pagination> pagination) {
+  for (const int page : pagination->Next()) {
+    const Json variables{
+      {"season", TranslateSeasonTo(ui::TranslateSeasonName(season.name))},
+      {"seasonYear", static_cast<int>(season.year)},
+      {"page", page},
+    };
+
+    auto request = BuildRequest();
+    request.set_body(BuildRequestBody(gql::kGetSeason, variables));
+
+    const auto on_transfer = [season](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetSeason, transfer,
+          L"AniList: Retrieving {} anime season..."_format(
+              ui::TranslateSeason(season)));
+    };
+
+    const auto on_response = [season, page, pagination](
+                                 const taiga::http::Response& response) {
+      if (pagination->failed()) {
+        return;
+      }
 
-    if (current_page <= 1) {  // first page
-      anime::season_db.items.clear();
-    }
+      if (HasError(response)) {
+        pagination->Fail();
+        sync::OnError(RequestType::GetSeason);
+        return;
+      }
 
-    for (const auto& media : page["media"]) {
-      const auto anime_id = ParseMediaObject(media);
-      anime::season_db.items.push_back(anime_id);
-      ui::OnLibraryEntryChange(anime_id);
-    }
+      for (const auto& [page_number, page_response] :
+           pagination->Complete(page, response)) {
+        if (!ParseSeasonPage(page_response, page_number, *pagination)) {
+          pagination->Fail();
+          sync::OnError(RequestType::GetSeason);
+          return;
+        }
+      }
 
-    if (has_next_page) {
-      GetSeason(season, current_page + 1);
-    } else {
-      sync::OnResponse(RequestType::GetSeason);
-    }
-  };
+      if (pagination->done()) {
+        sync::OnResponse(RequestType::GetSeason);
+      } else {
+        GetSeasonPages(season, pagination);
+      }
+    };
 
-  taiga::http::Send(request, on_transfer, on_response);
+    taiga::http::Send(request, on_transfer, on_response);
+  }
+}
+
+void GetMetadataByIds(const std::vector<int>& ids) {
+  // Pages are limited to 50 items
+  constexpr size_t kMaxPageSize = 50;
+
+  const std::wstring query =
+      L"query ($ids: [Int], $perPage: Int) {"
+      L"  Page (perPage: $perPage) {"
+      L"    media (id_in: $ids, type: ANIME) {"
+      L"      {mediaFields}"
+      L"    }"
+      L"  }"
+      L"}";
+
+  for (size_t i = 0; i < ids.size(); i += kMaxPageSize) {
+    const std::vector<int> chunk(
+        ids.begin() + i, ids.begin() + std::min(i + kMaxPageSize, ids.size()));
+
+    const Json json{
+      {"query", ExpandGraphQlQuery(query)},
+      {"variables", {
+        {"ids", chunk},
+        {"perPage", chunk.size()},
+      }},
+    };
+
+    auto request = BuildRequest();
+    request.set_body(hypr::Body{json.dump()});
+
+    const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetMetadataById, transfer,
+                        L"AniList: Retrieving anime information...");
+    };
+
+    const auto on_response = [chunk](const taiga::http::Response& response) {
+      const auto on_error = [&chunk]() {
+        sync::OnError(RequestType::GetMetadataById, chunk);
+        for (const int id : chunk) {
+          ui::OnLibraryEntryChangeFailure(id);
+        }
+      };
+
+      if (HasError(response)) {
+        on_error();
+        return;
+      }
+
+      Json root;
+
+      if (!JsonParseString(response.body(), root)) {
+        ui::ChangeStatusText(L"AniList: Could not parse anime data.");
+        on_error();
+        return;
+      }
+
+      std::set<int> received_ids;
+      for (const auto& value : root["data"]["Page"]["media"]) {
+        const int anime_id = ParseMediaObject(value);
+        received_ids.insert(anime_id);
+        ui::OnLibraryEntryChange(anime_id);
+      }
+
+      // Anime that are missing from the response are requested one by one,
+      // so that we can tell whether they still exist
+      for (const int id : chunk) {
+        if (received_ids.contains(id)) {
+          sync::OnResponse(RequestType::GetMetadataById, id);
+        } else {
+          GetMetadataById(id);
+        }
+      }
+    };
+
+    taiga::http::Send(request, on_transfer, on_response);
+  }
+}
+
+void GetSeason(const anime::Season season, const int page) {
+  auto pagination = std::make_shared<Pagination>();
+  pagination->Add(page);
+  GetSeasonPages(season, pagination);
 }
 
 void SearchTitle(const std::wstring& title) {
@@ -624,14 +899,14 @@ void DeleteLibraryEntry(const int id) {
       } else {
         ui::OnLibraryUpdateFailure(id, StrToWstr(response.error().str()),
                                    false);
-        sync::OnError(RequestType::DeleteLibraryEntry);
+        sync::OnError(RequestType::DeleteLibraryEntry, id);
         return;
       }
     }
 
     // Returns: {"data":{"DeleteMediaListEntry":{"deleted":true}}}
 
-    sync::OnResponse(RequestType::DeleteLibraryEntry);
+    sync::OnResponse(RequestType::DeleteLibraryEntry, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
@@ -640,33 +915,7 @@ void DeleteLibraryEntry(const int id) {
 void UpdateLibraryEntry(const library::QueueItem& queue_item) {
   const auto id = queue_item.anime_id;
 
-  Json variables{
-    {"mediaId", queue_item.anime_id},
-  };
-
-  if (const auto anime_item = anime::db.Find(queue_item.anime_id)) {
-    if (const auto library_id = ToInt(anime_item->GetMyId())) {
-      variables["id"] = library_id;
-    }
-  }
-
-  if (queue_item.enable_rewatching && *queue_item.enable_rewatching) {
-    variables["status"] = kRepeatingMediaListStatus;
-  } else if (queue_item.status) {
-    variables["status"] = TranslateMyStatusTo(*queue_item.status);
-  }
-  if (queue_item.score)
-    variables["scoreRaw"] = *queue_item.score;
-  if (queue_item.episode)
-    variables["progress"] = *queue_item.episode;
-  if (queue_item.rewatched_times)
-    variables["repeat"] = *queue_item.rewatched_times;
-  if (queue_item.notes)
-    variables["notes"] = WstrToStr(*queue_item.notes);
-  if (queue_item.date_start)
-    variables["startedAt"] = TranslateFuzzyDateTo(*queue_item.date_start);
-  if (queue_item.date_finish)
-    variables["completedAt"] = TranslateFuzzyDateTo(*queue_item.date_finish);
+  const auto variables = BuildMediaListEntryVariables(queue_item);
 
   auto request = BuildRequest();
   request.set_body(BuildRequestBody(gql::kUpdateLibraryEntry, variables));
@@ -683,7 +932,7 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
         error_description = L"AniList: Anime list entry does not exist.";
       }
       ui::OnLibraryUpdateFailure(id, error_description, false);
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
@@ -691,13 +940,141 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
 
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"AniList: Could not parse anime list entry.");
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
     ParseMediaListObject(root["data"]["SaveMediaListEntry"]);
 
-    sync::OnResponse(RequestType::UpdateLibraryEntry);
+    sync::OnResponse(RequestType::UpdateLibraryEntry, id);
+  };
+
+  taiga::http::Send(request, on_transfer, on_response);
+}
+
+void UpdateLibraryEntries(const std::vector<library::QueueItem>& queue_items) {
+  // AniList allows multiple mutations in a single request, as long as each
+  // one has a unique alias. Variables are prefixed with the same alias.
+  static constexpr std::array<std::pair<std::string_view, std::string_view>, 9>
+      kArguments{{
+        {"id", "Int"},
+        {"mediaId", "Int"},
+        {"status", "MediaListStatus"},
+        {"scoreRaw", "Int"},
+        {"progress", "Int"},
+        {"repeat", "Int"},
+        {"notes", "String"},
+        {"startedAt", "FuzzyDateInput"},
+        {"completedAt", "FuzzyDateInput"},
+      }};
+
+  std::string declarations;
+  std::string mutations;
+  Json variables = Json::object();
+
+  for (size_t i = 0; i < queue_items.size(); ++i) {
+    const auto alias = "m{}"_format(i);
+
+    std::string arguments;
+    for (const auto& [name, type] : kArguments) {
+      if (!declarations.empty())
+        declarations += ", ";
+      declarations += "${}_{}: {}"_format(alias, name, type);
+      if (!arguments.empty())
+        arguments += ", ";
+      arguments += "{}: ${}_{}"_format(name, alias, name);
+    }
+    mutations += "{}: SaveMediaListEntry ({}) "
+                 "{{ {{mediaListFields}} media {{ {{mediaFields}} }} }} "_format(
+                     alias, arguments);
+
+    const auto item_variables = BuildMediaListEntryVariables(queue_items[i]);
+    for (const auto& [name, value] : item_variables.items()) {
+      variables["{}_{}"_format(alias, name)] = value;
+    }
+  }
+
+  const Json json{
+    {"query", ExpandGraphQlQuery(StrToWstr(
+                  "mutation ({}) {{ {}}}"_format(declarations, mutations)))},
+    {"variables", variables},
+  };
+
+  auto request = BuildRequest();
+  request.set_body(hypr::Body{json.dump()});
+
+  const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+    return OnTransfer(RequestType::UpdateLibraryEntry, transfer,
+                      L"AniList: Updating anime list...");
+  };
+
+  const auto on_response = [queue_items](const taiga::http::Response& response) {
+    const auto on_error = [&queue_items](const std::wstring& description) {
+      for (const auto& queue_item : queue_items) {
+        ui::OnLibraryUpdateFailure(queue_item.anime_id, description, false);
+        sync::OnError(RequestType::UpdateLibraryEntry, queue_item.anime_id);
+      }
+    };
+
+    Json root;
+    const bool parsed =
+        !response.error() && JsonParseString(response.body(), root);
+
+    // Mutations that failed are null, and the errors that caused them refer
+    // to their aliases. Others succeed regardless. Errors without an alias,
+    // such as an expired token, fail the whole batch.
+    std::map<std::string, std::wstring> errors;
+    std::wstring batch_error;
+    if (const auto it = root.find("errors");
+        parsed && it != root.end() && it->is_array()) {
+      for (const auto& error : *it) {
+        const auto path = error.find("path");
+        if (path != error.end() && path->is_array() && !path->empty() &&
+            path->front().is_string()) {
+          errors[path->front().get<std::string>()] =
+              StrToWstr(JsonReadStr(error, "message"));
+        } else if (batch_error.empty()) {
+          batch_error = StrToWstr(JsonReadStr(error, "message"));
+          if (batch_error.empty())
+            batch_error = L"Unknown error.";
+        }
+      }
+    }
+
+    if (!parsed || !batch_error.empty() ||
+        (response.status_code() != 200 && errors.empty())) {
+      if (!HasError(response) && !parsed) {
+        ui::ChangeStatusText(L"AniList: Could not parse anime list entries.");
+      }
+      if (response.error()) {
+        on_error(StrToWstr(response.error().str()));
+      } else if (!batch_error.empty()) {
+        on_error(batch_error);
+      } else if (!parsed) {
+        on_error(L"Could not parse anime list entries.");
+      } else {
+        on_error(L"HTTP error {}"_format(response.status_code()));
+      }
+      return;
+    }
+
+    const auto& data = root["data"];
+
+    for (size_t i = 0; i < queue_items.size(); ++i) {
+      const auto alias = "m{}"_format(i);
+      const auto id = queue_items[i].anime_id;
+
+      if (const auto it = data.find(alias);
+          it != data.end() && it->is_object()) {
+        ParseMediaListObject(*it);
+        sync::OnResponse(RequestType::UpdateLibraryEntry, id);
+      } else {
+        const auto error = errors.find(alias);
+        ui::OnLibraryUpdateFailure(
+            id, error != errors.end() ? error->second : L"", false);
+        sync::OnError(RequestType::UpdateLibraryEntry, id);
+      }
+    }
   };
 
   taiga::http::Send(request, on_transfer, on_response);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace anime {
 class Season;
@@ -32,11 +33,13 @@ namespace sync::anilist {
 void AuthenticateUser();
 void GetLibraryEntries();
 void GetMetadataById(const int id);
+void GetMetadataByIds(const std::vector<int>& ids);
 void GetSeason(const anime::Season season, const int page = 1);
 void SearchTitle(const std::wstring& title);
 void AddLibraryEntry(const library::QueueItem& queue_item);
 void DeleteLibraryEntry(const int id);
 void UpdateLibraryEntry(const library::QueueItem& queue_item);
+void UpdateLibraryEntries(const std::vector<library::QueueItem>& queue_items);
 
 bool IsUserAuthenticated();
 void InvalidateUserAuthentication();
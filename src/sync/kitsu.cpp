@@ -16,7 +16,13 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "sync/kitsu.h"
 
@@ -34,6 +40,7 @@
 #include "media/library/queue.h"
 #include "sync/kitsu_types.h"
 #include "sync/kitsu_util.h"
+#include "sync/pagination.h"
 #include "sync/sync.h"
 #include "taiga/http.h"
 #include "taiga/settings.h"
@@ -113,13 +120,6 @@ public:
     authenticated_ = authenticated;
   }
 
-  time_t last_synchronized() const {
-    return last_synchronized_;
-  }
-  void set_last_synchronized(const time_t last_synchronized) {
-    last_synchronized_ = last_synchronized;
-  }
-
   std::string access_token() const {
     return access_token_;
   }
@@ -136,7 +136,6 @@ public:
 
 private:
   bool authenticated_ = false;
-  time_t last_synchronized_ = 0;
   std::string access_token_;
   std::string id_;
 };
@@ -312,6 +311,7 @@ int ParseAnimeObject(const Json& json) {
     return anime::ID_UNKNOWN;
   }
 
+  const auto batch = anime::db.BatchChanges();
   auto& anime_item = anime::db.items[anime_id];
 
   anime_item.SetSource(ServiceId::Kitsu);
@@ -417,6 +417,50 @@ void ParseProducers(const Json& json, const int anime_id) {
   anime_item->SetProducers(producers);
 }
 
+// Categories and producers of an anime are listed in the `included` array,
+// and referred to by their IDs in the relationships of the anime object.
+void ParseRelationships(const Json& json, const Json& included,
+                        const int anime_id) {
+  const auto anime_item = anime::db.Find(anime_id);
+
+  if (!anime_item)
+    return;
+
+  std::map<std::pair<std::string, std::string>, const Json*> objects;
+  for (const auto& value : included) {
+    objects[{JsonReadStr(value, "type"), JsonReadStr(value, "id")}] = &value;
+  }
+
+  const auto find_object = [&objects](const Json& data) -> const Json* {
+    const auto it = objects.find(
+        {JsonReadStr(data, "type"), JsonReadStr(data, "id")});
+    return it != objects.end() ? it->second : nullptr;
+  };
+
+  const auto& relationships = json["relationships"];
+
+  std::vector<std::wstring> categories;
+  for (const auto& data : relationships["categories"]["data"]) {
+    if (const auto category = find_object(data)) {
+      categories.push_back(StrToWstr((*category)["attributes"]["title"]));
+    }
+  }
+
+  std::vector<std::wstring> producers;
+  for (const auto& data : relationships["animeProductions"]["data"]) {
+    if (const auto production = find_object(data)) {
+      const auto& producer_data =
+          (*production)["relationships"]["producer"]["data"];
+      if (const auto producer = find_object(producer_data)) {
+        producers.push_back(StrToWstr((*producer)["attributes"]["name"]));
+      }
+    }
+  }
+
+  anime_item->SetGenres(categories);
+  anime_item->SetProducers(producers);
+}
+
 int ParseLibraryObject(const Json& json) {
   const auto& media = json["relationships"]["anime"];
   const auto& attributes = json["attributes"];
@@ -502,11 +546,6 @@ void ParseObject(const Json& json) {
   }
 }
 
-bool IsPartialLibraryRequest() {
-  return account.last_synchronized() &&
-         taiga::settings.GetSyncServiceKitsuPartialLibrary();
-}
-
 bool HasError(const taiga::http::Response& response) {
   if (response.error()) {
     LOGE(StrToWstr(response.error().str()));
@@ -661,99 +700,142 @@ void GetUser() {
   taiga::http::Send(request, on_transfer, on_response);
 }
 
-void GetLibraryEntries(const int page) {
-  if (account.id().empty()) {
-    ui::ChangeStatusText(
-        L"Kitsu: Cannot get anime list. User ID is unavailable.");
-    sync::OnError(RequestType::GetLibraryEntries);
-    return;
+static void AddRemainingPages(const Json& root, const int page,
+                              const int page_size, Pagination& pagination) {
+  // The link to the last page tells us how many pages there are, so that the
+  // rest can be requested at once
+  if (const auto last_page = GetOffset(root, "last")) {
+    for (int offset = page + page_size; offset <= *last_page;
+         offset += page_size) {
+      pagination.Add(offset);
+    }
   }
-  if (Account::username().empty()) {
-    ui::ChangeStatusText(
-        L"Kitsu: Cannot get anime list. "
-        L"Please set the profile URL for your account.");
-    sync::OnError(RequestType::GetLibraryEntries);
-    return;
+  const auto next_page = GetOffset(root, "next");
+  if (next_page && *next_page > 0) {
+    pagination.Add(*next_page);
   }
+}
 
-  auto request = BuildRequest();
-  request.set_target("{}/edge/library-entries"_format(kBaseUrl));
+static bool ParseLibraryPage(const taiga::http::Response& response,
+                             const int page, const bool partial,
+                             Pagination& pagination) {
+  Json root;
 
-  hypr::Params params;
-  params.add("filter[user_id]", account.id());
-  params.add("filter[kind]", "anime");
-
-  // We don't need to download the entire library; we just need to know about
-  // the entries that have changed since the last download. `filter[since]` is
-  // quite useful in this manner, but note that the following scenario results
-  // in an undesirable behavior:
-  //
-  // 1. Get library entries via client
-  // 2. Go to website and delete entry from library
-  // 3. Get library entries via client, using `filter[since]={...}`
-  // 4. Client doesn't know entry was deleted
-  //
-  // Our "solution" to this is to allow Taiga to download the entire library
-  // after each restart (i.e. last_synchronized is not saved on exit).
-  if (IsPartialLibraryRequest()) {
-    const auto date = GetDate(account.last_synchronized() -
-                              (60 * 60 * 24));  // 1 day before, to be safe
-    params.add("filter[since]", WstrToStr(date.to_string()));
+  if (!JsonParseString(response.body(), root)) {
+    ui::ChangeStatusText(L"Kitsu: Could not parse anime list.");
+    return false;
   }
 
-  params.add("include", "anime");
+  const auto prev_page = GetOffset(root, "prev");
 
-  // We would prefer retrieving the entire library in a single request. However,
-  // Kitsu's server fails to respond in time for large libraries.
-  params.add("page[offset]", ToStr(page));
-  params.add("page[limit]", ToStr(kLibraryMaximumPageSize));
+  if (!partial && !prev_page) {
+    anime::db.ClearUserData();
+  }
 
-  UseSparseFieldsetsForAnime(params, true);
-  UseSparseFieldsetsForLibraryEntries(params);
-  request.set_query(params);
+  for (const auto& value : root["data"]) {
+    ParseLibraryObject(value);
+  }
+  for (const auto& value : root["included"]) {
+    ParseObject(value);
+  }
 
-  const auto on_transfer = [](const taiga::http::Transfer& transfer) {
-    return OnTransfer(RequestType::GetLibraryEntries, transfer,
-                      L"Kitsu: Retrieving anime list...");
-  };
+  AddRemainingPages(root, page, kLibraryMaximumPageSize, pagination);
 
-  const auto on_response = [](const taiga::http::Response& response) {
-    if (HasError(response)) {
-      sync::OnError(RequestType::GetLibraryEntries);
-      return;
+  return true;
+}
+
+static void GetLibraryEntriesPages(std::shared_ptr<Pagination> pagination,
+                                   const std::optional<time_t> since) {
+  for (const int page : pagination->Next()) {
+    auto request = BuildRequest();
+    request.set_target("{}/edge/library-entries"_format(kBaseUrl));
+
+    hypr::Params params;
+    params.add("filter[user_id]", account.id());
+    params.add("filter[kind]", "anime");
+
+    // We don't need to download the entire library; we just need to know
+    // about the entries that have changed since the last download.
+    // `filter[since]` is quite useful in this manner, but note that it cannot
+    // tell us about entries that were deleted on the website. The entire
+    // library is downloaded every once in a while for that reason (see
+    // `sync::GetLibraryWatermark`).
+    if (since) {
+      params.add("filter[since]", WstrToStr(GetDate(*since).to_string()));
     }
 
-    Json root;
+    params.add("include", "anime");
 
-    if (!JsonParseString(response.body(), root)) {
-      ui::ChangeStatusText(L"Kitsu: Could not parse anime list.");
-      sync::OnError(RequestType::GetLibraryEntries);
-      return;
-    }
+    // We would prefer retrieving the entire library in a single request.
+    // However, Kitsu's server fails to respond in time for large libraries.
+    params.add("page[offset]", ToStr(page));
+    params.add("page[limit]", ToStr(kLibraryMaximumPageSize));
 
-    const auto prev_page = GetOffset(root, "prev");
-    const auto next_page = GetOffset(root, "next");
+    UseSparseFieldsetsForAnime(params, true);
+    UseSparseFieldsetsForLibraryEntries(params);
+    request.set_query(params);
 
-    if (!IsPartialLibraryRequest() && !prev_page) {
-      anime::db.ClearUserData();
-    }
+    const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetLibraryEntries, transfer,
+                        L"Kitsu: Retrieving anime list...");
+    };
 
-    for (const auto& value : root["data"]) {
-      ParseLibraryObject(value);
-    }
-    for (const auto& value : root["included"]) {
-      ParseObject(value);
-    }
+    const auto on_response = [page, pagination, since](
+                                 const taiga::http::Response& response) {
+      if (pagination->failed()) {
+        return;
+      }
 
-    if (next_page && *next_page > 0) {
-      GetLibraryEntries(*next_page);
-    } else {
-      account.set_last_synchronized(time(nullptr));  // current time
-      sync::OnResponse(RequestType::GetLibraryEntries);
-    }
-  };
+      if (HasError(response)) {
+        pagination->Fail();
+        sync::OnError(RequestType::GetLibraryEntries);
+        return;
+      }
 
-  taiga::http::Send(request, on_transfer, on_response);
+      for (const auto& [page_number, page_response] :
+           pagination->Complete(page, response)) {
+        if (!ParseLibraryPage(page_response, page_number, since.has_value(),
+                              *pagination)) {
+          pagination->Fail();
+          sync::OnError(RequestType::GetLibraryEntries);
+          return;
+        }
+      }
+
+      if (pagination->done()) {
+        sync::UpdateLibraryWatermark(!since);
+        sync::OnResponse(RequestType::GetLibraryEntries);
+      } else {
+        GetLibraryEntriesPages(pagination, since);
+      }
+    };
+
+    taiga::http::Send(request, on_transfer, on_response);
+  }
+}
+
+void GetLibraryEntries(const int page) {
+  if (account.id().empty()) {
+    ui::ChangeStatusText(
+        L"Kitsu: Cannot get anime list. User ID is unavailable.");
+    sync::OnError(RequestType::GetLibraryEntries);
+    return;
+  }
+  if (Account::username().empty()) {
+    ui::ChangeStatusText(
+        L"Kitsu: Cannot get anime list. "
+        L"Please set the profile URL for your account.");
+    sync::OnError(RequestType::GetLibraryEntries);
+    return;
+  }
+
+  const auto since = taiga::settings.GetSyncServiceKitsuPartialLibrary()
+                         ? sync::GetLibraryWatermark()
+                         : std::nullopt;
+
+  auto pagination = std::make_shared<Pagination>();
+  pagination->Add(page);
+  GetLibraryEntriesPages(pagination, since);
 }
 
 void GetMetadataById(const int id) {
@@ -780,7 +862,7 @@ void GetMetadataById(const int id) {
       } else {
         ui::OnLibraryEntryChangeFailure(id);
       }
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
@@ -789,7 +871,7 @@ void GetMetadataById(const int id) {
     if (!JsonParseString(response.body(), root))  {
       ui::ChangeStatusText(L"Kitsu: Could not parse anime data.");
       ui::OnLibraryEntryChangeFailure(id);
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
@@ -798,74 +880,180 @@ void GetMetadataById(const int id) {
     ParseProducers(root["included"], anime_id);
 
     ui::OnLibraryEntryChange(anime_id);
-    sync::OnResponse(RequestType::GetMetadataById);
+    sync::OnResponse(RequestType::GetMetadataById, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
 }
 
-void GetSeason(const anime::Season season, const int page) {
+static bool ParseSeasonPage(const taiga::http::Response& response,
+                            const int page, Pagination& pagination) {
+  Json root;
+
+  if (!JsonParseString(response.body(), root)) {
+    ui::ChangeStatusText(L"Kitsu: Could not parse season data.");
+    return false;
+  }
+
+  const auto prev_page = GetOffset(root, "prev");
+
+  if (!prev_page) {  // first page
+    anime::season_db.items.clear();
+  }
+
+  for (const auto& value : root["data"]) {
+    const auto anime_id = ParseAnimeObject(value);
+    anime::season_db.items.push_back(anime_id);
+    ui::OnLibraryEntryChange(anime_id);
+  }
+
+  AddRemainingPages(root, page, kJsonApiMaximumPageSize, pagination);
+
+  return true;
+}
+
+static void GetSeasonPages(const anime::Season season,
+                           std::shared_ptr<Pagination> pagination) {
   const auto season_year = static_cast<int>(season.year);
   const auto season_name =
       WstrToStr(ToLower_Copy(ui::TranslateSeasonName(season.name)));
 
-  auto request = BuildRequest();
-  request.set_target("{}/edge/anime"_format(kBaseUrl));
+  for (const int page : pagination->Next()) {
+    auto request = BuildRequest();
+    request.set_target("{}/edge/anime"_format(kBaseUrl));
 
-  hypr::Params params{
-      {"filter[season]", season_name},
-      {"filter[season_year]", ToStr(season_year)},
-      {"page[offset]", ToStr(page)},
-      {"page[limit]", ToStr(kJsonApiMaximumPageSize)}};
+    hypr::Params params{
+        {"filter[season]", season_name},
+        {"filter[season_year]", ToStr(season_year)},
+        {"page[offset]", ToStr(page)},
+        {"page[limit]", ToStr(kJsonApiMaximumPageSize)}};
 
-  // We don't actually need the results to be sorted. But without this
-  // parameter, we get inconsistent ordering and duplicate objects.
-  params.add("sort", "-user_count");
+    // We don't actually need the results to be sorted. But without this
+    // parameter, we get inconsistent ordering and duplicate objects.
+    params.add("sort", "-user_count");
 
-  UseSparseFieldsetsForAnime(params, false);
-  request.set_query(params);
+    UseSparseFieldsetsForAnime(params, false);
+    request.set_query(params);
 
-  const auto on_transfer = [season](const taiga::http::Transfer& transfer) {
-    return OnTransfer(RequestType::GetSeason, transfer,
-        L"Kitsu: Retrieving {} anime season..."_format(
-            ui::TranslateSeason(season)));
-  };
+    const auto on_transfer = [season](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetSeason, transfer,
+          L"Kitsu: Retrieving {} anime season..."_format(
+              ui::TranslateSeason(season)));
+    };
 
-  const auto on_response = [season](const taiga::http::Response& response) {
-    if (HasError(response)) {
-      sync::OnError(RequestType::GetSeason);
-      return;
-    }
+    const auto on_response = [season, page, pagination](
+                                 const taiga::http::Response& response) {
+      if (pagination->failed()) {
+        return;
+      }
 
-    Json root;
+      if (HasError(response)) {
+        pagination->Fail();
+        sync::OnError(RequestType::GetSeason);
+        return;
+      }
 
-    if (!JsonParseString(response.body(), root)) {
-      ui::ChangeStatusText(L"Kitsu: Could not parse season data.");
-      sync::OnError(RequestType::GetSeason);
-      return;
-    }
+      for (const auto& [page_number, page_response] :
+           pagination->Complete(page, response)) {
+        if (!ParseSeasonPage(page_response, page_number, *pagination)) {
+          pagination->Fail();
+          sync::OnError(RequestType::GetSeason);
+          return;
+        }
+      }
 
-    const auto prev_page = GetOffset(root, "prev");
-    const auto next_page = GetOffset(root, "next");
+      if (pagination->done()) {
+        sync::OnResponse(RequestType::GetSeason);
+      } else {
+        GetSeasonPages(season, pagination);
+      }
+    };
 
-    if (!prev_page) {  // first page
-      anime::season_db.items.clear();
-    }
+    taiga::http::Send(request, on_transfer, on_response);
+  }
+}
 
-    for (const auto& value : root["data"]) {
-      const auto anime_id = ParseAnimeObject(value);
-      anime::season_db.items.push_back(anime_id);
-      ui::OnLibraryEntryChange(anime_id);
-    }
+void GetMetadataByIds(const std::vector<int>& ids) {
+  constexpr size_t kMaxPageSize = kJsonApiMaximumPageSize;
 
-    if (next_page && *next_page > 0) {
-      GetSeason(season, *next_page);
-    } else {
-      sync::OnResponse(RequestType::GetSeason);
+  for (size_t i = 0; i < ids.size(); i += kMaxPageSize) {
+    const std::vector<int> chunk(
+        ids.begin() + i, ids.begin() + std::min(i + kMaxPageSize, ids.size()));
+
+    std::string filter;
+    for (const int id : chunk) {
+      if (!filter.empty())
+        filter += ',';
+      filter += ToStr(id);
     }
-  };
 
-  taiga::http::Send(request, on_transfer, on_response);
+    auto request = BuildRequest();
+    request.set_target("{}/edge/anime"_format(kBaseUrl));
+
+    hypr::Params params{
+        {"filter[id]", filter},
+        {"include",
+         "categories,"
+         "animeProductions,"
+         "animeProductions.producer"},
+        {"page[limit]", ToStr(kJsonApiMaximumPageSize)}};
+
+    UseSparseFieldsetsForAnime(params, false);
+    request.set_query(params);
+
+    const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetMetadataById, transfer,
+                        L"Kitsu: Retrieving anime information...");
+    };
+
+    const auto on_response = [chunk](const taiga::http::Response& response) {
+      const auto on_error = [&chunk]() {
+        for (const int id : chunk) {
+          ui::OnLibraryEntryChangeFailure(id);
+          sync::OnError(RequestType::GetMetadataById, id);
+        }
+      };
+
+      if (HasError(response)) {
+        on_error();
+        return;
+      }
+
+      Json root;
+
+      if (!JsonParseString(response.body(), root)) {
+        ui::ChangeStatusText(L"Kitsu: Could not parse anime data.");
+        on_error();
+        return;
+      }
+
+      std::set<int> received_ids;
+      for (const auto& value : root["data"]) {
+        const auto anime_id = ParseAnimeObject(value);
+        ParseRelationships(value, root["included"], anime_id);
+        received_ids.insert(anime_id);
+        ui::OnLibraryEntryChange(anime_id);
+      }
+
+      // Anime that are missing from the response are requested one by one,
+      // so that we can tell whether they still exist
+      for (const int id : chunk) {
+        if (received_ids.contains(id)) {
+          sync::OnResponse(RequestType::GetMetadataById, id);
+        } else {
+          GetMetadataById(id);
+        }
+      }
+    };
+
+    taiga::http::Send(request, on_transfer, on_response);
+  }
+}
+
+void GetSeason(const anime::Season season, const int page) {
+  auto pagination = std::make_shared<Pagination>();
+  pagination->Add(page);
+  GetSeasonPages(season, pagination);
 }
 
 void SearchTitle(const std::wstring& title) {
@@ -944,10 +1132,10 @@ void AddLibraryEntry(const library::QueueItem& queue_item) {
         // a "422 Unprocessable Entity" response with "animeId - has already
         // been taken" error message. Here we ignore this error and assume that
         // our request succeeded.
-        sync::OnResponse(RequestType::AddLibraryEntry);
+        sync::OnResponse(RequestType::AddLibraryEntry, id);
       } else {
         ui::OnLibraryUpdateFailure(id, StrToWstr(response.error().str()), false);
-        sync::OnError(RequestType::AddLibraryEntry);
+        sync::OnError(RequestType::AddLibraryEntry, id);
       }
       return;
     }
@@ -956,7 +1144,7 @@ void AddLibraryEntry(const library::QueueItem& queue_item) {
 
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"Kitsu: Could not parse anime list entry.");
-      sync::OnError(RequestType::AddLibraryEntry);
+      sync::OnError(RequestType::AddLibraryEntry, id);
       return;
     }
 
@@ -967,7 +1155,7 @@ void AddLibraryEntry(const library::QueueItem& queue_item) {
     ParseCategories(root["included"], anime_id);
     ParseProducers(root["included"], anime_id);
 
-    sync::OnResponse(RequestType::AddLibraryEntry);
+    sync::OnResponse(RequestType::AddLibraryEntry, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
@@ -994,14 +1182,14 @@ void DeleteLibraryEntry(const int id) {
       } else {
         ui::OnLibraryUpdateFailure(id, StrToWstr(response.error().str()),
                                    false);
-        sync::OnError(RequestType::DeleteLibraryEntry);
+        sync::OnError(RequestType::DeleteLibraryEntry, id);
         return;
       }
     }
 
     // Returns "204 No Content" status and empty response body.
 
-    sync::OnResponse(RequestType::DeleteLibraryEntry);
+    sync::OnResponse(RequestType::DeleteLibraryEntry, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
@@ -1041,7 +1229,7 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
         error_description = L"Kitsu: Anime list entry does not exist.";
       }
       ui::OnLibraryUpdateFailure(id, error_description, false);
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
@@ -1049,7 +1237,7 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
 
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"Kitsu: Could not parse anime list entry.");
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
@@ -1060,7 +1248,7 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
     ParseCategories(root["included"], anime_id);
     ParseProducers(root["included"], anime_id);
 
-    sync::OnResponse(RequestType::UpdateLibraryEntry);
+    sync::OnResponse(RequestType::UpdateLibraryEntry, id);
   };
 
   taiga::http::Send(request, on_transfer, on_response);
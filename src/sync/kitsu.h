@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace anime {
 class Season;
@@ -33,6 +34,7 @@ void AuthenticateUser();
 void GetUser();
 void GetLibraryEntries(const int page = 0);
 void GetMetadataById(const int id);
+void GetMetadataByIds(const std::vector<int>& ids);
 void GetSeason(const anime::Season season, const int page = 0);
 void SearchTitle(const std::wstring& title);
 void AddLibraryEntry(const library::QueueItem& queue_item);
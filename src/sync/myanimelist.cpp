@@ -17,6 +17,7 @@
  */
 
 #include <functional>
+#include <memory>
 #include <optional>
 
 #include "sync/myanimelist.h"
@@ -26,6 +27,7 @@
 #include "base/json.h"
 #include "base/log.h"
 #include "base/string.h"
+#include "base/time.h"
 #include "base/url.h"
 #include "media/anime_db.h"
 #include "media/anime_item.h"
@@ -34,6 +36,7 @@
 #include "media/anime_util.h"
 #include "media/library/queue.h"
 #include "sync/myanimelist_util.h"
+#include "sync/pagination.h"
 #include "sync/sync.h"
 #include "taiga/http.h"
 #include "taiga/settings.h"
@@ -115,6 +118,10 @@ private:
 
 static Account account;
 
+// Number of entries in the user's anime list, as reported with user
+// information. This lets us request all pages of the list at once.
+static int library_entry_count = 0;
+
 bool IsUserAuthenticated() {
   return account.authenticated();
 }
@@ -263,6 +270,7 @@ int ParseAnimeObject(const Json& json) {
     return anime::ID_UNKNOWN;
   }
 
+  const auto batch = anime::db.BatchChanges();
   auto& anime_item = anime::db.items[anime_id];
 
   anime_item.SetSource(ServiceId::MyAnimeList);
@@ -496,6 +504,7 @@ void GetUser() {
 
   auto request = BuildRequest();
   request.set_target("{}/users/{}"_format(kBaseUrl, username));
+  request.set_query({{"fields", "anime_statistics"}});
 
   const auto on_transfer = [](const taiga::http::Transfer& transfer) {
     return OnTransfer(RequestType::GetUser, transfer,
@@ -517,6 +526,8 @@ void GetUser() {
     }
 
     Account::set_username(JsonReadStr(root, "name"));
+    library_entry_count =
+        JsonReadInt(root["anime_statistics"], "num_items");
 
     sync::OnResponse(RequestType::GetUser);
 
@@ -530,58 +541,117 @@ void GetUser() {
   SendRequest(request, on_transfer, on_response);
 }
 
-void GetLibraryEntries(const int page_offset) {
-  auto request = BuildRequest();
-  request.set_target(
-      "{}/users/{}/animelist"_format(kBaseUrl, Account::username()));
-  request.set_query({
-      {"limit", ToStr(kLibraryPageLimit)},
-      {"offset", ToStr(page_offset)},
-      {"nsfw", "true"},
-      {"fields", "{},list_status{{{}}}"_format(
-          WstrToStr(GetAnimeFields()), WstrToStr(GetListStatusFields()))}});
+static bool ParseLibraryPage(const taiga::http::Response& response,
+                             const int page_offset,
+                             const std::optional<time_t> since,
+                             Pagination& pagination) {
+  Json root;
 
-  const auto on_transfer = [](const taiga::http::Transfer& transfer) {
-    return OnTransfer(RequestType::GetLibraryEntries, transfer,
-                      L"MyAnimeList: Retrieving anime list...");
-  };
+  if (!JsonParseString(response.body(), root)) {
+    ui::ChangeStatusText(L"MyAnimeList: Could not parse anime list.");
+    return false;
+  }
 
-  const auto on_response = [](const taiga::http::Response& response) {
-    if (HasError(response)) {
-      sync::OnError(RequestType::GetLibraryEntries);
-      return;
-    }
+  const auto previous_page_offset = GetOffset(root, "previous");
+  const auto next_page_offset = GetOffset(root, "next");
 
-    Json root;
+  if (!previous_page_offset && !since) {  // first page
+    anime::db.ClearUserData();
 
-    if (!JsonParseString(response.body(), root)) {
-      ui::ChangeStatusText(L"MyAnimeList: Could not parse anime list.");
-      sync::OnError(RequestType::GetLibraryEntries);
-      return;
+    // MyAnimeList does not tell us how many pages there are, but we can work
+    // it out from the number of entries that we received with user info.
+    for (int offset = page_offset + kLibraryPageLimit;
+         offset < library_entry_count; offset += kLibraryPageLimit) {
+      pagination.Add(offset);
     }
+  }
 
-    const auto previous_page_offset = GetOffset(root, "previous");
-    const auto next_page_offset = GetOffset(root, "next");
+  std::optional<time_t> oldest_entry;
 
-    if (!previous_page_offset) {  // first page
-      anime::db.ClearUserData();
+  for (const auto& value : root["data"]) {
+    if (value.contains("node") && value.contains("list_status")) {
+      const auto anime_id = ParseAnimeObject(value["node"]);
+      ParseLibraryObject(value["list_status"], anime_id);
+      oldest_entry = ConvertIso8601(
+          StrToWstr(JsonReadStr(value["list_status"], "updated_at")));
     }
+  }
 
-    for (const auto& value : root["data"]) {
-      if (value.contains("node") && value.contains("list_status")) {
-        const auto anime_id = ParseAnimeObject(value["node"]);
-        ParseLibraryObject(value["list_status"], anime_id);
+  // Entries are sorted by modification time for delta requests, so there is
+  // no need to go any further once we reach an entry that we already have.
+  if (since && (!oldest_entry || *oldest_entry < *since)) {
+    return true;
+  }
+
+  // The number of entries may have changed since we last received it
+  if (next_page_offset && *next_page_offset > 0) {
+    pagination.Add(*next_page_offset);
+  }
+
+  return true;
+}
+
+static void GetLibraryEntriesPages(std::shared_ptr<Pagination> pagination,
+                                   const std::optional<time_t> since) {
+  for (const int page_offset : pagination->Next()) {
+    auto request = BuildRequest();
+    request.set_target(
+        "{}/users/{}/animelist"_format(kBaseUrl, Account::username()));
+
+    hypr::Params params{
+        {"limit", ToStr(kLibraryPageLimit)},
+        {"offset", ToStr(page_offset)},
+        {"nsfw", "true"},
+        {"fields", "{},list_status{{{}}}"_format(
+            WstrToStr(GetAnimeFields()), WstrToStr(GetListStatusFields()))}};
+    // Most recently updated entries come first
+    if (since) {
+      params.add("sort", "list_updated_at");
+    }
+    request.set_query(params);
+
+    const auto on_transfer = [](const taiga::http::Transfer& transfer) {
+      return OnTransfer(RequestType::GetLibraryEntries, transfer,
+                        L"MyAnimeList: Retrieving anime list...");
+    };
+
+    const auto on_response = [page_offset, pagination, since](
+                                 const taiga::http::Response& response) {
+      if (pagination->failed()) {
+        return;
       }
-    }
 
-    if (next_page_offset && *next_page_offset > 0) {
-      GetLibraryEntries(*next_page_offset);
-    } else {
-      sync::OnResponse(RequestType::GetLibraryEntries);
-    }
-  };
+      if (HasError(response)) {
+        pagination->Fail();
+        sync::OnError(RequestType::GetLibraryEntries);
+        return;
+      }
 
-  SendRequest(request, on_transfer, on_response);
+      for (const auto& [offset, page_response] :
+           pagination->Complete(page_offset, response)) {
+        if (!ParseLibraryPage(page_response, offset, since, *pagination)) {
+          pagination->Fail();
+          sync::OnError(RequestType::GetLibraryEntries);
+          return;
+        }
+      }
+
+      if (pagination->done()) {
+        sync::UpdateLibraryWatermark(!since);
+        sync::OnResponse(RequestType::GetLibraryEntries);
+      } else {
+        GetLibraryEntriesPages(pagination, since);
+      }
+    };
+
+    SendRequest(request, on_transfer, on_response);
+  }
+}
+
+void GetLibraryEntries(const int page_offset) {
+  auto pagination = std::make_shared<Pagination>();
+  pagination->Add(page_offset);
+  GetLibraryEntriesPages(pagination, sync::GetLibraryWatermark());
 }
 
 void GetMetadataById(const int id) {
@@ -601,7 +671,7 @@ void GetMetadataById(const int id) {
       } else {
         ui::OnLibraryEntryChangeFailure(id);
       }
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
@@ -610,14 +680,14 @@ void GetMetadataById(const int id) {
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"MyAnimeList: Could not parse anime data.");
       ui::OnLibraryEntryChangeFailure(id);
-      sync::OnError(RequestType::GetMetadataById);
+      sync::OnError(RequestType::GetMetadataById, id);
       return;
     }
 
     const auto anime_id = ParseAnimeObject(root);
 
     ui::OnLibraryEntryChange(anime_id);
-    sync::OnResponse(RequestType::GetMetadataById);
+    sync::OnResponse(RequestType::GetMetadataById, id);
   };
 
   SendRequest(request, on_transfer, on_response);
@@ -741,12 +811,12 @@ void DeleteLibraryEntry(const int id) {
         // We consider "404 Not Found" to be a success.
       } else {
         ui::OnLibraryUpdateFailure(id, error->description, false);
-        sync::OnError(RequestType::DeleteLibraryEntry);
+        sync::OnError(RequestType::DeleteLibraryEntry, id);
         return;
       }
     }
 
-    sync::OnResponse(RequestType::DeleteLibraryEntry);
+    sync::OnResponse(RequestType::DeleteLibraryEntry, id);
   };
 
   SendRequest(request, on_transfer, on_response);
@@ -792,7 +862,7 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
         error->description = L"Anime list entry does not exist";
       }
       ui::OnLibraryUpdateFailure(id, error->description, false);
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
@@ -800,13 +870,13 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
 
     if (!JsonParseString(response.body(), root)) {
       ui::ChangeStatusText(L"MyAnimeList: Could not parse anime list entry.");
-      sync::OnError(RequestType::UpdateLibraryEntry);
+      sync::OnError(RequestType::UpdateLibraryEntry, id);
       return;
     }
 
     ParseLibraryObject(root, id);
 
-    sync::OnResponse(RequestType::UpdateLibraryEntry);
+    sync::OnResponse(RequestType::UpdateLibraryEntry, id);
   };
 
   SendRequest(request, on_transfer, on_response);
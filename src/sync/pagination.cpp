@@ -0,0 +1,88 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sync/pagination.h"
+
+namespace sync {
+
+Pagination::Pagination(const size_t max_concurrent_requests)
+    : max_concurrent_requests_{max_concurrent_requests} {
+}
+
+void Pagination::Add(const int page) {
+  if (failed_ || !known_.insert(page).second)
+    return;
+
+  pending_.insert(page);
+  queued_.insert(page);
+}
+
+std::vector<int> Pagination::Next() {
+  std::vector<int> pages;
+
+  while (!failed_ && !queued_.empty() &&
+         active_requests_ < max_concurrent_requests_) {
+    pages.push_back(*queued_.begin());
+    queued_.erase(queued_.begin());
+    ++active_requests_;
+  }
+
+  return pages;
+}
+
+std::vector<Pagination::Page> Pagination::Complete(
+    const int page, const taiga::http::Response& response) {
+  std::vector<Page> pages;
+
+  if (active_requests_ > 0)
+    --active_requests_;
+
+  if (failed_ || !pending_.contains(page))
+    return pages;
+
+  responses_[page] = response;
+
+  // Hand out responses for as long as there is no gap before them
+  while (!pending_.empty()) {
+    const auto it = responses_.find(*pending_.begin());
+    if (it == responses_.end())
+      break;
+    pages.emplace_back(it->first, std::move(it->second));
+    responses_.erase(it);
+    pending_.erase(pending_.begin());
+  }
+
+  return pages;
+}
+
+void Pagination::Fail() {
+  failed_ = true;
+  queued_.clear();
+  pending_.clear();
+  responses_.clear();
+}
+
+bool Pagination::done() const {
+  return pending_.empty();
+}
+
+bool Pagination::failed() const {
+  return failed_;
+}
+
+}  // namespace sync
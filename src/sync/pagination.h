@@ -0,0 +1,67 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "taiga/http.h"
+
+namespace sync {
+
+// Keeps track of the pages of a paginated request. Once the first page reveals
+// how many pages there are, the remaining pages can be requested concurrently.
+// Responses may arrive in any order, but they are handed out in page order.
+class Pagination final {
+public:
+  using Page = std::pair<int, taiga::http::Response>;
+
+  explicit Pagination(const size_t max_concurrent_requests = 4);
+
+  // Queues a page to be requested, unless it was queued before. Pages are
+  // identified by their number or offset, and processed in ascending order.
+  void Add(const int page);
+
+  // Returns the pages that can be requested without exceeding the limit of
+  // concurrent requests
+  std::vector<int> Next();
+
+  // Stores the response of a page, and returns the responses that are ready
+  // to be processed
+  std::vector<Page> Complete(const int page,
+                             const taiga::http::Response& response);
+
+  void Fail();
+
+  bool done() const;
+  bool failed() const;
+
+private:
+  std::set<int> known_;
+  std::set<int> pending_;  // queued, requested or waiting to be processed
+  std::set<int> queued_;
+  std::map<int, taiga::http::Response> responses_;
+  size_t active_requests_ = 0;
+  bool failed_ = false;
+  const size_t max_concurrent_requests_;
+};
+
+}  // namespace sync
@@ -16,6 +16,10 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <fstream>
+#include <memory>
+#include <set>
+
 #include "sync/sync.h"
 
 #include "base/file.h"
@@ -31,7 +35,9 @@
 #include "sync/myanimelist.h"
 #include "sync/service.h"
 #include "taiga/http.h"
+#include "taiga/persistence.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "ui/dialog.h"
 #include "ui/resource.h"
 #include "ui/translate.h"
@@ -92,7 +98,14 @@ void GetLibraryEntries() {
   }
 }
 
+// IDs of anime whose metadata is being retrieved. Requests for these are not
+// sent again until we receive a response.
+static std::set<int> metadata_requests;
+
 void GetMetadataById(const int id) {
+  if (!metadata_requests.insert(id).second)
+    return;
+
   ui::ChangeStatusText(L"{}: Retrieving anime information..."_format(
       GetCurrentServiceName()));
 
@@ -109,6 +122,42 @@ void GetMetadataById(const int id) {
   }
 }
 
+void GetMetadataByIds(std::span<const int> ids) {
+  std::vector<int> anime_ids;
+  for (const int id : ids) {
+    if (metadata_requests.insert(id).second)
+      anime_ids.push_back(id);
+  }
+
+  if (anime_ids.empty())
+    return;
+
+  if (anime_ids.size() == 1) {
+    metadata_requests.erase(anime_ids.front());
+    GetMetadataById(anime_ids.front());
+    return;
+  }
+
+  ui::ChangeStatusText(L"{}: Retrieving anime information... ({} entries)"_format(
+      GetCurrentServiceName(), anime_ids.size()));
+
+  switch (GetCurrentServiceId()) {
+    // Requests are sent concurrently, bounded by the per-host limit of the
+    // HTTP client
+    case ServiceId::MyAnimeList:
+      for (const int id : anime_ids) {
+        myanimelist::GetMetadataById(id);
+      }
+      break;
+    case ServiceId::Kitsu:
+      kitsu::GetMetadataByIds(anime_ids);
+      break;
+    case ServiceId::AniList:
+      anilist::GetMetadataByIds(anime_ids);
+      break;
+  }
+}
+
 void GetSeason(const anime::Season season) {
   ui::EnableDialogInput(ui::Dialog::Seasons, false);
   ui::ChangeStatusText(L"{}: Retrieving {} anime season..."_format(
@@ -238,6 +287,40 @@ void UpdateLibraryEntry(const library::QueueItem& queue_item) {
   }
 }
 
+void UpdateLibraryEntries(const std::vector<library::QueueItem>& queue_items) {
+  if (queue_items.size() == 1) {
+    const auto& queue_item = queue_items.front();
+    if (queue_item.mode == library::QueueItemMode::Add) {
+      AddLibraryEntry(queue_item);
+    } else {
+      UpdateLibraryEntry(queue_item);
+    }
+    return;
+  }
+
+  ui::ChangeStatusText(L"{}: Updating anime list... ({} entries)"_format(
+      GetCurrentServiceName(), queue_items.size()));
+
+  switch (GetCurrentServiceId()) {
+    // Updates are sent in a single request
+    case ServiceId::AniList:
+      anilist::UpdateLibraryEntries(queue_items);
+      break;
+
+    // Updates are sent as concurrent requests, bounded by the per-host limit
+    // of the HTTP client
+    default:
+      for (const auto& queue_item : queue_items) {
+        if (queue_item.mode == library::QueueItemMode::Add) {
+          AddLibraryEntry(queue_item);
+        } else {
+          UpdateLibraryEntry(queue_item);
+        }
+      }
+      break;
+  }
+}
+
 void DownloadImage(const int anime_id, const std::wstring& image_url) {
   if (image_url.empty())
     return;
@@ -245,18 +328,49 @@ void DownloadImage(const int anime_id, const std::wstring& image_url) {
   taiga::http::Request request;
   request.set_target(WstrToStr(image_url));
 
-  const auto on_response = [anime_id](const taiga::http::Response& response) {
-    if (response.status_class() == 200) {
-      SaveToFile(response.body(), anime::GetImagePath(anime_id));
-      if (ui::image_db.LoadFile(anime_id))
-        ui::OnLibraryEntryImageChange(anime_id);
-    } else if (response.status_code() == 404) {
+  // The image is written to a temporary file as it arrives, which replaces the
+  // previous image only when the download is complete.
+  const auto path = anime::GetImagePath(anime_id);
+  const auto temp_path = path + L".part";
+  const auto file = std::make_shared<std::ofstream>();
+
+  const auto on_body = [file, temp_path](const taiga::http::Response& response,
+                                         std::string_view data) {
+    if (response.status_class() != 200)
+      return true;  // discard
+    if (!file->is_open()) {
+      CreateFolder(GetPathOnly(temp_path));
+      file->open(temp_path, std::ios::binary | std::ios::trunc);
+    }
+    file->write(data.data(), data.size());
+    return file->good();
+  };
+
+  const auto on_response = [anime_id, file, path, temp_path](
+                               const taiga::http::Response& response) {
+    const bool downloaded = file->is_open();
+    file->close();
+
+    if (response.status_class() == 200 && !response.error() && downloaded) {
+      if (::MoveFileEx(temp_path.c_str(), path.c_str(),
+                       MOVEFILE_REPLACE_EXISTING)) {
+        if (ui::image_db.LoadFile(anime_id))
+          ui::OnLibraryEntryImageChange(anime_id);
+      }
+      return;
+    }
+
+    if (downloaded)
+      ::DeleteFile(temp_path.c_str());
+
+    if (response.status_code() == 404) {
       if (const auto anime_item = anime::db.Find(anime_id))
         anime_item->SetImageUrl({});
     }
   };
 
-  taiga::http::Send(request, nullptr, on_response);
+  taiga::http::Send(request, nullptr, on_response,
+                    taiga::http::Priority::Background, on_body);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -317,6 +431,49 @@ bool IsUserAuthenticationAvailable() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Entries that are modified shortly before the watermark are requested again,
+// in case the clocks of the server and the client do not agree.
+constexpr time_t kLibraryWatermarkMargin = 60 * 60;  // 1 hour
+
+// Delta requests cannot tell us about entries that were deleted on the
+// website, so the entire list is downloaded every once in a while.
+constexpr time_t kFullLibrarySyncInterval = 60 * 60 * 24 * 7;  // 1 week
+
+// Returns the time that changes should be requested from, or nothing if the
+// entire list should be downloaded.
+std::optional<time_t> GetLibraryWatermark() {
+  const auto now = time(nullptr);
+  const auto watermark = anime::db.list_watermark;
+
+  if (watermark <= 0 || watermark > now + kLibraryWatermarkMargin)
+    return std::nullopt;
+  if (now - anime::db.list_full_sync_time > kFullLibrarySyncInterval)
+    return std::nullopt;
+
+  return watermark - kLibraryWatermarkMargin;
+}
+
+void UpdateLibraryWatermark(const bool full_sync) {
+  const auto now = time(nullptr);
+
+  // Services tell us when each entry was last modified, and entries that were
+  // updated from the client are marked with the time of the update.
+  time_t watermark = anime::db.list_watermark;
+  for (const auto& [id, anime_item] : anime::db.items) {
+    if (anime_item.IsInList()) {
+      const auto last_updated = ToTime(anime_item.GetMyLastUpdated());
+      if (last_updated > watermark && last_updated <= now)
+        watermark = last_updated;
+    }
+  }
+
+  anime::db.list_watermark = watermark;
+  if (full_sync)
+    anime::db.list_full_sync_time = now;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 bool HasProgress(const RequestType type) {
   switch (type) {
     case RequestType::RequestAccessToken:
@@ -351,14 +508,38 @@ void OnError(const RequestType type) {
       ui::OnLibraryGetSeason();
       ui::EnableDialogInput(ui::Dialog::Seasons, true);
       break;
+  }
+}
+
+// Metadata and library entry requests report back for each anime, so that we
+// can tell which of them were sent successfully.
+static void OnAnimeError(const RequestType type, const int anime_id) {
+  switch (type) {
+    case RequestType::GetMetadataById:
+      metadata_requests.erase(anime_id);
+      break;
     case RequestType::AddLibraryEntry:
     case RequestType::DeleteLibraryEntry:
     case RequestType::UpdateLibraryEntry:
-      library::queue.updating = false;
+      library::queue.OnResponse(anime_id, false);
       break;
   }
 }
 
+void OnError(const RequestType type, const int anime_id) {
+  OnError(type);
+  OnAnimeError(type, anime_id);
+}
+
+// Requests that are sent for several anime at once fail as a whole, which is
+// reported only once.
+void OnError(const RequestType type, std::span<const int> anime_ids) {
+  OnError(type);
+  for (const auto anime_id : anime_ids) {
+    OnAnimeError(type, anime_id);
+  }
+}
+
 bool OnTransfer(const RequestType type, const taiga::http::Transfer& transfer,
                 const std::wstring& status) {
   if (HasProgress(type)) {
@@ -400,6 +581,7 @@ void OnResponse(const RequestType type) {
       break;
 
     case RequestType::GetLibraryEntries:
+      anime::db.OnListChange();
       anime::db.SaveDatabase();
       anime::db.SaveList();
       ui::OnLibraryChange();
@@ -421,13 +603,21 @@ void OnResponse(const RequestType type) {
     case RequestType::AddLibraryEntry:
     case RequestType::DeleteLibraryEntry:
     case RequestType::UpdateLibraryEntry:
-      if (const auto queue_item = library::queue.GetCurrentItem()) {
-        anime::db.UpdateItem(*queue_item);
-        anime::db.SaveList();
-        library::queue.Remove();
-      }
-      library::queue.updating = false;
-      library::queue.Check(false);
+      break;
+  }
+}
+
+void OnResponse(const RequestType type, const int anime_id) {
+  OnResponse(type);
+
+  switch (type) {
+    case RequestType::GetMetadataById:
+      metadata_requests.erase(anime_id);
+      break;
+    case RequestType::AddLibraryEntry:
+    case RequestType::DeleteLibraryEntry:
+    case RequestType::UpdateLibraryEntry:
+      library::queue.OnResponse(anime_id, true);
       break;
   }
 }
@@ -436,9 +626,9 @@ void OnInvalidAnimeId(const int id) {
   if (const auto anime_item = anime::db.Find(id)) {
     const bool in_list = anime_item->IsInList();
     if (anime::db.DeleteItem(id)) {
-      anime::db.SaveDatabase();
+      taiga::persistence.MarkDirty(taiga::Store::Database);
       if (in_list) {
-        anime::db.SaveList();
+        taiga::persistence.MarkDirty(taiga::Store::List);
       }
     }
   }
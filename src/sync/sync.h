@@ -18,7 +18,11 @@
 
 #pragma once
 
+#include <ctime>
+#include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace anime {
 class Season;
@@ -53,12 +57,14 @@ void AuthenticateUser();
 void GetUser();
 void GetLibraryEntries();
 void GetMetadataById(const int id);
+void GetMetadataByIds(std::span<const int> ids);
 void GetSeason(const anime::Season season);
 void SearchTitle(const std::wstring& title);
 void Synchronize();
 void AddLibraryEntry(const library::QueueItem& queue_item);
 void DeleteLibraryEntry(const int id);
 void UpdateLibraryEntry(const library::QueueItem& queue_item);
+void UpdateLibraryEntries(const std::vector<library::QueueItem>& queue_items);
 
 void DownloadImage(const int anime_id, const std::wstring& image_url);
 
@@ -67,10 +73,16 @@ void InvalidateUserAuthentication();
 bool IsUserAccountAvailable();
 bool IsUserAuthenticationAvailable();
 
+std::optional<time_t> GetLibraryWatermark();
+void UpdateLibraryWatermark(const bool full_sync);
+
 void OnError(const RequestType type);
+void OnError(const RequestType type, const int anime_id);
+void OnError(const RequestType type, std::span<const int> anime_ids);
 bool OnTransfer(const RequestType type, const taiga::http::Transfer& transfer,
                 const std::wstring& status);
 void OnResponse(const RequestType type);
+void OnResponse(const RequestType type, const int anime_id);
 
 void OnInvalidAnimeId(const int id);
 
@@ -27,11 +27,14 @@
 #include "base/string.h"
 #include "link/discord.h"
 #include "media/anime_db.h"
+#include "media/anime_search.h"
+#include "media/library/export.h"
 #include "media/library/history.h"
 #include "taiga/announce.h"
 #include "taiga/config.h"
 #include "taiga/dummy.h"
 #include "taiga/http.h"
+#include "taiga/persistence.h"
 #include "taiga/resource.h"
 #include "taiga/settings.h"
 #include "taiga/version.h"
@@ -62,6 +65,9 @@ void LoadData() {
 
   library::history.Load();
   track::aggregator.archive.Load();
+  track::aggregator.download_queue.Load();
+
+  anime::search_index.Build();
 }
 
 }  // namespace detail
@@ -116,10 +122,14 @@ void App::Uninitialize() {
   ui::taskbar.Destroy();
   ui::taskbar_list.Release();
 
-  // Save
+  // Save (the database is always saved on exit)
   settings.Save();
-  anime::db.SaveDatabase();
+  persistence.MarkDirty(Store::Database);
+  persistence.Flush();
+  anime::db.WaitForSave();
+  library::WaitForExport();
   track::aggregator.archive.Save();
+  track::aggregator.download_queue.Save();
 
   // Exit
   PostQuitMessage();
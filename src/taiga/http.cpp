@@ -16,8 +16,16 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <fstream>
 #include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -32,6 +40,7 @@
 #include "base/string.h"
 #include "taiga/app.h"
 #include "taiga/config.h"
+#include "taiga/http_cache.h"
 #include "taiga/settings.h"
 #include "taiga/stats.h"
 #include "ui/ui.h"
@@ -40,44 +49,11 @@ namespace taiga::http {
 
 namespace detail {
 
-static hypr::Options GetOptions() {
-  hypr::Options options;
-
-  options.allow_redirects = true;
-
-  // Disabling certificate revocation checks seems to work for those who get
-  // "SSL connect error". See issue #312 for more information.
-  options.certificate_revocation = !settings.GetAppConnectionNoRevoke();
-
-  // Web browsers set the maximum number of redirects to ~20 (e.g. Firefox's
-  // `network.http.redirection-limit` option), but we do not need that many.
-  options.max_redirects = 5;
-
-  // Complete connection within 30 seconds (default is 300 seconds)
-  options.timeout = std::chrono::seconds{30};
-
-  // Log verbose information about libcurl's operations
-  options.verbose = app.options.debug_mode && app.options.verbose;
-
-#ifdef _DEBUG
-  // Skip SSL verifications in debug build
-  options.verify_certificate = false;
-#else
-  options.verify_certificate = true;
-#endif
-
-  return options;
-}
-
-static hypr::Proxy GetProxy() {
-  hypr::Proxy proxy;
-
-  proxy.host = WstrToStr(settings.GetAppConnectionProxyHost());
-  proxy.username = WstrToStr(settings.GetAppConnectionProxyUsername());
-  proxy.password = WstrToStr(settings.GetAppConnectionProxyPassword());
-
-  return proxy;
-}
+// libcurl's multi interface is driven by a single I/O thread. Connections are
+// cached by the multi handle and reused across requests, and requests to the
+// same host are multiplexed over HTTP/2 where the server supports it.
+constexpr size_t kMaxSimultaneousConnections = 10;
+constexpr size_t kMaxSimultaneousConnectionsPerHost = 6;
 
 static void Debug(const curl_infotype type, std::string_view data) {
   auto str = StrToWstr(std::string{data});
@@ -108,54 +84,463 @@ static void Debug(const curl_infotype type, std::string_view data) {
   }
 }
 
-static void SendRequest(Request request,
-                        const TransferCallback& on_transfer,
-                        const ResponseCallback& on_response,
-                        hypr::Session& session) {
-  session.options = GetOptions();
-  session.proxy = GetProxy();
+struct CompletedTransfer {
+  Response response;
+  ResponseCallback on_response;
+  bool cached = false;
+};
 
-  session.callbacks.debug = Debug;
-  session.callbacks.transfer = on_transfer;
+class Engine final {
+public:
+  Engine() = default;
 
-  // The default header (e.g. "User-Agent: Taiga/1.0") will be used, unless
-  // another value is specified in the request header
-  if (request.header("user-agent").empty()) {
-    request.set_header("User-Agent", WstrToStr(L"{}/{}.{}"_format(
-        TAIGA_APP_NAME, TAIGA_VERSION_MAJOR, TAIGA_VERSION_MINOR)));
+  ~Engine() {
+    Shutdown();
   }
 
-  LOGD(L"URL: {}"_format(StrToWstr(hypp::to_string(request.target()))));
+  void Init() {
+    std::lock_guard lock{mutex_};
 
-  auto response = session.send(request);  // blocks
+    if (multi_handle_) {
+      return;
+    }
 
-  // @TODO: Remove once hypr is able to do this automatically
-  const auto content_encoding = response.header("content-encoding");
-  if (content_encoding.find("gzip") != content_encoding.npos) {
-    if (!response.body().empty()) {
-      std::string uncompressed;
-      if (UncompressGzippedString(response.body(), uncompressed)) {
-        std::swap(response.body(), uncompressed);
+    multi_handle_ = curl_multi_init();
+    curl_multi_setopt(multi_handle_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_handle_, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                      static_cast<long>(kMaxSimultaneousConnections));
+    curl_multi_setopt(multi_handle_, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      static_cast<long>(kMaxSimultaneousConnectionsPerHost));
+
+    shutdown_ = false;
+    thread_ = std::thread([this]() { Run(); });
+  }
+
+  void Shutdown() {
+    {
+      std::lock_guard lock{mutex_};
+      if (!multi_handle_) {
+        return;
       }
+      shutdown_ = true;
+      curl_multi_wakeup(multi_handle_);
+    }
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+
+    std::lock_guard lock{mutex_};
+
+    for (auto& transfer : pending_) {
+      Cleanup(*transfer);
     }
+    pending_.clear();
+
+    for (auto& [handle, transfer] : active_) {
+      curl_multi_remove_handle(multi_handle_, handle);
+      Cleanup(*transfer);
+    }
+    active_.clear();
+
+    curl_multi_cleanup(multi_handle_);
+    multi_handle_ = nullptr;
+
+    completed_.clear();
   }
 
-  // @TODO: Do the rest in the main thread
+  void SetWindowHandle(HWND hwnd) {
+    window_handle_ = hwnd;
+  }
 
-  if (response.error()) {
-    LOGE(util::to_string(response.error(), util::GetUrlHost(response.url())));
-    taiga::stats.connections_failed++;
-  } else {
-    taiga::stats.connections_succeeded++;
+  void Send(const Request& request,
+            const TransferCallback& on_transfer,
+            const ResponseCallback& on_response,
+            const BodyCallback& on_body) {
+    auto transfer = std::make_unique<ActiveTransfer>();
+    transfer->request = request;
+    transfer->on_transfer = on_transfer;
+    transfer->on_response = on_response;
+    transfer->on_body = on_body;
+
+    std::lock_guard lock{mutex_};
+
+    if (!multi_handle_ || shutdown_) {
+      LOGD(L"Shutting down...");
+      return;
+    }
+
+    pending_.push_back(std::move(transfer));
+    curl_multi_wakeup(multi_handle_);
+  }
+
+  // Delivers a response that was served from the cache. The callback is never
+  // called before Send returns, same as for responses from the network.
+  void Deliver(Response&& response, const ResponseCallback& on_response) {
+    {
+      std::lock_guard lock{completed_mutex_};
+      completed_.push_back({std::move(response), on_response, true});
+    }
+
+    if (window_handle_) {
+      ::PostMessage(window_handle_, WM_HTTPCALLBACK, 0, 0);
+    } else {
+      std::lock_guard lock{mutex_};
+      if (multi_handle_) {
+        curl_multi_wakeup(multi_handle_);
+      }
+    }
+  }
+
+  // Called from the main thread on WM_HTTPCALLBACK
+  void ProcessCallbacks() {
+    std::vector<CompletedTransfer> completed;
+
+    {
+      std::lock_guard lock{completed_mutex_};
+      std::swap(completed, completed_);
+    }
+
+    for (const auto& transfer : completed) {
+      Complete(transfer);
+    }
+  }
+
+private:
+  struct ActiveTransfer {
+    CURL* handle = nullptr;
+    curl_slist* headers = nullptr;
+    char error_buffer[CURL_ERROR_SIZE] = {};
+    Request request;
+    Response response;
+    bool receiving_body = false;
+    std::unique_ptr<GzipInflater> inflater;
+    std::string inflated;
+    TransferCallback on_transfer;
+    ResponseCallback on_response;
+    BodyCallback on_body;
+  };
+
+  void Run() {
+    while (true) {
+      std::vector<std::unique_ptr<ActiveTransfer>> pending;
+
+      {
+        std::lock_guard lock{mutex_};
+        if (shutdown_) {
+          break;
+        }
+        std::swap(pending, pending_);
+      }
+
+      for (auto& transfer : pending) {
+        Start(std::move(transfer));
+      }
+
+      int running_handles = 0;
+      curl_multi_perform(multi_handle_, &running_handles);
+
+      int messages_left = 0;
+      while (auto message = curl_multi_info_read(multi_handle_, &messages_left)) {
+        if (message->msg == CURLMSG_DONE) {
+          Finish(message->easy_handle, message->data.result);
+        }
+      }
+
+      if (!window_handle_) {
+        ProcessCallbacks();
+      }
+
+      // Blocks until there is activity on a socket, a timeout occurs or a new
+      // request wakes us up
+      curl_multi_poll(multi_handle_, nullptr, 0, 1000, nullptr);
+    }
+  }
+
+  void Start(std::unique_ptr<ActiveTransfer> transfer) {
+    auto& request = transfer->request;
+
+    // The default header (e.g. "User-Agent: Taiga/1.0") will be used, unless
+    // another value is specified in the request header
+    if (request.header("user-agent").empty()) {
+      request.set_header("User-Agent", WstrToStr(L"{}/{}.{}"_format(
+          TAIGA_APP_NAME, TAIGA_VERSION_MAJOR, TAIGA_VERSION_MINOR)));
+    }
+
+    const auto url = hypp::to_string(request.target());
+
+    LOGD(L"URL: {}"_format(StrToWstr(url)));
+
+    CURL* handle = curl_easy_init();
+    transfer->handle = handle;
+
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method().c_str());
+    if (!request.body().empty()) {
+      curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request.body().data());
+      curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE,
+                       static_cast<curl_off_t>(request.body().size()));
+    }
+
+    for (const auto& [name, value] : request.headers()) {
+      const auto header = "{}: {}"_format(name, value);
+      transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+    }
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headers);
+
+    SetOptions(handle);
+
+    curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, transfer->error_buffer);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, transfer.get());
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer.get());
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, TransferCallback_);
+    curl_easy_setopt(handle, CURLOPT_XFERINFODATA, transfer.get());
+
+    curl_multi_add_handle(multi_handle_, handle);
+
+    std::lock_guard lock{mutex_};
+    active_[handle] = std::move(transfer);
+  }
+
+  void Finish(CURL* handle, CURLcode result) {
+    std::unique_ptr<ActiveTransfer> transfer;
+
+    {
+      std::lock_guard lock{mutex_};
+      const auto it = active_.find(handle);
+      if (it == active_.end()) {
+        return;
+      }
+      transfer = std::move(it->second);
+      active_.erase(it);
+    }
+
+    curl_multi_remove_handle(multi_handle_, handle);
+
+    auto& response = transfer->response;
+
+    if (result != CURLE_OK) {
+      response.set_error(Error{result, transfer->error_buffer});
+    } else if (transfer->inflater && !transfer->inflater->finished()) {
+      // The connection was closed before the end of the compressed stream
+      response.set_error(Error{CURLE_BAD_CONTENT_ENCODING,
+                               "Compressed response body is truncated."});
+    }
+
+    long status_code = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status_code);
+    response.set_status_code(static_cast<int>(status_code));
+
+    char* effective_url = nullptr;
+    curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &effective_url);
+    if (effective_url) {
+      response.set_url(effective_url);
+    }
+
+    CompletedTransfer completed{std::move(response),
+                                std::move(transfer->on_response)};
+    Cleanup(*transfer);
+
+    // Callbacks are dispatched to the main thread, unless there is no window
+    // to receive them yet (e.g. while checking for updates at startup).
+    if (window_handle_) {
+      {
+        std::lock_guard lock{completed_mutex_};
+        completed_.push_back(std::move(completed));
+      }
+      ::PostMessage(window_handle_, WM_HTTPCALLBACK, 0, 0);
+    } else {
+      Complete(completed);
+    }
+  }
+
+  void Complete(const CompletedTransfer& transfer) {
+    const auto& response = transfer.response;
+
+    if (transfer.cached) {
+      // No connection was made
+    } else if (response.error()) {
+      LOGE(util::to_string(response.error(), util::GetUrlHost(response.url())));
+      taiga::stats.connections_failed++;
+    } else {
+      taiga::stats.connections_succeeded++;
+    }
+
+    if (transfer.on_response) {
+      transfer.on_response(response);
+    }
+
+    taiga::http::ProcessQueue();
+  }
+
+  static void Cleanup(ActiveTransfer& transfer) {
+    if (transfer.handle) {
+      curl_easy_cleanup(transfer.handle);
+      transfer.handle = nullptr;
+    }
+    if (transfer.headers) {
+      curl_slist_free_all(transfer.headers);
+      transfer.headers = nullptr;
+    }
+  }
+
+  static void SetOptions(CURL* handle) {
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+
+    // Prefer multiplexing over an existing HTTP/2 connection to opening a new
+    // connection to the same host
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+
+    // Web browsers set the maximum number of redirects to ~20 (e.g. Firefox's
+    // `network.http.redirection-limit` option), but we do not need that many.
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 5L);
+
+    // Complete connection within 30 seconds (default is 300 seconds)
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 30L);
+
+    // Disabling certificate revocation checks seems to work for those who get
+    // "SSL connect error". See issue #312 for more information.
+    if (settings.GetAppConnectionNoRevoke()) {
+      curl_easy_setopt(handle, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NO_REVOKE);
+    }
+
+#ifdef _DEBUG
+    // Skip SSL verifications in debug build
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+#else
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L);
+#endif
+
+    const auto proxy_host = WstrToStr(settings.GetAppConnectionProxyHost());
+    if (!proxy_host.empty()) {
+      curl_easy_setopt(handle, CURLOPT_PROXY, proxy_host.c_str());
+      const auto username = WstrToStr(settings.GetAppConnectionProxyUsername());
+      const auto password = WstrToStr(settings.GetAppConnectionProxyPassword());
+      if (!username.empty()) {
+        curl_easy_setopt(handle, CURLOPT_PROXYUSERNAME, username.c_str());
+        curl_easy_setopt(handle, CURLOPT_PROXYPASSWORD, password.c_str());
+      }
+    }
+
+    // Log verbose information about libcurl's operations
+    if (app.options.debug_mode && app.options.verbose) {
+      curl_easy_setopt(handle, CURLOPT_VERBOSE, 1L);
+      curl_easy_setopt(handle, CURLOPT_DEBUGFUNCTION, DebugCallback);
+    }
+  }
+
+  static int DebugCallback(CURL*, curl_infotype type, char* data, size_t size,
+                           void*) {
+    Debug(type, std::string_view{data, size});
+    return 0;
+  }
+
+  static size_t HeaderCallback(char* buffer, size_t size, size_t count,
+                               void* user_data) {
+    auto& transfer = *static_cast<ActiveTransfer*>(user_data);
+    auto& response = transfer.response;
+    const std::string_view line{buffer, size * count};
+
+    // A new status line means that we are following a redirect, so headers of
+    // the previous response must be discarded.
+    if (line.starts_with("HTTP/")) {
+      response = Response{};
+      transfer.receiving_body = false;
+      transfer.inflater.reset();
+      return line.size();
+    }
+
+    const auto colon = line.find(':');
+    if (colon != line.npos) {
+      auto value = line.substr(colon + 1);
+      while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front())))
+        value.remove_prefix(1);
+      while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+        value.remove_suffix(1);
+      response.set_header(nstd::tolower_string(std::string{line.substr(0, colon)}),
+                          std::string{value});
+    }
+
+    return line.size();
+  }
+
+  // Returning a value other than the number of bytes received aborts the
+  // transfer.
+  static size_t WriteCallback(char* buffer, size_t size, size_t count,
+                              void* user_data) {
+    auto& transfer = *static_cast<ActiveTransfer*>(user_data);
+    auto& response = transfer.response;
+    std::string_view data{buffer, size * count};
+
+    if (!transfer.receiving_body) {
+      transfer.receiving_body = true;
+
+      long status_code = 0;
+      curl_easy_getinfo(transfer.handle, CURLINFO_RESPONSE_CODE, &status_code);
+      response.set_status_code(static_cast<int>(status_code));
+
+      // Compressed data is inflated as it arrives, rather than buffering the
+      // whole body and then making an uncompressed copy of it.
+      const auto content_encoding = response.header("content-encoding");
+      if (content_encoding.find("gzip") != content_encoding.npos) {
+        transfer.inflater = std::make_unique<GzipInflater>();
+      }
+    }
+
+    if (transfer.inflater) {
+      transfer.inflated.clear();
+      if (!transfer.inflater->Write(data, transfer.inflated)) {
+        LOGE(L"Could not decompress response body.");
+        return 0;
+      }
+      data = transfer.inflated;
+    }
+
+    if (transfer.on_body) {
+      if (!transfer.on_body(response, data)) {
+        return 0;
+      }
+    } else {
+      response.body().append(data);
+    }
+
+    return size * count;
   }
 
-  if (on_response) {
-    on_response(response);
+  static int TransferCallback_(void* user_data, curl_off_t download_total,
+                               curl_off_t download_now, curl_off_t, curl_off_t) {
+    const auto& transfer = *static_cast<ActiveTransfer*>(user_data);
+    if (!transfer.on_transfer) {
+      return 0;
+    }
+    Transfer info;
+    info.current = static_cast<size_t>(download_now);
+    info.total = static_cast<size_t>(download_total);
+    // Returning a non-zero value aborts the transfer
+    return transfer.on_transfer(info) ? 0 : 1;
   }
 
-  ProcessQueue();
+  CURLM* multi_handle_ = nullptr;
+  std::map<CURL*, std::unique_ptr<ActiveTransfer>> active_;
+  std::vector<std::unique_ptr<ActiveTransfer>> pending_;
+  std::mutex mutex_;
+  bool shutdown_ = false;
+  std::thread thread_;
+
+  std::vector<CompletedTransfer> completed_;
+  std::mutex completed_mutex_;
+  std::atomic<HWND> window_handle_ = nullptr;
 };
 
+static Engine engine;
+
 class Client final {
 public:
   enum class State {
@@ -166,55 +551,58 @@ public:
 
   Client() = default;
 
-  Client::~Client() {
+  ~Client() {
     Cancel();
-    if (thread_.joinable()) {
-      thread_.join();
-    }
   }
 
   void Cancel() {
-    if (state_ == State::Busy) {
-      state_ = State::Cancelled;
+    if (*state_ == State::Busy) {
+      *state_ = State::Cancelled;
     }
   }
 
   void Send(const Request& request,
             const TransferCallback& on_transfer,
-            const ResponseCallback& on_response) {
-    state_ = State::Busy;
+            const ResponseCallback& on_response,
+            const BodyCallback& on_body) {
+    *state_ = State::Busy;
 
-    if (thread_.joinable()) {
-      thread_.join();
-    }
+    // The state is shared with the callbacks, which may outlive the client
+    const auto state = state_;
 
     const auto transfer_callback = [=](const Transfer& transfer) {
-      if (state_ == State::Cancelled) {
+      if (*state == State::Cancelled) {
         return false;
       }
       return on_transfer ? on_transfer(transfer) : true;
     };
 
-    thread_ = std::thread([=]() {
-      SendRequest(request, transfer_callback, on_response, session_);
-      state_ = State::Ready;
-    });
+    const auto response_callback = [=](const Response& response) {
+      *state = State::Ready;
+      if (on_response) {
+        on_response(response);
+      }
+    };
+
+    engine.Send(request, transfer_callback, response_callback, on_body);
   }
 
   State state() const {
-    return state_;
+    return *state_;
   }
 
 private:
-  hypr::Session session_;
-  std::atomic<State> state_ = State::Ready;
-  std::thread thread_;
+  std::shared_ptr<std::atomic<State>> state_ =
+      std::make_shared<std::atomic<State>>(State::Ready);
 };
 
 struct QueuedRequest {
   Request request;
   TransferCallback on_transfer;
   ResponseCallback on_response;
+  BodyCallback on_body;
+  Priority priority = Priority::Normal;
+  std::chrono::steady_clock::time_point queue_time;
 };
 
 class Pool final {
@@ -241,63 +629,162 @@ public:
       return;
     }
 
-    queue_[authority->host].push_back(std::move(item));
+    auto& host = hosts_[authority->host];
+    if (!host.queued()) {
+      round_robin_.push_back(authority->host);
+    }
+
+    item.queue_time = std::chrono::steady_clock::now();
+    host.queues[static_cast<size_t>(item.priority)].push_back(std::move(item));
+
+    if (++queued_ > taiga::stats.http_queue_depth_max) {
+      taiga::stats.http_queue_depth_max = queued_;
+    }
+    taiga::stats.http_queue_depth = queued_;
   }
 
   void ProcessQueue() {
     std::lock_guard lock{mutex_};
 
-    if (queue_.empty()) {
-      return;
+    while (queued_ > 0) {
+      if (active_ >= kMaxSimultaneousConnections) {
+        if (app.options.verbose) {
+          LOGD(L"Reached max connections");
+        }
+        return;
+      }
+      if (!SendNext()) {
+        return;
+      }
     }
-    if (ReachedMaxConnections()) {
-      if (app.options.verbose) {
-        LOGD(L"Reached max connections");
+  }
+
+  void Shutdown() {
+    std::lock_guard lock{mutex_};
+
+    shutdown_ = true;
+
+    for (auto& [name, host] : hosts_) {
+      for (auto& queue : host.queues) {
+        queue.clear();
+      }
+      for (auto& client : host.clients) {
+        client.Cancel();
       }
-      return;
     }
 
-    for (auto& [host, items] : queue_) {
-      for (size_t i = 0; i < items.size(); ++i) {
-        const auto& item = items[i];
+    round_robin_.clear();
+    queued_ = 0;
+  }
+
+private:
+  static constexpr size_t kPriorityCount =
+      static_cast<size_t>(Priority::Background) + 1;
+
+  struct Host {
+    bool queued() const {
+      return std::ranges::any_of(
+          queues, [](const auto& queue) { return !queue.empty(); });
+    }
+
+    std::array<std::deque<QueuedRequest>, kPriorityCount> queues;
+    std::list<Client> clients;
+    size_t active = 0;
+  };
 
-        if (ReachedMaxConnections(host)) {
+  // Sends the first request of the highest priority that a host with a free
+  // connection can take. Hosts take turns, so that a long queue for one host
+  // cannot hold back requests to others.
+  bool SendNext() {
+    for (size_t priority = 0; priority < kPriorityCount; ++priority) {
+      for (size_t i = 0; i < round_robin_.size(); ++i) {
+        auto& name = round_robin_[i];
+        auto& host = hosts_[name];
+        auto& queue = host.queues[priority];
+
+        if (queue.empty()) {
+          continue;
+        }
+        if (host.active >= kMaxSimultaneousConnectionsPerHost) {
           if (app.options.verbose) {
-            LOGD(L"Reached max connections for host: {}", StrToWstr(host));
+            LOGD(L"Reached max connections for host: {}", StrToWstr(name));
           }
-          break;
+          continue;
         }
 
-        auto& client = GetClient(host);
-        client.Send(item.request, item.on_transfer, item.on_response);
+        auto item = std::move(queue.front());
+        queue.pop_front();
+        --queued_;
+        taiga::stats.http_queue_depth = queued_;
+
+        const auto wait_time =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - item.queue_time);
+        taiga::stats.http_queue_wait_time += wait_time.count();
+        taiga::stats.http_requests_dispatched++;
+
+        // Move the host to the back of the line
+        auto host_name = std::move(name);
+        round_robin_.erase(round_robin_.begin() + i);
+        if (host.queued()) {
+          round_robin_.push_back(host_name);
+        }
 
-        items.erase(items.begin() + i--);
+        Send(host_name, host, std::move(item));
+        return true;
       }
     }
+
+    return false;
   }
 
-  void Shutdown() {
+  void Send(const std::string& name, Host& host, QueuedRequest&& item) {
+    ++host.active;
+    ++active_;
+
+    const auto on_response = [this, name, on_response = item.on_response](
+                                 const Response& response) {
+      OnComplete(name);
+      if (on_response) {
+        on_response(response);
+      }
+    };
+
+    auto& client = GetClient(name, host);
+    client.Send(item.request, item.on_transfer, on_response, item.on_body);
+  }
+
+  void OnComplete(const std::string& name) {
     std::lock_guard lock{mutex_};
 
-    shutdown_ = true;
-    queue_.clear();
+    const auto it = hosts_.find(name);
+    if (it == hosts_.end()) {
+      return;
+    }
 
-    for (auto& [host, clients] : connections_) {
-      for (auto& client : clients) {
-        client.Cancel();
+    auto& host = it->second;
+    --host.active;
+    --active_;
+
+    // Reap idle clients once there is nothing left to send to the host
+    if (!host.queued()) {
+      host.clients.remove_if([](const Client& client) {
+        return client.state() == Client::State::Ready;
+      });
+      if (host.clients.empty() && !host.active) {
+        hosts_.erase(it);
       }
     }
   }
 
-private:
-  Client& GetClient(const std::string& host) {
-    auto& clients = connections_[host];
+  Client& GetClient(const std::string& name, Host& host) {
+    auto& clients = host.clients;
 
     if (settings.GetAppConnectionReuseActive()) {
       for (auto& client : clients) {
         if (client.state() == Client::State::Ready) {
           if (app.options.verbose) {
-            LOGD(L"Reusing client for {}", StrToWstr(host));
+            LOGD(L"Reusing client for {}", StrToWstr(name));
           }
           return client;
         }
@@ -306,44 +793,15 @@ private:
 
     auto& client = clients.emplace_back();
     if (app.options.verbose) {
-      LOGD(L"Created new client for {} ({})", StrToWstr(host), clients.size());
+      LOGD(L"Created new client for {} ({})", StrToWstr(name), clients.size());
     }
     return client;
   }
 
-  bool ReachedMaxConnections() const {
-    constexpr size_t kMaxSimultaneousConnections = 10;
-    size_t connections = 0;
-    for (const auto& [host, clients] : connections_) {
-      for (const auto& client : clients) {
-        if (client.state() != Client::State::Ready) {
-          if (++connections == kMaxSimultaneousConnections) {
-            return true;
-          }
-        }
-      }
-    }
-    return false;
-  }
-
-  bool ReachedMaxConnections(const std::string& host) const {
-    constexpr size_t kMaxSimultaneousConnectionsPerHost = 6;
-    const auto it = connections_.find(host);
-    if (it != connections_.end()) {
-      size_t connections = 0;
-      for (const auto& client : it->second) {
-        if (client.state() != Client::State::Ready) {
-          if (++connections == kMaxSimultaneousConnectionsPerHost) {
-            return true;
-          }
-        }
-      }
-    }
-    return false;
-  }
-
-  std::map<std::string, std::list<Client>> connections_;
-  std::map<std::string, std::vector<QueuedRequest>> queue_;
+  std::map<std::string, Host> hosts_;
+  std::deque<std::string> round_robin_;
+  size_t active_ = 0;
+  size_t queued_ = 0;
 
   std::mutex mutex_;
   bool shutdown_ = false;
@@ -413,24 +871,155 @@ std::wstring to_string(const Transfer& transfer) {
 
 }  // namespace util
 
+static detail::Cache cache;
 static detail::Pool pool;
 
 void Init() {
   hypr::init();
+  cache.Load();
+  detail::engine.Init();
+}
+
+void ProcessCallbacks() {
+  detail::engine.ProcessCallbacks();
 }
 
 void ProcessQueue() {
   pool.ProcessQueue();
 }
 
+void SetWindowHandle(HWND hwnd) {
+  detail::engine.SetWindowHandle(hwnd);
+}
+
 void Shutdown() {
   pool.Shutdown();
+  detail::engine.Shutdown();
+  cache.Save();
+}
+
+// Streams a body that was served from the cache to the caller, the same way
+// as a body that is received from the network
+static ResponseCallback WithCachedBody(const ResponseCallback& on_response,
+                                       const BodyCallback& on_body) {
+  if (!on_body)
+    return on_response;
+
+  return [on_response, on_body](const Response& response) {
+    if (!on_body(response, response.body())) {
+      auto aborted_response = response;
+      aborted_response.set_error(
+          Error{CURLE_WRITE_ERROR, "Transfer aborted by the caller."});
+      if (on_response) {
+        on_response(aborted_response);
+      }
+      return;
+    }
+    if (on_response) {
+      on_response(response);
+    }
+  };
 }
 
+// Streamed bodies are written to a temporary file as they arrive, so that
+// they can be stored in the cache without holding them in memory
+struct CachedBody {
+  std::wstring path;
+  std::ofstream file;
+  detail::ContentHash hash;
+  size_t size = 0;
+  bool failed = false;
+};
+
 void Send(const Request& request,
           const TransferCallback& on_transfer,
-          const ResponseCallback& on_response) {
-  pool.AddToQueue({request, on_transfer, on_response});
+          const ResponseCallback& on_response,
+          const Priority priority,
+          const BodyCallback& on_body) {
+  if (!cache.IsCacheable(request)) {
+    pool.AddToQueue({request, on_transfer, on_response, on_body, priority});
+    pool.ProcessQueue();
+    return;
+  }
+
+  // Serve fresh responses from the cache without making a request
+  if (auto cached_response = cache.GetFresh(request)) {
+    taiga::stats.http_cache_hits++;
+    detail::engine.Deliver(std::move(*cached_response),
+                           WithCachedBody(on_response, on_body));
+    return;
+  }
+
+  // Stale responses are revalidated, so that the body is not sent again if
+  // it has not changed
+  auto conditional_request = request;
+  const bool revalidating = cache.AddValidators(conditional_request);
+
+  const auto cached_body =
+      on_body ? std::make_shared<CachedBody>() : nullptr;
+
+  const auto cache_on_body = [cached_body, on_body](const Response& response,
+                                                    std::string_view data) {
+    if (response.status_code() == hypp::status::k200_OK &&
+        !cached_body->failed) {
+      if (!cached_body->file.is_open()) {
+        cached_body->path = cache.CreateTempBodyPath();
+        cached_body->file.open(cached_body->path,
+                               std::ios::binary | std::ios::trunc);
+      }
+      cached_body->file.write(data.data(), data.size());
+      cached_body->hash.Update(data);
+      cached_body->size += data.size();
+      cached_body->failed = !cached_body->file.good();
+    }
+    return on_body(response, data);
+  };
+
+  const auto cache_on_response = [request, on_transfer, on_response, priority,
+                                  on_body, revalidating, cached_body](
+                                     const Response& response) {
+    if (cached_body && cached_body->file.is_open()) {
+      cached_body->file.close();
+    }
+
+    if (revalidating &&
+        response.status_code() == hypp::status::k304_Not_Modified) {
+      if (auto cached_response = cache.Revalidate(request, response)) {
+        taiga::stats.http_cache_hits++;
+        WithCachedBody(on_response, on_body)(*cached_response);
+        return;
+      }
+      // The entry was evicted while the request was in flight, so the body
+      // has to be requested again
+      LOGD(L"Cache entry is gone, resending request: {}",
+           StrToWstr(hypp::to_string(request.target())));
+      Send(request, on_transfer, on_response, priority, on_body);
+      return;
+    }
+
+    if (!response.error() &&
+        response.status_code() == hypp::status::k200_OK) {
+      taiga::stats.http_cache_misses++;
+      if (!cached_body) {
+        cache.Put(request, response, response.body());
+      } else if (!cached_body->path.empty() && !cached_body->failed) {
+        cache.PutFile(request, response, cached_body->path,
+                      cached_body->hash.str(), cached_body->size);
+        cached_body->path.clear();
+      }
+    }
+
+    if (cached_body && !cached_body->path.empty()) {
+      ::DeleteFile(cached_body->path.c_str());
+    }
+
+    if (on_response) {
+      on_response(response);
+    }
+  };
+
+  pool.AddToQueue({conditional_request, on_transfer, cache_on_response,
+                   on_body ? BodyCallback{cache_on_body} : nullptr, priority});
   pool.ProcessQueue();
 }
 
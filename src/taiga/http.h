@@ -21,6 +21,8 @@
 #include <functional>
 #include <string_view>
 
+#include <windows.h>
+
 #include <hypp.hpp>
 #include <hypr.hpp>
 
@@ -32,16 +34,34 @@ using Response = hypr::Response;
 using Transfer = hypr::detail::Transfer;
 using Uri = hypp::Uri;
 
+// Receives the response body in chunks as it arrives, instead of having it
+// buffered in the response. Status code and headers are already available.
+using BodyCallback = std::function<bool(const Response&, std::string_view)>;
 using ResponseCallback = std::function<void(const Response&)>;
 using TransferCallback = std::function<bool(const Transfer&)>;
 
+// Requests with a higher priority are sent first. User-initiated requests
+// should use the default priority, while image downloads and automatic feed
+// checks can wait.
+enum class Priority {
+  Normal,
+  Background,
+};
+
+// Posted to the main window when responses are ready to be processed
+constexpr unsigned int WM_HTTPCALLBACK = WM_APP + 0x33;
+
 void Init();
+void ProcessCallbacks();
 void ProcessQueue();
+void SetWindowHandle(HWND hwnd);
 void Shutdown();
 
 void Send(const Request& request,
           const TransferCallback& on_transfer,
-          const ResponseCallback& on_response);
+          const ResponseCallback& on_response,
+          const Priority priority = Priority::Normal,
+          const BodyCallback& on_body = nullptr);
 
 namespace util {
 
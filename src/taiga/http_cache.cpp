@@ -0,0 +1,508 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+
+#include "taiga/http_cache.h"
+
+#include <nstd/string.hpp>
+
+#include "base/file.h"
+#include "base/format.h"
+#include "base/log.h"
+#include "base/string.h"
+#include "base/xml.h"
+#include "taiga/path.h"
+
+namespace taiga::http::detail {
+
+struct CacheControl {
+  bool no_cache = false;
+  bool no_store = false;
+  time_t max_age = -1;
+};
+
+static std::string_view TrimView(std::string_view str) {
+  const auto is_space = [](char c) { return c == ' ' || c == '\t'; };
+  while (!str.empty() && is_space(str.front()))
+    str.remove_prefix(1);
+  while (!str.empty() && is_space(str.back()))
+    str.remove_suffix(1);
+  return str;
+}
+
+static std::vector<std::string> SplitList(const std::string& value) {
+  std::vector<std::string> items;
+  std::string_view str{value};
+  while (!str.empty()) {
+    const auto pos = str.find(',');
+    const auto item = TrimView(str.substr(0, pos));
+    if (!item.empty())
+      items.push_back(nstd::tolower_string(std::string{item}));
+    if (pos == str.npos)
+      break;
+    str.remove_prefix(pos + 1);
+  }
+  return items;
+}
+
+static CacheControl ParseCacheControl(const std::string& value) {
+  CacheControl cache_control;
+
+  for (const auto& directive : SplitList(value)) {
+    if (directive == "no-cache") {
+      cache_control.no_cache = true;
+    } else if (directive == "no-store") {
+      cache_control.no_store = true;
+    } else if (directive.starts_with("max-age=")) {
+      std::string_view seconds{directive};
+      seconds.remove_prefix(8);
+      if (seconds.size() > 1 && seconds.front() == '"' && seconds.back() == '"')
+        seconds = seconds.substr(1, seconds.size() - 2);
+      long long max_age = 0;
+      const auto [ptr, ec] = std::from_chars(
+          seconds.data(), seconds.data() + seconds.size(), max_age);
+      if (ec == std::errc{})
+        cache_control.max_age = static_cast<time_t>(max_age);
+    }
+  }
+
+  return cache_control;
+}
+
+static std::string GetContentHash(std::string_view data) {
+  ContentHash hash;
+  hash.Update(data);
+  return hash.str();
+}
+
+static std::string GetKey(const Request& request) {
+  auto key = hypp::to_string(request.target());
+
+  // Responses to authenticated requests belong to a particular account, and
+  // are kept apart from those of other accounts. Only a hash of the
+  // credentials is stored.
+  const auto authorization = request.header("authorization");
+  if (!authorization.empty())
+    key = "{}|{}"_format(GetContentHash(authorization), key);
+
+  return key;
+}
+
+static bool IsAuthenticated(const Request& request) {
+  return !request.header("authorization").empty();
+}
+
+static time_t GetAge(const Response& response) {
+  const auto age = response.header("age");
+  long long value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(age.data(), age.data() + age.size(), value);
+  return ec == std::errc{} ? static_cast<time_t>(value) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ContentHash::Update(std::string_view data) {
+  for (const auto c : data) {
+    value_ ^= static_cast<unsigned char>(c);
+    value_ *= 1099511628211ull;
+  }
+}
+
+std::string ContentHash::str() const {
+  return "{:016x}"_format(value_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Cache::Cache(const std::wstring& path, size_t max_size)
+    : path_{path}, max_size_{max_size} {
+}
+
+void Cache::Load() {
+  std::lock_guard lock{mutex_};
+
+  entries_.clear();
+  keys_.clear();
+  body_refs_.clear();
+  size_ = 0;
+
+  XmlDocument document;
+  const auto parse_result =
+      XmlLoadFileToDocument(document, GetPath() + L"cache.xml");
+
+  if (parse_result) {
+    auto cache_node = document.child(L"cache");
+    for (auto node : cache_node.children(L"entry")) {
+      Entry entry;
+      entry.key = WstrToStr(node.attribute(L"key").value());
+      entry.url = WstrToStr(node.attribute(L"url").value());
+      entry.body_hash = WstrToStr(node.attribute(L"body").value());
+      entry.body_size = node.attribute(L"size").as_ullong();
+      entry.stored_time = node.attribute(L"stored").as_llong();
+      entry.max_age = node.attribute(L"max_age").as_llong(-1);
+      entry.no_cache = node.attribute(L"no_cache").as_bool();
+      for (auto header : node.children(L"header")) {
+        entry.headers.emplace_back(
+            WstrToStr(header.attribute(L"name").value()),
+            WstrToStr(header.attribute(L"value").value()));
+      }
+      for (auto vary : node.children(L"vary")) {
+        entry.vary.emplace_back(WstrToStr(vary.attribute(L"name").value()),
+                                WstrToStr(vary.attribute(L"value").value()));
+      }
+      if (entry.key.empty() || entry.body_hash.empty() ||
+          keys_.contains(entry.key)) {
+        continue;
+      }
+      if (body_refs_[entry.body_hash]++ == 0)
+        size_ += entry.body_size;
+      keys_[entry.key] = entries_.insert(entries_.end(), std::move(entry));
+    }
+  }
+
+  // Remove bodies that are no longer referenced (e.g. if the index could not
+  // be saved on exit), along with unfinished temporary files
+  std::vector<std::wstring> files;
+  PopulateFiles(files, GetPath());
+  for (const auto& file : files) {
+    if (file != L"cache.xml" && !body_refs_.contains(WstrToStr(file)))
+      ::DeleteFile((GetPath() + file).c_str());
+  }
+
+  modified_ = false;
+}
+
+bool Cache::Save() {
+  std::lock_guard lock{mutex_};
+
+  if (!modified_)
+    return true;
+
+  XmlDocument document;
+  auto cache_node = document.append_child(L"cache");
+
+  for (const auto& entry : entries_) {
+    auto node = cache_node.append_child(L"entry");
+    node.append_attribute(L"key") = StrToWstr(entry.key).c_str();
+    node.append_attribute(L"url") = StrToWstr(entry.url).c_str();
+    node.append_attribute(L"body") = StrToWstr(entry.body_hash).c_str();
+    node.append_attribute(L"size") =
+        static_cast<unsigned long long>(entry.body_size);
+    node.append_attribute(L"stored") =
+        static_cast<long long>(entry.stored_time);
+    node.append_attribute(L"max_age") = static_cast<long long>(entry.max_age);
+    if (entry.no_cache)
+      node.append_attribute(L"no_cache") = true;
+    for (const auto& [name, value] : entry.headers) {
+      auto header = node.append_child(L"header");
+      header.append_attribute(L"name") = StrToWstr(name).c_str();
+      header.append_attribute(L"value") = StrToWstr(value).c_str();
+    }
+    for (const auto& [name, value] : entry.vary) {
+      auto vary = node.append_child(L"vary");
+      vary.append_attribute(L"name") = StrToWstr(name).c_str();
+      vary.append_attribute(L"value") = StrToWstr(value).c_str();
+    }
+  }
+
+  if (!XmlSaveDocumentToFile(document, GetPath() + L"cache.xml"))
+    return false;
+
+  modified_ = false;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Cache::IsCacheable(const Request& request) const {
+  if (request.method() != "GET")
+    return false;
+
+  // Requests that are validated or partially fetched by the caller are left
+  // alone
+  if (!request.header("if-none-match").empty() ||
+      !request.header("if-modified-since").empty() ||
+      !request.header("range").empty()) {
+    return false;
+  }
+
+  return !ParseCacheControl(request.header("cache-control")).no_store;
+}
+
+bool Cache::IsStorable(const Response& response) const {
+  if (response.error() || response.status_code() != hypp::status::k200_OK)
+    return false;
+
+  const auto cache_control = ParseCacheControl(response.header("cache-control"));
+  if (cache_control.no_store)
+    return false;
+
+  if (response.header("vary") == "*")
+    return false;
+
+  return cache_control.max_age > 0 || !response.header("etag").empty() ||
+         !response.header("last-modified").empty();
+}
+
+std::optional<Response> Cache::GetFresh(const Request& request) {
+  // Responses to authenticated requests are always revalidated, so that
+  // changes made to the account elsewhere are never hidden
+  if (IsAuthenticated(request))
+    return std::nullopt;
+
+  std::lock_guard lock{mutex_};
+
+  const auto it = Find(request);
+  if (it == entries_.end() || !IsFresh(*it))
+    return std::nullopt;
+
+  auto response = Read(*it);
+  if (!response) {
+    Remove(it);
+    return std::nullopt;
+  }
+
+  Touch(it);
+  return response;
+}
+
+bool Cache::AddValidators(Request& request) const {
+  std::lock_guard lock{mutex_};
+
+  const auto it = const_cast<Cache*>(this)->Find(request);
+  if (it == entries_.end())
+    return false;
+
+  bool added = false;
+  for (const auto& [name, value] : it->headers) {
+    if (name == "etag") {
+      request.set_header("If-None-Match", value);
+      added = true;
+    } else if (name == "last-modified") {
+      request.set_header("If-Modified-Since", value);
+      added = true;
+    }
+  }
+  return added;
+}
+
+std::optional<Response> Cache::Revalidate(const Request& request,
+                                          const Response& response) {
+  std::lock_guard lock{mutex_};
+
+  const auto it = Find(request);
+  if (it == entries_.end())
+    return std::nullopt;
+
+  auto cached_response = Read(*it);
+  if (!cached_response) {
+    Remove(it);
+    return std::nullopt;
+  }
+
+  auto& entry = *it;
+
+  // Validators and freshness information sent with a 304 response supersede
+  // the stored ones
+  const auto cache_control = response.header("cache-control");
+  if (!cache_control.empty()) {
+    const auto directives = ParseCacheControl(cache_control);
+    entry.max_age = directives.max_age;
+    entry.no_cache = directives.no_cache;
+  }
+  for (const auto name : {"etag", "last-modified", "cache-control"}) {
+    const auto value = response.header(name);
+    if (value.empty())
+      continue;
+    const auto header = std::ranges::find(
+        entry.headers, name, &std::pair<std::string, std::string>::first);
+    if (header != entry.headers.end()) {
+      header->second = value;
+    } else {
+      entry.headers.emplace_back(name, value);
+    }
+    cached_response->set_header(name, value);
+  }
+  entry.stored_time = std::time(nullptr) - GetAge(response);
+
+  Touch(it);
+  return cached_response;
+}
+
+void Cache::Put(const Request& request, const Response& response,
+                const std::string& body) {
+  if (!IsStorable(response) || body.empty())
+    return;
+
+  std::lock_guard lock{mutex_};
+
+  Add(request, response, GetContentHash(body), body.size(),
+      [&body](const std::wstring& path) { return SaveToFile(body, path); });
+}
+
+void Cache::PutFile(const Request& request, const Response& response,
+                    const std::wstring& path, const std::string& body_hash,
+                    size_t body_size) {
+  if (IsStorable(response) && body_size > 0) {
+    std::lock_guard lock{mutex_};
+
+    Add(request, response, body_hash, body_size,
+        [&path](const std::wstring& body_path) {
+          return ::MoveFileEx(path.c_str(), body_path.c_str(),
+                              MOVEFILE_REPLACE_EXISTING) != FALSE;
+        });
+  }
+
+  // The file is still there if an identical body was already stored, or if
+  // it could not be moved
+  ::DeleteFile(path.c_str());
+}
+
+std::wstring Cache::CreateTempBodyPath() const {
+  static std::atomic<unsigned int> counter = 0;
+  CreateFolder(GetPath());
+  return GetPath() + L"{}_{}.tmp"_format(::GetCurrentProcessId(), counter++);
+}
+
+void Cache::Add(const Request& request, const Response& response,
+                const std::string& body_hash, size_t body_size,
+                const BodyWriter& write_body) {
+  Entry entry;
+  entry.key = GetKey(request);
+  entry.url = response.url().empty() ? hypp::to_string(request.target())
+                                     : response.url();
+  entry.body_hash = body_hash;
+  entry.body_size = body_size;
+  entry.stored_time = std::time(nullptr) - GetAge(response);
+
+  const auto cache_control = ParseCacheControl(response.header("cache-control"));
+  entry.max_age = cache_control.max_age;
+  entry.no_cache = cache_control.no_cache;
+
+  // The body is stored decoded, so headers that describe the transfer itself
+  // no longer apply
+  for (const auto& [name, value] : response.headers()) {
+    if (name == "content-encoding" || name == "content-length" ||
+        name == "transfer-encoding") {
+      continue;
+    }
+    entry.headers.emplace_back(name, value);
+  }
+
+  for (const auto& name : SplitList(response.header("vary"))) {
+    entry.vary.emplace_back(name, request.header(name));
+  }
+
+  if (const auto it = keys_.find(entry.key); it != keys_.end())
+    Remove(it->second);
+
+  // Identical bodies are stored only once
+  if (body_refs_[entry.body_hash]++ == 0) {
+    if (!write_body(GetBodyPath(entry.body_hash))) {
+      body_refs_.erase(entry.body_hash);
+      return;
+    }
+    size_ += entry.body_size;
+  }
+
+  const auto key = entry.key;
+  entries_.push_front(std::move(entry));
+  keys_[key] = entries_.begin();
+  modified_ = true;
+
+  Trim();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Cache::Entries::iterator Cache::Find(const Request& request) {
+  const auto it = keys_.find(GetKey(request));
+  if (it == keys_.end())
+    return entries_.end();
+
+  // Headers selected by the "Vary" header must match those of the original
+  // request
+  for (const auto& [name, value] : it->second->vary) {
+    if (request.header(name) != value)
+      return entries_.end();
+  }
+
+  return it->second;
+}
+
+bool Cache::IsFresh(const Entry& entry) const {
+  if (entry.no_cache || entry.max_age < 0)
+    return false;
+  return std::time(nullptr) < entry.stored_time + entry.max_age;
+}
+
+std::optional<Response> Cache::Read(const Entry& entry) const {
+  Response response;
+  if (!ReadFromFile(GetBodyPath(entry.body_hash), response.body()))
+    return std::nullopt;
+
+  response.set_status_code(hypp::status::k200_OK);
+  response.set_url(entry.url);
+  for (const auto& [name, value] : entry.headers) {
+    response.set_header(name, value);
+  }
+
+  return response;
+}
+
+void Cache::Remove(Entries::iterator it) {
+  if (const auto ref = body_refs_.find(it->body_hash);
+      ref != body_refs_.end() && --ref->second == 0) {
+    ::DeleteFile(GetBodyPath(it->body_hash).c_str());
+    size_ -= std::min(size_, it->body_size);
+    body_refs_.erase(ref);
+  }
+
+  keys_.erase(it->key);
+  entries_.erase(it);
+  modified_ = true;
+}
+
+void Cache::Touch(Entries::iterator it) {
+  entries_.splice(entries_.begin(), entries_, it);
+  modified_ = true;
+}
+
+void Cache::Trim() {
+  while (size_ > max_size_ && entries_.size() > 1) {
+    const auto it = std::prev(entries_.end());
+    LOGD(L"Evicting {} ({} bytes)", StrToWstr(it->url), it->body_size);
+    Remove(it);
+  }
+}
+
+std::wstring Cache::GetBodyPath(const std::string& body_hash) const {
+  return GetPath() + StrToWstr(body_hash);
+}
+
+std::wstring Cache::GetPath() const {
+  if (!path_.empty())
+    return path_;
+  return GetPathOnly(taiga::GetPath(taiga::Path::DatabaseAnime)) + L"http\\";
+}
+
+}  // namespace taiga::http::detail
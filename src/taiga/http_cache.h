@@ -0,0 +1,133 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "taiga/http.h"
+
+namespace taiga::http::detail {
+
+// FNV-1a hash of a body, which can be computed while it is being received
+class ContentHash final {
+public:
+  void Update(std::string_view data);
+  std::string str() const;
+
+private:
+  uint64_t value_ = 14695981039346656037ull;
+};
+
+// A private, disk-backed cache for GET requests. Response bodies are stored
+// under the hash of their content, so that identical bodies are kept only
+// once, and the least recently used entries are evicted when the cache grows
+// beyond its size limit.
+class Cache final {
+public:
+  Cache() = default;
+
+  // Keeps the cache in another folder, with another size limit (e.g. for
+  // tests). The path must end with a backslash.
+  Cache(const std::wstring& path, size_t max_size);
+
+  void Load();
+  bool Save();
+
+  bool IsCacheable(const Request& request) const;
+  bool IsStorable(const Response& response) const;
+
+  // Returns the cached response, if it is fresh enough to be served without
+  // contacting the server
+  std::optional<Response> GetFresh(const Request& request);
+
+  // Adds validators of a stale entry to the request, so that the server can
+  // reply with "304 Not Modified" instead of sending the body again
+  bool AddValidators(Request& request) const;
+
+  // Returns the cached response after the server has confirmed it is still
+  // valid, updating its freshness
+  std::optional<Response> Revalidate(const Request& request,
+                                     const Response& response);
+
+  void Put(const Request& request, const Response& response,
+           const std::string& body);
+
+  // Stores a body that was streamed to a temporary file (see
+  // CreateTempBodyPath). The file is moved into the cache, or deleted if it
+  // cannot be stored.
+  void PutFile(const Request& request, const Response& response,
+               const std::wstring& path, const std::string& body_hash,
+               size_t body_size);
+
+  std::wstring CreateTempBodyPath() const;
+
+private:
+  using Headers = std::vector<std::pair<std::string, std::string>>;
+
+  struct Entry {
+    std::string key;
+    std::string url;
+    std::string body_hash;
+    size_t body_size = 0;
+    Headers headers;
+    Headers vary;
+    time_t stored_time = 0;
+    time_t max_age = -1;
+    bool no_cache = false;
+  };
+
+  using Entries = std::list<Entry>;
+
+  using BodyWriter = std::function<bool(const std::wstring& path)>;
+
+  void Add(const Request& request, const Response& response,
+           const std::string& body_hash, size_t body_size,
+           const BodyWriter& write_body);
+  Entries::iterator Find(const Request& request);
+  bool IsFresh(const Entry& entry) const;
+  std::optional<Response> Read(const Entry& entry) const;
+  void Remove(Entries::iterator it);
+  void Touch(Entries::iterator it);
+  void Trim();
+
+  std::wstring GetBodyPath(const std::string& body_hash) const;
+  std::wstring GetPath() const;
+
+  Entries entries_;  // most recently used first
+  std::unordered_map<std::string, Entries::iterator> keys_;
+  std::map<std::string, size_t> body_refs_;
+  std::wstring path_;
+  size_t max_size_ = 64 * 1024 * 1024;  // 64 MiB
+  size_t size_ = 0;
+  bool modified_ = false;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace taiga::http::detail
@@ -0,0 +1,102 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "taiga/persistence.h"
+
+#include "base/log.h"
+#include "media/anime_db.h"
+#include "media/library/history.h"
+#include "taiga/path.h"
+
+namespace taiga {
+
+// Changes are written after there have been none for a few seconds, but never
+// later than this long after the first one.
+constexpr time_t kDebounceDelay = 3;  // seconds
+constexpr time_t kMaximumDelay = 30;  // seconds
+
+static std::wstring GetStorePath(const Store store) {
+  switch (store) {
+    case Store::Database:
+      return GetPath(Path::DatabaseAnime);
+    case Store::History:
+      return GetPath(Path::UserHistory);
+    case Store::List:
+      return GetPath(Path::UserLibrary);
+    default:
+      return {};
+  }
+}
+
+void Persistence::MarkDirty(const Store store) {
+  MarkDirty(store, GetStorePath(store));
+}
+
+void Persistence::MarkDirty(const Store store, const std::wstring& path) {
+  const auto now = time(nullptr);
+
+  if (dirty_.empty())
+    first_change_ = now;
+  last_change_ = now;
+
+  dirty_.try_emplace(store, path);
+}
+
+bool Persistence::IsDirty(const Store store) const {
+  return dirty_.contains(store);
+}
+
+void Persistence::Flush() {
+  // Saving can mark stores dirty again, so we work on a copy
+  const auto dirty = std::move(dirty_);
+  dirty_.clear();
+
+  for (const auto& [store, path] : dirty) {
+    bool result = false;
+    switch (store) {
+      case Store::Database:
+        result = anime::db.SaveDatabase();
+        break;
+      case Store::History:
+        result = library::history.SaveToFile(path);
+        break;
+      case Store::List:
+        result = anime::db.SaveListToFile(path);
+        break;
+    }
+    if (!result) {
+      // Saving is attempted again on a later tick
+      LOGW(L"Could not save file: {}", path);
+      MarkDirty(store, path);
+    }
+  }
+}
+
+void Persistence::Tick() {
+  if (dirty_.empty())
+    return;
+
+  const auto now = time(nullptr);
+
+  if (now - last_change_ >= kDebounceDelay ||
+      now - first_change_ >= kMaximumDelay) {
+    Flush();
+  }
+}
+
+}  // namespace taiga
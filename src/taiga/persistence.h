@@ -0,0 +1,55 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <string>
+
+namespace taiga {
+
+enum class Store {
+  Database,
+  History,  // includes the update queue
+  List,
+};
+
+// Changes are written to disk after they settle, so that a burst of changes
+// results in a single write for each file.
+class Persistence {
+public:
+  void MarkDirty(const Store store);
+  bool IsDirty(const Store store) const;
+
+  void Flush();
+  void Tick();
+
+private:
+  void MarkDirty(const Store store, const std::wstring& path);
+
+  // Files are user-specific, so we keep the path at the time of the first
+  // change, in case the user changes before the next flush.
+  std::map<Store, std::wstring> dirty_;
+  time_t first_change_ = 0;
+  time_t last_change_ = 0;
+};
+
+inline Persistence persistence;
+
+}  // namespace taiga
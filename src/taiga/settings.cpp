@@ -29,6 +29,7 @@
 #include "sync/service.h"
 #include "sync/sync.h"
 #include "taiga/path.h"
+#include "taiga/persistence.h"
 #include "taiga/stats.h"
 #include "taiga/timer.h"
 #include "taiga/version.h"
@@ -143,6 +144,13 @@ bool Settings::DeserializeFromXml(const std::wstring& path) {
     library_folders_.push_back(folder.attribute(L"folder").value());
   }
 
+  // Torrent sources
+  torrent_discovery_sources_.clear();
+  const auto node_sources = settings.child(L"rss").child(L"torrent").child(L"source");
+  for (const auto source : node_sources.children(L"feed")) {
+    torrent_discovery_sources_.push_back(source.attribute(L"address").value());
+  }
+
   // Anime items
   const auto node_items = settings.child(L"anime").child(L"items");
   for (const auto item : node_items.children(L"item")) {
@@ -226,6 +234,13 @@ bool Settings::SerializeToXml(const std::wstring& path) const {
     root.append_attribute(L"folder") = folder.c_str();
   }
 
+  // Torrent sources
+  auto sources = settings.child(L"rss").child(L"torrent").child(L"source");
+  for (const auto& source : torrent_discovery_sources_) {
+    auto feed = sources.append_child(L"feed");
+    feed.append_attribute(L"address") = source.c_str();
+  }
+
   // Anime items
   auto items = settings.child(L"anime").append_child(L"items");
   for (const auto& [anime_id, anime_item] : anime_settings_) {
@@ -273,6 +288,7 @@ bool Settings::SerializeToXml(const std::wstring& path) const {
 
 void Settings::ApplyChanges() {
   if (changed_account_or_service_) {
+    persistence.Flush();  // pending changes belong to the previous user
     anime::db.LoadList();
     library::history.Load();
     CurrentEpisode.Set(anime::ID_UNKNOWN);
@@ -352,6 +352,10 @@ public:
   std::vector<std::wstring> GetLibraryFolders() const;
   void SetLibraryFolders(const std::vector<std::wstring>& folders);
 
+  std::vector<std::wstring> GetTorrentDiscoverySources() const;
+  std::vector<std::wstring> GetTorrentDiscoveryAdditionalSources() const;
+  void SetTorrentDiscoveryAdditionalSources(const std::vector<std::wstring>& urls);
+
   bool GetMediaPlayerEnabled(const std::wstring& player) const;
   void SetMediaPlayerEnabled(const std::wstring& player, const bool enabled);
 
@@ -383,6 +387,7 @@ private:
   bool SerializeToXml(const std::wstring& path) const;
 
   std::vector<std::wstring> library_folders_;
+  std::vector<std::wstring> torrent_discovery_sources_;
   std::map<std::wstring, bool> media_players_enabled_;
   std::map<std::wstring, AnimeListColumn> anime_list_columns_;
   std::map<int, AnimeSettings> anime_settings_;
@@ -33,6 +33,7 @@
 #include "taiga/announce.h"
 #include "taiga/app.h"
 #include "taiga/config.h"
+#include "taiga/persistence.h"
 #include "taiga/settings.h"
 #include "track/feed_aggregator.h"
 #include "track/monitor.h"
@@ -312,8 +313,9 @@ void Settings::SetSyncActiveService(const sync::ServiceId service_id) {
         LOGW(L"Changing the active service from {} to {}.",
              sync::GetServiceNameById(previous_service_id),
              sync::GetServiceNameById(service_id));
+        persistence.Flush();
         anime::db.SaveList(true);
-        anime::db.items.clear();
+        anime::db.Clear();
         anime::db.SaveDatabase();
         ui::image_db.Clear();
         anime::season_db.Reset();
@@ -1433,6 +1435,27 @@ void Settings::SetLibraryFolders(const std::vector<std::wstring>& folders) {
   }
 }
 
+std::vector<std::wstring> Settings::GetTorrentDiscoverySources() const {
+  std::vector<std::wstring> urls{GetTorrentDiscoverySource()};
+  const auto additional_urls = GetTorrentDiscoveryAdditionalSources();
+  urls.insert(urls.end(), additional_urls.begin(), additional_urls.end());
+  return urls;
+}
+
+std::vector<std::wstring> Settings::GetTorrentDiscoveryAdditionalSources() const {
+  std::lock_guard lock{mutex_};
+  return torrent_discovery_sources_;
+}
+
+void Settings::SetTorrentDiscoveryAdditionalSources(
+    const std::vector<std::wstring>& urls) {
+  std::lock_guard lock{mutex_};
+  if (torrent_discovery_sources_ != urls) {
+    torrent_discovery_sources_ = urls;
+    modified_ = true;
+  }
+}
+
 bool Settings::GetMediaPlayerEnabled(const std::wstring& player) const {
   std::lock_guard lock{mutex_};
   const auto it = media_players_enabled_.find(player);
@@ -29,154 +29,206 @@
 
 namespace taiga {
 
-void Statistics::CalculateAll() {
-  CalculateAnimeCount();
-  CalculateEpisodeCount();
-  CalculateLifePlannedToWatch();
-  CalculateLifeSpentWatching();
-  CalculateLocalData();
-  CalculateMeanScore();
-  CalculateScoreDeviation();
-  CalculateScoreDistribution();
+// Folders are enumerated again when they are modified, or after this long
+constexpr time_t kFolderDataMaxAge = 10 * 60;  // 10 minutes
+
+static uint64_t GetLastWriteTime(const std::wstring& path) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!::GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data))
+    return 0;
+
+  ULARGE_INTEGER time;
+  time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+  time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+  return time.QuadPart;
 }
 
-int Statistics::CalculateAnimeCount() {
-  anime_count = 0;
+////////////////////////////////////////////////////////////////////////////////
 
-  for (const auto& [id, item] : anime::db.items) {
-    if (item.IsInList())
-      ++anime_count;
-  }
-
-  return anime_count;
+void Statistics::CalculateAll() {
+  OnListChange();
+  Update();
+  CalculateLocalData();
 }
 
-int Statistics::CalculateEpisodeCount() {
-  episode_count = 0;
-
-  for (const auto& [id, item] : anime::db.items) {
-    if (!item.IsInList())
-      continue;
-
-    episode_count += item.GetMyLastWatchedEpisode();
-    episode_count += item.GetMyRewatchedTimes() *
-                     item.GetEpisodeCount();
-  }
-
-  return episode_count;
+void Statistics::CalculateLocalData() {
+  const auto& images = GetFolderData(anime::GetImagePath(), L"", false);
+  image_count = images.file_count;
+  image_size = images.size;
+
+  const auto& torrents =
+      GetFolderData(taiga::GetPath(taiga::Path::Feed), L"torrent", true);
+  torrent_count = torrents.file_count;
+  torrent_size = torrents.size;
 }
 
-const std::wstring& Statistics::CalculateLifePlannedToWatch() {
-  int seconds = 0;
+void Statistics::Update() {
+  CalculateListData();
+  CalculateLocalData();
+}
 
-  for (const auto& [id, item] : anime::db.items) {
-    switch (item.GetMyStatus()) {
-      case anime::MyStatus::NotInList:
-      case anime::MyStatus::Completed:
-      case anime::MyStatus::Dropped:
-        continue;
-    }
+void Statistics::OnItemChange(const int anime_id) {
+  changed_items_.insert(anime_id);
+}
 
-    const int episodes =
-        EstimateEpisodeCount(item) - item.GetMyLastWatchedEpisode();
+void Statistics::OnListChange() {
+  list_changed_ = true;
+  changed_items_.clear();
+}
 
-    seconds += (EstimateDuration(item) * 60) * episodes;
-  }
+int Statistics::GetStatusCount(const anime::MyStatus status,
+                               const bool check_queue) {
+  CalculateListData();
 
-  life_planned_to_watch = seconds > 0 ? ToDateString(seconds) : L"None";
-  return life_planned_to_watch;
+  const auto& counts = check_queue ? queued_status_counts_ : status_counts_;
+  const auto it = counts.find(status);
+  return it != counts.end() ? it->second : 0;
 }
 
-const std::wstring& Statistics::CalculateLifeSpentWatching() {
-  int seconds = 0;
+////////////////////////////////////////////////////////////////////////////////
 
-  for (const auto& [id, item] : anime::db.items) {
-    if (!item.IsInList())
-      continue;
+Statistics::ItemData Statistics::CalculateItemData(const anime::Item& item) {
+  ItemData data;
 
-    int episodes_watched = item.GetMyLastWatchedEpisode();
-    episodes_watched += item.GetMyRewatchedTimes() * item.GetEpisodeCount();
+  data.in_list = item.IsInList();
+  data.score = item.GetMyScore();
 
-    seconds += (EstimateDuration(item) * 60) * episodes_watched;
-  }
+  // Rewatched items are counted as being watched
+  const bool rewatching = item.GetMyRewatching();
+  data.status = rewatching ? anime::MyStatus::Watching : item.GetMyStatus(false);
+  data.queued_status = rewatching ? anime::MyStatus::Watching : item.GetMyStatus();
 
-  life_spent_watching = seconds > 0 ? ToDateString(seconds) : L"None";
-  return life_spent_watching;
-}
+  const int duration = EstimateDuration(item) * 60;
 
-void Statistics::CalculateLocalData() {
-  std::vector<std::wstring> file_list;
+  if (data.in_list) {
+    data.episodes = item.GetMyLastWatchedEpisode() +
+                    item.GetMyRewatchedTimes() * item.GetEpisodeCount();
+    data.seconds_spent = duration * data.episodes;
+  }
 
-  image_count = PopulateFiles(file_list, anime::GetImagePath());
-  image_size = GetFolderSize(anime::GetImagePath(), false);
-  file_list.clear();
+  switch (item.GetMyStatus()) {
+    case anime::MyStatus::NotInList:
+    case anime::MyStatus::Completed:
+    case anime::MyStatus::Dropped:
+      break;
+    default:
+      data.seconds_planned =
+          duration *
+          (EstimateEpisodeCount(item) - item.GetMyLastWatchedEpisode());
+      break;
+  }
 
-  const auto path = taiga::GetPath(taiga::Path::Feed);
-  torrent_count = PopulateFiles(file_list, path, L"torrent", true);
-  torrent_size = GetFolderSize(path, true);
+  return data;
 }
 
-float Statistics::CalculateMeanScore() {
-  float items_scored = 0.0f;
-  float sum_scores = 0.0f;
+void Statistics::AddItemData(const ItemData& data, const int sign) {
+  seconds_planned_ += sign * data.seconds_planned;
 
-  for (const auto& [id, item] : anime::db.items) {
-    if (!item.IsInList())
-      continue;
+  if (data.in_list) {
+    anime_count += sign;
+    episode_count += sign * data.episodes;
+    seconds_spent_ += sign * data.seconds_spent;
 
-    if (item.GetMyScore() > 0) {
-      sum_scores += static_cast<float>(item.GetMyScore());
-      items_scored++;
+    if (data.score > 0) {
+      const auto score = static_cast<double>(data.score);
+      scored_count_ += sign;
+      score_sum_ += sign * score;
+      score_sum_squares_ += sign * score * score;
     }
   }
 
-  score_mean = items_scored > 0 ? (sum_scores / items_scored) : 0.0f;
+  if (data.score > 0) {
+    const auto score_index = static_cast<size_t>(std::floor(data.score / 10.0));
+    score_count[score_index] += sign;
+  }
 
-  return score_mean;
+  status_counts_[data.status] += sign;
+  queued_status_counts_[data.queued_status] += sign;
 }
 
-float Statistics::CalculateScoreDeviation() {
-  float items_scored = 0.0f;
-  float sum_squares = 0.0f;
-
-  for (const auto& [id, item] : anime::db.items) {
-    if (!item.IsInList())
-      continue;
+void Statistics::CalculateListData() {
+  if (!list_changed_ && changed_items_.empty())
+    return;
 
-    if (item.GetMyScore() > 0) {
-      float score = static_cast<float>(item.GetMyScore());
-      sum_squares += std::powf(score - score_mean, 2.0f);
-      items_scored++;
+  const auto update_item = [this](const int anime_id) {
+    if (const auto it = item_data_.find(anime_id); it != item_data_.end()) {
+      AddItemData(it->second, -1);
+      item_data_.erase(it);
+    }
+    if (const auto item = anime::db.Find(anime_id, false)) {
+      const auto data = CalculateItemData(*item);
+      AddItemData(data, 1);
+      item_data_.emplace(anime_id, data);
+    }
+  };
+
+  if (list_changed_) {
+    item_data_.clear();
+    anime_count = 0;
+    episode_count = 0;
+    seconds_planned_ = 0;
+    seconds_spent_ = 0;
+    scored_count_ = 0;
+    score_sum_ = 0.0;
+    score_sum_squares_ = 0.0;
+    score_count.fill(0);
+    status_counts_.clear();
+    queued_status_counts_.clear();
+
+    for (const auto& [id, item] : anime::db.items) {
+      update_item(id);
+    }
+  } else {
+    for (const auto id : changed_items_) {
+      update_item(id);
     }
   }
 
-  score_deviation =
-      items_scored > 0 ? std::sqrt(sum_squares / items_scored) : 0.0f;
-
-  return score_deviation;
-}
-
-const std::array<float, 11>& Statistics::CalculateScoreDistribution() {
-  score_count.fill(0);
-  score_distribution.fill(0.0f);
-
-  float extreme_value = 1.0f;
+  list_changed_ = false;
+  changed_items_.clear();
+
+  life_planned_to_watch =
+      seconds_planned_ > 0 ? ToDateString(seconds_planned_) : L"None";
+  life_spent_watching =
+      seconds_spent_ > 0 ? ToDateString(seconds_spent_) : L"None";
+
+  if (scored_count_ > 0) {
+    const double mean = score_sum_ / scored_count_;
+    const double variance = score_sum_squares_ / scored_count_ - mean * mean;
+    score_mean = static_cast<float>(mean);
+    score_deviation = static_cast<float>(std::sqrt(std::max(variance, 0.0)));
+  } else {
+    score_mean = 0.0f;
+    score_deviation = 0.0f;
+  }
 
-  for (const auto& [id, item] : anime::db.items) {
-    const int score = item.GetMyScore();
-    if (score > 0) {
-      const auto score_index = static_cast<size_t>(std::floor(score / 10.0));
-      ++score_count[score_index];
-      ++score_distribution[score_index];
-      extreme_value = std::max(score_distribution[score_index], extreme_value);
-    }
+  const int extreme_value =
+      std::max(1, *std::max_element(score_count.begin(), score_count.end()));
+  for (size_t i = 0; i < score_count.size(); ++i) {
+    score_distribution[i] = static_cast<float>(score_count[i]) / extreme_value;
   }
+}
 
-  for (auto& value : score_distribution) {
-    value = value / extreme_value;
+const Statistics::FolderData& Statistics::GetFolderData(
+    const std::wstring& path, const std::wstring& extension,
+    const bool recursive) {
+  auto& data = folder_data_[path];
+
+  // Adding, removing or renaming a file updates the modification time of its
+  // folder, so we only need to enumerate the files when that changes.
+  const auto last_write_time = GetLastWriteTime(path);
+  const auto now = time(nullptr);
+
+  if (!data.checked_time || data.last_write_time != last_write_time ||
+      now - data.checked_time > kFolderDataMaxAge) {
+    std::vector<std::wstring> file_list;
+    data.file_count = PopulateFiles(file_list, path, extension, recursive);
+    data.size = GetFolderSize(path, recursive);
+    data.last_write_time = last_write_time;
+    data.checked_time = now;
   }
 
-  return score_distribution;
+  return data;
 }
 
 }  // namespace taiga
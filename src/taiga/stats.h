@@ -19,26 +19,46 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
+
+namespace anime {
+class Item;
+enum class MyStatus;
+}
 
 namespace taiga {
 
 class Statistics {
 public:
   void CalculateAll();
-  int CalculateAnimeCount();
-  int CalculateEpisodeCount();
-  const std::wstring& CalculateLifePlannedToWatch();
-  const std::wstring& CalculateLifeSpentWatching();
   void CalculateLocalData();
-  float CalculateMeanScore();
-  float CalculateScoreDeviation();
-  const std::array<float, 11>& CalculateScoreDistribution();
+  void Update();
+
+  // List data is maintained incrementally, and only the items that have
+  // changed since the last update are recalculated.
+  void OnItemChange(const int anime_id);
+  void OnListChange();
+
+  int GetStatusCount(const anime::MyStatus status, const bool check_queue);
 
   int anime_count = 0;
   int connections_failed = 0;
   int connections_succeeded = 0;
   int episode_count = 0;
+  unsigned long long feed_bytes_received = 0;
+  int feed_checks = 0;
+  int feed_checks_not_modified = 0;
+  unsigned int http_cache_hits = 0;
+  unsigned int http_cache_misses = 0;
+  size_t http_queue_depth = 0;
+  size_t http_queue_depth_max = 0;
+  unsigned long long http_queue_wait_time = 0;  // in milliseconds
+  unsigned int http_requests_dispatched = 0;
   unsigned int image_count = 0;
   unsigned long long image_size = 0;
   std::wstring life_planned_to_watch;
@@ -49,8 +69,50 @@ public:
   std::array<float, 11> score_distribution{0.0f};
   int tigers_harmed = 0;
   unsigned int torrent_count = 0;
+  unsigned int torrent_downloads = 0;
+  unsigned long long torrent_download_time = 0;  // in milliseconds
   unsigned long long torrent_size = 0;
   int uptime = 0;
+
+private:
+  struct ItemData {
+    bool in_list = false;
+    int episodes = 0;
+    int seconds_planned = 0;
+    int seconds_spent = 0;
+    int score = 0;
+    anime::MyStatus status{};
+    anime::MyStatus queued_status{};
+  };
+
+  struct FolderData {
+    uint64_t last_write_time = 0;
+    time_t checked_time = 0;
+    unsigned int file_count = 0;
+    unsigned long long size = 0;
+  };
+
+  static ItemData CalculateItemData(const anime::Item& item);
+
+  void AddItemData(const ItemData& data, const int sign);
+  void CalculateListData();
+  const FolderData& GetFolderData(const std::wstring& path,
+                                  const std::wstring& extension,
+                                  const bool recursive);
+
+  std::unordered_map<int, ItemData> item_data_;
+  std::set<int> changed_items_;
+  bool list_changed_ = true;
+
+  int seconds_planned_ = 0;
+  int seconds_spent_ = 0;
+  int scored_count_ = 0;
+  double score_sum_ = 0.0;
+  double score_sum_squares_ = 0.0;
+  std::map<anime::MyStatus, int> status_counts_;
+  std::map<anime::MyStatus, int> queued_status_counts_;
+
+  std::map<std::wstring, FolderData> folder_data_;
 };
 
 inline taiga::Statistics stats;
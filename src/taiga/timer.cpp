@@ -24,6 +24,7 @@
 #include "media/anime_util.h"
 #include "media/library/queue.h"
 #include "taiga/announce.h"
+#include "taiga/persistence.h"
 #include "taiga/settings.h"
 #include "taiga/stats.h"
 #include "track/feed_aggregator.h"
@@ -43,6 +44,7 @@ static Timer timer_history(kTimerHistory, 5 * 60);     //  5 minutes
 static Timer timer_library(kTimerLibrary, 30 * 60);    // 30 minutes
 static Timer timer_media(kTimerMedia, 2 * 60, false);  //  2 minutes
 static Timer timer_memory(kTimerMemory, 10 * 60);      // 10 minutes
+static Timer timer_persistence(kTimerPersistence, 1);  //  1 second
 static Timer timer_stats(kTimerStats, 10);             // 10 seconds
 static Timer timer_torrents(kTimerTorrents, 60 * 60);  // 60 minutes
 
@@ -85,12 +87,18 @@ void Timer::OnTimeout() {
       ui::image_db.FreeMemory();
       break;
 
+    case kTimerPersistence:
+      persistence.Tick();
+      track::aggregator.RetryDeferredDownloads();
+      break;
+
     case kTimerStats:
-      taiga::stats.CalculateAll();
+      taiga::stats.Update();
       break;
 
     case kTimerTorrents:
-      track::aggregator.CheckFeed(settings.GetTorrentDiscoverySource(), true);
+      track::aggregator.CheckFeeds(settings.GetTorrentDiscoverySources(), true);
+      track::aggregator.ResumeDownloads();
       break;
   }
 }
@@ -111,6 +119,7 @@ void TimerManager::Initialize() {
   InsertTimer(&timer_library);
   InsertTimer(&timer_media);
   InsertTimer(&timer_memory);
+  InsertTimer(&timer_persistence);
   InsertTimer(&timer_stats);
   InsertTimer(&timer_torrents);
 }
@@ -29,6 +29,7 @@ enum TimerId {
   kTimerLibrary,
   kTimerMedia,
   kTimerMemory,
+  kTimerPersistence,
   kTimerStats,
   kTimerTorrents
 };
@@ -19,10 +19,11 @@
 #include "track/feed.h"
 
 #include "base/base64.h"
+#include "base/file.h"
+#include "base/format.h"
 #include "base/html.h"
 #include "base/string.h"
 #include "base/url.h"
-#include "base/xml.h"
 #include "taiga/path.h"
 #include "track/episode_util.h"
 #include "track/feed_filter.h"
@@ -41,6 +42,26 @@ static void TidyFeedItemDescription(std::wstring& description) {
   while (ReplaceString(description, L"  ", L" "));
 }
 
+// Reads items straight into the feed, instead of copying them from a
+// temporary list of rss::Item objects.
+class FeedReader final : public rss::Reader {
+public:
+  FeedReader(std::vector<FeedItem>& items) : items_(items) {}
+
+protected:
+  rss::Item& OnItemBegin() override {
+    return items_.emplace_back();
+  }
+
+  void OnItemEnd(rss::Item& item, bool valid) override {
+    if (!valid)
+      items_.pop_back();
+  }
+
+private:
+  std::vector<FeedItem>& items_;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void FeedItem::Discard(int option) {
@@ -98,6 +119,30 @@ bool FeedItem::operator==(const FeedItem& item) const {
   return false;
 }
 
+std::wstring GetFeedItemInfoHash(const FeedItem& item) {
+  std::wstring info_hash;
+
+  if (const auto value = item.namespace_element(L"nyaa:infoHash")) {
+    info_hash = *value;
+  } else {
+    const auto& magnet_link =
+        !item.magnet_link.empty() ? item.magnet_link : item.link;
+    if (StartsWith(magnet_link, L"magnet:")) {
+      info_hash = InStr(magnet_link + L"&", L"xt=urn:btih:", L"&");
+    }
+  }
+
+  return ToLower_Copy(info_hash);
+}
+
+std::wstring NormalizeFeedItemTitle(std::wstring title) {
+  ReplaceChar(title, L'_', L' ');
+  ToLower(title);
+  Trim(title);
+  while (ReplaceString(title, L"  ", L" "));
+  return title;
+}
+
 TorrentCategory GetTorrentCategory(const FeedItem& item) {
   // Respect our previous categorization
   if (item.torrent_category != TorrentCategory::Anime)
@@ -148,56 +193,53 @@ TorrentCategory TranslateTorrentCategory(const std::wstring& str) {
 std::wstring Feed::GetDataPath() const {
   std::wstring path = taiga::GetPath(taiga::Path::Feed);
 
-  if (!channel.link.empty()) {
-    Url url(channel.link);
-    path += Base64Encode(url.host(), true) + L"\\";
+  if (!url.empty()) {
+    path += Base64Encode(Url{url}.host(), true) + L"\\";
   }
 
   return path;
 }
 
-bool Feed::Load() {
-  items.clear();
-
-  XmlDocument document;
-  const auto path = GetDataPath() + L"feed.xml";
-  constexpr auto options = pugi::parse_default | pugi::parse_trim_pcdata;
-  const auto parse_result = XmlLoadFileToDocument(document, path, options);
+// Several sources may share a host, so each source is saved under the hash
+// of its full URL (FNV-1a)
+std::wstring Feed::GetDataFile() const {
+  uint64_t hash = 14695981039346656037ull;
+  for (const auto c : WstrToStr(url)) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return GetDataPath() + L"feed_{:016x}.xml"_format(hash);
+}
 
-  if (!parse_result)
+bool Feed::Load() {
+  std::string data;
+  if (!ReadFromFile(GetDataFile(), data)) {
+    items.clear();
     return false;
+  }
 
-  Load(document);
-  return true;
+  return Load(data);
 }
 
-bool Feed::Load(const std::wstring& data) {
+bool Feed::Load(const std::string_view data) {
   items.clear();
 
-  XmlDocument document;
-  const auto parse_result = document.load_string(data.c_str());
-
-  if (!parse_result)
+  FeedReader reader{items};
+  if (!reader.Parse(data)) {
+    items.clear();
     return false;
-
-  Load(document);
-  return true;
-}
-
-void Feed::Load(const XmlDocument& document) {
-  auto rss_feed = rss::ParseDocument(document);
-  channel = rss_feed.channel;
-
-  for (auto& item : rss_feed.items) {
-    items.push_back(FeedItem{std::move(item)});
   }
 
+  channel = reader.channel();
   source = GetFeedSource(channel.link);
 
   for (auto& item : items) {
+    item.feed_source = source;
     ParseFeedItemFromSource(source, item);
     TidyFeedItemDescription(item.description);
   }
+
+  return true;
 }
 
 }  // namespace track
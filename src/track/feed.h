@@ -21,16 +21,13 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/rss.h"
 #include "track/episode.h"
 #include "track/feed_source.h"
 
-namespace pugi {
-class xml_document;
-}
-
 namespace track {
 
 enum class FeedItemState {
@@ -57,6 +54,7 @@ public:
 
   std::wstring info_link;
   std::wstring magnet_link;
+  FeedSource feed_source = FeedSource::Unknown;
   FeedItemState state = FeedItemState::Blank;
   TorrentCategory torrent_category = TorrentCategory::Anime;
   std::optional<size_t> seeders;
@@ -73,18 +71,23 @@ public:
 class Feed {
 public:
   std::wstring GetDataPath() const;
+  std::wstring GetDataFile() const;
 
   bool Load();
-  bool Load(const std::wstring& data);
+  bool Load(const std::string_view data);
+
+  // The URL that the feed was requested from. Data files are named after it,
+  // because the channel link within the feed may point somewhere else.
+  std::wstring url;
 
   FeedSource source = FeedSource::Unknown;
   rss::Channel channel;
   std::vector<FeedItem> items;
-
-private:
-  void Load(const pugi::xml_document& document);
 };
 
+std::wstring GetFeedItemInfoHash(const FeedItem& item);
+std::wstring NormalizeFeedItemTitle(std::wstring title);
+
 TorrentCategory GetTorrentCategory(const FeedItem& item);
 std::wstring TranslateTorrentCategory(TorrentCategory category);
 TorrentCategory TranslateTorrentCategory(const std::wstring& str);
@@ -33,6 +33,7 @@
 #include "taiga/http.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
+#include "taiga/stats.h"
 #include "track/episode_util.h"
 #include "track/feed_filter_manager.h"
 #include "track/recognition.h"
@@ -65,51 +66,113 @@ Feed& Aggregator::GetFeed() {
 }
 
 bool Aggregator::CheckFeed(const std::wstring& source, bool automatic) {
-  if (source.empty())
+  return CheckFeeds({source}, automatic);
+}
+
+bool Aggregator::CheckFeeds(const std::vector<std::wstring>& sources,
+                            bool automatic) {
+  std::vector<std::wstring> unique_sources;
+  for (const auto& source : sources) {
+    if (source.empty())
+      continue;
+    if (std::find(unique_sources.begin(), unique_sources.end(), source) ==
+        unique_sources.end()) {
+      unique_sources.push_back(source);
+    }
+  }
+
+  if (unique_sources.empty())
     return false;
 
-  auto& feed = GetFeed();
+  std::vector<taiga::http::Request> requests;
 
-  feed.channel.link = source;
+  {
+    std::lock_guard lock{mutex_};
+
+    if (feed_check_) {
+      LOGD(L"Feed check is already in progress.");
+      return false;
+    }
+
+    for (const auto& source : unique_sources) {
+      taiga::http::Request request;
+      request.set_target(WstrToStr(source));
+      request.set_headers({
+          {"Accept", "application/rss+xml, */*"},
+          {"Accept-Encoding", "gzip"}});
+
+      // Validators are only useful if we still have the items that we parsed
+      // from the source, because there is nothing to fall back on otherwise.
+      const auto it = source_feeds_.find(source);
+      if (it != source_feeds_.end() && it->second.loaded) {
+        const auto& validators = it->second.validators;
+        if (!validators.etag.empty())
+          request.set_header("If-None-Match", validators.etag);
+        if (!validators.last_modified.empty())
+          request.set_header("If-Modified-Since", validators.last_modified);
+      }
 
-  taiga::http::Request request;
-  request.set_target(WstrToStr(feed.channel.link));
-  request.set_headers({
-      {"Accept", "application/rss+xml, */*"},
-      {"Accept-Encoding", "gzip"}});
+      requests.push_back(request);
+    }
 
-  const auto host = StrToWstr(request.target().uri.authority->host);
+    feed_check_ = FeedCheck{unique_sources, unique_sources.size(), 0, automatic};
+  }
 
   if (!automatic) {
-    ui::ChangeStatusText(L"Checking new torrents via {}..."_format(host));
+    ui::ChangeStatusText(L"Checking new torrents via {}..."_format(
+        taiga::http::util::GetUrlHost(requests.front().target().uri)));
   }
   ui::EnableDialogInput(ui::Dialog::Torrents, false);
 
-  const auto on_transfer = [host](const taiga::http::Transfer& transfer) {
-    ui::ChangeStatusText(L"Checking new torrents via {}... ({})"_format(
-        host, taiga::http::util::to_string(transfer)));
-    return true;
-  };
+  // Requests are queued all at once, and the HTTP pool sends them
+  // concurrently within its per-host limits.
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const auto& request = requests[i];
+    const auto& source = unique_sources[i];
+    const auto host = taiga::http::util::GetUrlHost(request.target().uri);
 
-  const auto on_response = [automatic, &feed, host,
-                            this](const taiga::http::Response& response) {
-    if (HandleFeedError(host, response)) {
-      return;
-    }
+    const auto on_transfer = [host](const taiga::http::Transfer& transfer) {
+      ui::ChangeStatusText(L"Checking new torrents via {}... ({})"_format(
+          host, taiga::http::util::to_string(transfer)));
+      return true;
+    };
 
-    switch (response.status_class()) {
-      case hypp::status::k4xx_Client_Error:
-      case hypp::status::k5xx_Server_Error:
-        ui::ChangeStatusText(L"{} returned an error ({} {})"_format(
-            host, response.status_code(), StrToWstr(response.reason_phrase())));
-        ui::EnableDialogInput(ui::Dialog::Torrents, true);
+    const auto on_response = [host, source,
+                              this](const taiga::http::Response& response) {
+      if (HandleFeedError(host, response)) {
+        HandleFeedCheckResult(source, FeedCheckResult::Failed);
         return;
-    }
+      }
 
-    HandleFeedCheck(feed, response.body(), automatic);
-  };
+      ++taiga::stats.feed_checks;
+
+      if (response.status_code() == hypp::status::k304_Not_Modified) {
+        ++taiga::stats.feed_checks_not_modified;
+        HandleFeedCheckResult(source, FeedCheckResult::NotModified);
+        return;
+      }
 
-  taiga::http::Send(request, on_transfer, on_response);
+      switch (response.status_class()) {
+        case hypp::status::k4xx_Client_Error:
+        case hypp::status::k5xx_Server_Error:
+          ui::ChangeStatusText(L"{} returned an error ({} {})"_format(
+              host, response.status_code(),
+              StrToWstr(response.reason_phrase())));
+          HandleFeedCheckResult(source, FeedCheckResult::Failed);
+          return;
+      }
+
+      taiga::stats.feed_bytes_received += response.body().size();
+
+      UpdateFeedValidators(source, response);
+      HandleFeedCheck(source, response.body());
+      HandleFeedCheckResult(source, FeedCheckResult::Updated);
+    };
+
+    taiga::http::Send(request, on_transfer, on_response,
+                      automatic ? taiga::http::Priority::Background
+                                : taiga::http::Priority::Normal);
+  }
 
   return true;
 }
@@ -117,7 +180,7 @@ bool Aggregator::CheckFeed(const std::wstring& source, bool automatic) {
 void Aggregator::ExamineData(Feed& feed) {
   for (auto& feed_item : feed.items) {
     auto title = feed_item.title;
-    switch (feed.source) {
+    switch (feed_item.feed_source) {
       case FeedSource::AnimeBytes: {
         // Anitomy cannot parse AnimeBytes' titles as is. To avoid writing
         // another parser, we pre-process (i.e. hack) the title instead:
@@ -178,11 +241,11 @@ void Aggregator::ExamineData(Feed& feed) {
 bool Aggregator::Download(const FeedItem* feed_item) {
   Feed& feed = GetFeed();
 
+  std::vector<const FeedItem*> selected_feed_items;
+
   if (feed_item) {
-    download_queue_.push_back(feed_item->link);
-    feed_item = nullptr;
-  } else if (download_queue_.empty()) {
-    std::vector<const FeedItem*> selected_feed_items;
+    selected_feed_items.push_back(feed_item);
+  } else {
     for (const auto& item : feed.items) {
       if (item.state == FeedItemState::Selected)
         selected_feed_items.push_back(&item);
@@ -213,35 +276,126 @@ bool Aggregator::Download(const FeedItem* feed_item) {
             return false;
           }
         });
+  }
+
+  {
+    std::lock_guard lock{download_mutex_};
+
     for (const auto& item : selected_feed_items) {
-      download_queue_.push_back(item->link);
+      // Torrents that were downloaded before are skipped without sending a
+      // request, unless the user explicitly asked for this one.
+      if (!feed_item && archive.Contains(item->title))
+        continue;
+      if (download_queue.Contains(item->link))
+        continue;
+
+      TorrentDownload download;
+      download.title = item->title;
+      download.link = item->link;
+      download.magnet_link = item->magnet_link;
+      download.anime_id = item->episode_data.anime_id;
+      download.anime_title = item->episode_data.anime_title();
+      download_queue.Add(download);
     }
+
+    download_queue.Save();
+
+    if (!download_queue.Size())
+      return false;
+  }
+
+  ProcessDownloadQueue();
+
+  return true;
+}
+
+void Aggregator::ResumeDownloads() {
+  {
+    std::lock_guard lock{download_mutex_};
+    if (!download_queue.Size())
+      return;
+    LOGD(L"Resuming {} torrent download(s).", download_queue.Size());
   }
 
-  while (!feed_item && !download_queue_.empty()) {
-    feed_item = FindFeedItemByLink(feed, download_queue_.front());
-    if (!feed_item)
-      download_queue_.erase(download_queue_.begin());
+  ProcessDownloadQueue();
+}
+
+// Called periodically, so that downloads that were deferred after a failure
+// are retried as soon as their delay has passed
+void Aggregator::RetryDeferredDownloads() {
+  {
+    std::lock_guard lock{download_mutex_};
+
+    const time_t now = std::time(nullptr);
+    const auto is_due = [this, now](const TorrentDownload& download) {
+      return download.retry_time && download.retry_time <= now &&
+             !active_downloads_.count(download.link);
+    };
+    if (std::ranges::none_of(download_queue.items(), is_due))
+      return;
   }
 
-  if (!feed_item)
-    return false;
+  ProcessDownloadQueue();
+}
 
-  if (IsMagnetLink(*feed_item)) {
-    ui::ChangeStatusText(L"Opening magnet link for \"" + feed_item->title + L"\"...");
-    const std::string empty_data;
-    HandleFeedDownload(feed, empty_data);
+void Aggregator::ProcessDownloadQueue() {
+  constexpr size_t kMaxActiveDownloads = 4;
+  constexpr size_t kMaxActiveDownloadsPerHost = 2;
 
-  } else {
-    const auto title = feed_item->title;
-    ui::ChangeStatusText(L"Downloading \"{}\"..."_format(title));
+  std::vector<TorrentDownload> magnet_links;
+  std::vector<TorrentDownload> downloads;
+
+  {
+    std::lock_guard lock{download_mutex_};
+
+    std::map<std::wstring, size_t> active_hosts;
+    for (const auto& [link, active_download] : active_downloads_) {
+      ++active_hosts[active_download.host];
+    }
+
+    const time_t now = std::time(nullptr);
+
+    for (const auto& download : download_queue.items()) {
+      if (active_downloads_.size() >= kMaxActiveDownloads)
+        break;
+      if (active_downloads_.count(download.link))
+        continue;
+      if (download.retry_time > now)
+        continue;
+
+      if (IsMagnetLink(download)) {
+        active_downloads_[download.link] = {std::wstring{}, Clock::now()};
+        magnet_links.push_back(download);
+        continue;
+      }
+
+      const auto host = taiga::http::util::GetUrlHost(WstrToStr(download.link));
+      if (active_hosts[host] >= kMaxActiveDownloadsPerHost)
+        continue;
+      ++active_hosts[host];
+
+      active_downloads_[download.link] = {host, Clock::now()};
+      downloads.push_back(download);
+    }
+  }
+
+  // Magnet links do not require a request
+  for (const auto& download : magnet_links) {
+    ui::ChangeStatusText(
+        L"Opening magnet link for \"{}\"..."_format(download.title));
+    HandleFeedDownload(download, {});
+  }
+
+  for (const auto& download : downloads) {
+    ui::ChangeStatusText(L"Downloading \"{}\"..."_format(download.title));
     ui::EnableDialogInput(ui::Dialog::Torrents, false);
 
     taiga::http::Request request;
-    request.set_target(WstrToStr(feed_item->link));
+    request.set_target(WstrToStr(download.link));
     request.set_header("Accept", "application/x-bittorrent, */*");
 
     const auto host = taiga::http::util::GetUrlHost(request.target().uri);
+    const auto title = download.title;
 
     const auto on_transfer = [title](const taiga::http::Transfer& transfer) {
       ui::ChangeStatusText(L"Downloading \"{}\"... ({})"_format(
@@ -249,21 +403,24 @@ bool Aggregator::Download(const FeedItem* feed_item) {
       return true;
     };
 
-    const auto on_response = [&feed, host, this](const taiga::http::Response& response) {
+    const auto on_response = [download, host,
+                              this](const taiga::http::Response& response) {
       if (HandleFeedError(host, response)) {
+        HandleFeedDownloadError(download, true);
         return;
       }
       if (ValidateFeedDownload(response)) {
-        HandleFeedDownload(feed, response.body());
+        HandleFeedDownload(download, response.body());
       } else {
-        HandleFeedDownloadError(feed);
+        // Client errors and invalid files are not going to resolve themselves
+        HandleFeedDownloadError(
+            download,
+            response.status_class() == hypp::status::k5xx_Server_Error);
       }
     };
 
     taiga::http::Send(request, on_transfer, on_response);
   }
-
-  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -277,14 +434,67 @@ FeedItem* Aggregator::FindFeedItemByLink(Feed& feed, const std::wstring& link) {
   return nullptr;
 }
 
-void Aggregator::HandleFeedCheck(Feed& feed, const std::string& data,
-                                 bool automatic) {
-  std::wstring file = feed.GetDataPath() + L"feed.xml";
-  SaveToFile(data, file);
+void Aggregator::HandleFeedCheck(const std::wstring& source,
+                                 const std::string& data) {
+  std::lock_guard lock{mutex_};
+
+  auto& source_feed = source_feeds_[source];
+  auto& feed = source_feed.feed;
+
+  feed.url = source;
+
+  SaveToFile(data, feed.GetDataFile());
+
+  source_feed.loaded = feed.Load(data);
+}
+
+void Aggregator::HandleFeedCheckResult(const std::wstring& source,
+                                       FeedCheckResult result) {
+  FeedCheck feed_check;
+
+  {
+    std::lock_guard lock{mutex_};
+
+    if (!feed_check_)
+      return;
+    switch (result) {
+      case FeedCheckResult::NotModified:
+        ++feed_check_->not_modified;
+        break;
+      case FeedCheckResult::Updated:
+        ++feed_check_->updated;
+        break;
+      case FeedCheckResult::Failed:
+        break;
+    }
+    if (--feed_check_->pending > 0)
+      return;
+
+    feed_check = std::move(*feed_check_);
+    feed_check_.reset();
+  }
+
+  HandleFeedCheckComplete(feed_check);
+}
+
+void Aggregator::HandleFeedCheckComplete(const FeedCheck& feed_check) {
+  // Nothing to do if none of the sources returned new data, unless sources
+  // that were not modified make up a different feed than the current one.
+  // Failed sources would only bring back the data we already examined.
+  if (!feed_check.updated &&
+      (!feed_check.not_modified || feed_check.sources == feed_sources_)) {
+    if (feed_check.not_modified == feed_check.sources.size()) {
+      HandleFeedNotModified(feed_check.automatic);
+    } else {
+      ui::EnableDialogInput(ui::Dialog::Torrents, true);
+    }
+    return;
+  }
 
-  feed.Load(StrToWstr(data));
+  auto& feed = GetFeed();
+
+  MergeFeeds(feed_check.sources);
   ExamineData(feed);
-  download_queue_.clear();
 
   bool success = false;
   for (const auto& item : feed.items) {
@@ -296,7 +506,7 @@ void Aggregator::HandleFeedCheck(Feed& feed, const std::string& data,
 
   ui::OnFeedCheck(success);
 
-  if (automatic) {
+  if (feed_check.automatic) {
     switch (taiga::settings.GetTorrentDiscoveryNewAction()) {
       case kTorrentActionNotify:
         ui::OnFeedNotify(feed);
@@ -308,25 +518,113 @@ void Aggregator::HandleFeedCheck(Feed& feed, const std::string& data,
   }
 }
 
-void Aggregator::HandleFeedDownload(Feed& feed, const std::string& data) {
-  FeedItem* feed_item = nullptr;
+// Reloads the data that was last received from each source, without sending
+// any requests
+void Aggregator::ReloadFeeds(const std::vector<std::wstring>& sources) {
+  std::vector<std::wstring> unique_sources;
+
+  {
+    std::lock_guard lock{mutex_};
 
-  if (!download_queue_.empty()) {
-    feed_item = FindFeedItemByLink(feed, download_queue_.front());
-    download_queue_.erase(download_queue_.begin());
+    for (const auto& source : sources) {
+      if (source.empty())
+        continue;
+      if (std::find(unique_sources.begin(), unique_sources.end(), source) !=
+          unique_sources.end()) {
+        continue;
+      }
+      unique_sources.push_back(source);
+
+      auto& source_feed = source_feeds_[source];
+      source_feed.feed.url = source;
+      source_feed.loaded = source_feed.feed.Load();
+    }
   }
 
-  if (!feed_item)
-    return;
+  MergeFeeds(unique_sources);
+  ExamineData(GetFeed());
+}
+
+void Aggregator::MergeFeeds(const std::vector<std::wstring>& sources) {
+  auto& feed = GetFeed();
+
+  feed.items.clear();
+  feed.source = FeedSource::Unknown;
+
+  // Items are identified by their info hash and normalized title, so that a
+  // release that is available from several sources is examined only once.
+  // Sources that come first take precedence.
+  std::set<std::wstring> info_hashes;
+  std::set<std::wstring> titles;
+  bool first_source = true;
+
+  std::lock_guard lock{mutex_};
+
+  for (const auto& source : sources) {
+    const auto it = source_feeds_.find(source);
+    if (it == source_feeds_.end() || !it->second.loaded)
+      continue;
 
+    const auto& source_feed = it->second.feed;
+
+    if (first_source) {
+      feed.url = source_feed.url;
+      feed.channel = source_feed.channel;
+      feed.source = source_feed.source;
+      first_source = false;
+    }
+
+    for (const auto& item : source_feed.items) {
+      const auto info_hash = GetFeedItemInfoHash(item);
+      const auto title = NormalizeFeedItemTitle(item.title);
+
+      if (!info_hash.empty() && info_hashes.count(info_hash))
+        continue;
+      if (!title.empty() && titles.count(title))
+        continue;
+
+      if (!info_hash.empty())
+        info_hashes.insert(info_hash);
+      if (!title.empty())
+        titles.insert(title);
+
+      feed.items.push_back(item);
+    }
+  }
+
+  feed_sources_ = sources;
+}
+
+void Aggregator::HandleFeedNotModified(bool automatic) {
+  LOGD(L"Feed is not modified.");
+
+  // Items were already examined and filtered when the feed was last modified,
+  // and the user was notified of them back then if the check was automatic.
+  if (!automatic)
+    ui::ChangeStatusText(L"No new torrents found.");
+  ui::EnableDialogInput(ui::Dialog::Torrents, true);
+}
+
+void Aggregator::UpdateFeedValidators(const std::wstring& source,
+                                      const taiga::http::Response& response) {
+  std::lock_guard lock{mutex_};
+
+  auto& validators = source_feeds_[source].validators;
+  validators.etag = response.header("etag");
+  validators.last_modified = response.header("last-modified");
+}
+
+void Aggregator::HandleFeedDownload(const TorrentDownload& download,
+                                    const std::string& data) {
   std::wstring file;
+  bool saved = true;
 
   if (!data.empty()) {
     auto path = AddTrailingSlash(taiga::settings.GetTorrentDownloadFileLocation());
     if (path.empty())
-      path = feed.GetDataPath();
+      path = GetFeed().GetDataPath();
 
-    file = feed_item->title;
+    file = download.title;
     ValidateFileName(file);
     file = path + file + L".torrent";
 
@@ -334,32 +632,71 @@ void Aggregator::HandleFeedDownload(Feed& feed, const std::string& data) {
 
     if (!FileExists(file)) {
       ui::OnFeedDownloadError(L"Torrent file doesn't exist");
-      return;
+      saved = false;
     }
   }
 
-  const bool is_magnet_link = IsMagnetLink(*feed_item);
+  CompleteDownload(download);
+
+  if (!saved) {
+    ProcessDownloadQueue();
+    return;
+  }
+
+  const bool is_magnet_link = IsMagnetLink(download);
 
   if (is_magnet_link) {
-    file = !feed_item->magnet_link.empty() ? feed_item->magnet_link :
-                                             feed_item->link;
+    file = !download.magnet_link.empty() ? download.magnet_link :
+                                           download.link;
   }
 
-  feed_item->state = FeedItemState::DiscardedNormal;
-  archive.Add(feed_item->title);
+  if (auto feed_item = FindFeedItemByLink(GetFeed(), download.link))
+    feed_item->state = FeedItemState::DiscardedNormal;
+  archive.Add(download.title);
   archive.Save();
   ui::OnFeedDownloadSuccess(is_magnet_link);
 
-  HandleFeedDownloadOpen(*feed_item, file);
+  HandleFeedDownloadOpen(download, file);
 
-  if (!download_queue_.empty())
-    Download(nullptr);
+  ProcessDownloadQueue();
 }
 
-void Aggregator::HandleFeedDownloadError(Feed& feed) {
-  if (!download_queue_.empty()) {
-    download_queue_.erase(download_queue_.begin());
+void Aggregator::HandleFeedDownloadError(const TorrentDownload& download,
+                                         bool retry) {
+  constexpr int kMaxDownloadAttempts = 5;
+
+  if (retry && download.failures + 1 < kMaxDownloadAttempts) {
+    // Wait 1, 2, 4, then 8 minutes before the next attempt
+    const time_t delay = 60 << download.failures;
+    LOGW(L"Torrent download failed, retrying in {} seconds: {}", delay,
+         download.title);
+
+    std::lock_guard lock{download_mutex_};
+    active_downloads_.erase(download.link);
+    download_queue.Defer(download.link, std::time(nullptr) + delay);
+    download_queue.Save();
+  } else {
+    CompleteDownload(download);
   }
+
+  ProcessDownloadQueue();
+}
+
+void Aggregator::CompleteDownload(const TorrentDownload& download) {
+  std::lock_guard lock{download_mutex_};
+
+  const auto it = active_downloads_.find(download.link);
+  if (it != active_downloads_.end()) {
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - it->second.start_time);
+    LOGD(L"Torrent download took {} ms: {}", duration.count(), download.title);
+    taiga::stats.torrent_downloads++;
+    taiga::stats.torrent_download_time += duration.count();
+    active_downloads_.erase(it);
+  }
+
+  download_queue.Remove(download.link);
+  download_queue.Save();
 }
 
 std::wstring GetTorrentApplicationPath() {
@@ -373,11 +710,11 @@ std::wstring GetTorrentApplicationPath() {
   }
 }
 
-std::wstring GetTorrentDownloadPath(const FeedItem::EpisodeData& episode_data) {
+std::wstring GetTorrentDownloadPath(const TorrentDownload& download) {
   std::wstring path;
 
   // Use anime folder as the download folder
-  const auto anime_item = anime::db.Find(episode_data.anime_id);
+  const auto anime_item = anime::db.Find(download.anime_id);
   if (anime_item) {
     const auto anime_folder = anime_item->GetFolder();
     if (!anime_folder.empty() && FolderExists(anime_folder))
@@ -393,7 +730,7 @@ std::wstring GetTorrentDownloadPath(const FeedItem::EpisodeData& episode_data) {
     if (!path.empty() &&
         taiga::settings.GetTorrentDownloadCreateSubfolder()) {
       auto subfolder =
-          anime_item ? anime_item->GetTitle() : episode_data.anime_title();
+          anime_item ? anime_item->GetTitle() : download.anime_title;
       ValidateFileName(subfolder);
       AddTrailingSlash(path);
       path += subfolder;
@@ -409,7 +746,7 @@ std::wstring GetTorrentDownloadPath(const FeedItem::EpisodeData& episode_data) {
   return path;
 }
 
-void Aggregator::HandleFeedDownloadOpen(FeedItem& feed_item,
+void Aggregator::HandleFeedDownloadOpen(const TorrentDownload& download,
                                         const std::wstring& file) {
   if (!taiga::settings.GetTorrentDownloadAppOpen())
     return;
@@ -426,7 +763,7 @@ void Aggregator::HandleFeedDownloadOpen(FeedItem& feed_item,
   int show_command = SW_SHOWNORMAL;
 
   if (taiga::settings.GetTorrentDownloadUseAnimeFolder()) {
-    const auto download_path = GetTorrentDownloadPath(feed_item.episode_data);
+    const auto download_path = GetTorrentDownloadPath(download);
     if (!download_path.empty()) {
       const auto app_filename = GetFileName(app_path);
 
@@ -467,12 +804,12 @@ void Aggregator::HandleFeedDownloadOpen(FeedItem& feed_item,
   Execute(app_path, parameters, show_command);
 }
 
-bool Aggregator::IsMagnetLink(const FeedItem& feed_item) const {
+bool Aggregator::IsMagnetLink(const TorrentDownload& download) const {
   if (taiga::settings.GetTorrentDownloadUseMagnet() &&
-      !feed_item.magnet_link.empty())
+      !download.magnet_link.empty())
     return true;
 
-  if (StartsWith(feed_item.link, L"magnet"))
+  if (StartsWith(download.link, L"magnet"))
     return true;
 
   return false;
@@ -590,4 +927,97 @@ void TorrentArchive::Clear() {
   files_.clear();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+bool TorrentDownloadQueue::Load() {
+  XmlDocument document;
+  const auto path = taiga::GetPath(taiga::Path::Feed) + L"downloads.xml";
+  const auto parse_result = XmlLoadFileToDocument(document, path);
+
+  if (!parse_result)
+    return false;
+
+  items_.clear();
+  auto downloads_node = document.child(L"downloads");
+  for (auto node : downloads_node.children(L"item")) {
+    TorrentDownload download;
+    download.title = node.attribute(L"title").value();
+    download.link = node.attribute(L"link").value();
+    download.magnet_link = node.attribute(L"magnet").value();
+    download.anime_id = node.attribute(L"anime_id").as_int();
+    download.anime_title = node.attribute(L"anime_title").value();
+    download.failures = node.attribute(L"failures").as_int();
+    download.retry_time = node.attribute(L"retry_time").as_llong();
+    if (!download.link.empty())
+      items_.push_back(download);
+  }
+
+  return true;
+}
+
+bool TorrentDownloadQueue::Save() const {
+  XmlDocument document;
+  auto downloads_node = document.append_child(L"downloads");
+
+  for (const auto& download : items_) {
+    auto xml_item = downloads_node.append_child(L"item");
+    xml_item.append_attribute(L"title") = download.title.c_str();
+    xml_item.append_attribute(L"link") = download.link.c_str();
+    if (!download.magnet_link.empty())
+      xml_item.append_attribute(L"magnet") = download.magnet_link.c_str();
+    xml_item.append_attribute(L"anime_id") = download.anime_id;
+    if (!download.anime_title.empty())
+      xml_item.append_attribute(L"anime_title") = download.anime_title.c_str();
+    if (download.failures) {
+      xml_item.append_attribute(L"failures") = download.failures;
+      xml_item.append_attribute(L"retry_time") =
+          static_cast<long long>(download.retry_time);
+    }
+  }
+
+  const auto path = taiga::GetPath(taiga::Path::Feed) + L"downloads.xml";
+  return XmlSaveDocumentToFile(document, path);
+}
+
+bool TorrentDownloadQueue::Contains(const std::wstring& link) const {
+  const auto it = std::find_if(items_.begin(), items_.end(),
+      [&link](const TorrentDownload& download) {
+        return download.link == link;
+      });
+  return it != items_.end();
+}
+
+size_t TorrentDownloadQueue::Size() const {
+  return items_.size();
+}
+
+const std::vector<TorrentDownload>& TorrentDownloadQueue::items() const {
+  return items_;
+}
+
+void TorrentDownloadQueue::Add(const TorrentDownload& download) {
+  if (!Contains(download.link))
+    items_.push_back(download);
+}
+
+void TorrentDownloadQueue::Defer(const std::wstring& link,
+                                 time_t retry_time) {
+  for (auto& download : items_) {
+    if (download.link == link) {
+      download.failures += 1;
+      download.retry_time = retry_time;
+    }
+  }
+}
+
+void TorrentDownloadQueue::Remove(const std::wstring& link) {
+  std::erase_if(items_, [&link](const TorrentDownload& download) {
+    return download.link == link;
+  });
+}
+
+void TorrentDownloadQueue::Clear() {
+  items_.clear();
+}
+
 }  // namespace track
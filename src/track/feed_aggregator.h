@@ -18,6 +18,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -55,29 +60,119 @@ private:
   std::vector<std::wstring> files_;
 };
 
+// A torrent that was selected for download. Downloads are kept on disk until
+// they are complete, so that they can be resumed after a restart, when the
+// feed item itself may no longer be available. Downloads that failed due to a
+// transient error are retried after `retry_time`.
+struct TorrentDownload {
+  std::wstring title;
+  std::wstring link;
+  std::wstring magnet_link;
+  int anime_id = 0;
+  std::wstring anime_title;
+  int failures = 0;
+  time_t retry_time = 0;
+};
+
+class TorrentDownloadQueue {
+public:
+  bool Load();
+  bool Save() const;
+
+  bool Contains(const std::wstring& link) const;
+  size_t Size() const;
+  const std::vector<TorrentDownload>& items() const;
+
+  void Add(const TorrentDownload& download);
+  void Defer(const std::wstring& link, time_t retry_time);
+  void Remove(const std::wstring& link);
+  void Clear();
+
+private:
+  std::vector<TorrentDownload> items_;
+};
+
+// Validators of the last full response we received from a feed source, which
+// are sent back on the next check so that the server can reply with
+// "304 Not Modified" instead of the whole feed.
+struct FeedValidators {
+  std::string etag;
+  std::string last_modified;
+};
+
 class Aggregator {
 public:
   Feed& GetFeed();
 
   bool CheckFeed(const std::wstring& source, bool automatic = false);
+  bool CheckFeeds(const std::vector<std::wstring>& sources,
+                  bool automatic = false);
   bool Download(const FeedItem* feed_item);
-
-  void HandleFeedCheck(Feed& feed, const std::string& data, bool automatic);
-  void HandleFeedDownload(Feed& feed, const std::string& data);
-  void HandleFeedDownloadError(Feed& feed);
+  void ReloadFeeds(const std::vector<std::wstring>& sources);
+  void ResumeDownloads();
+  void RetryDeferredDownloads();
+
+  void HandleFeedCheck(const std::wstring& source, const std::string& data);
+  void HandleFeedNotModified(bool automatic);
+  void HandleFeedDownload(const TorrentDownload& download,
+                          const std::string& data);
+  void HandleFeedDownloadError(const TorrentDownload& download, bool retry);
   bool ValidateFeedDownload(const hypr::Response& http_response);
 
   void ExamineData(Feed& feed);
 
   TorrentArchive archive;
+  TorrentDownloadQueue download_queue;
 
 private:
+  using Clock = std::chrono::steady_clock;
+
+  struct ActiveDownload {
+    std::wstring host;
+    Clock::time_point start_time;
+  };
+
+  // Items of each source are kept as they were parsed, so that a source that
+  // was not modified can still be merged with the others.
+  struct SourceFeed {
+    Feed feed;
+    bool loaded = false;
+    FeedValidators validators;
+  };
+
+  struct FeedCheck {
+    std::vector<std::wstring> sources;
+    size_t pending = 0;
+    size_t not_modified = 0;
+    size_t updated = 0;
+    bool automatic = false;
+  };
+
+  enum class FeedCheckResult { Failed, NotModified, Updated };
+  void HandleFeedCheckResult(const std::wstring& source,
+                             FeedCheckResult result);
+  void HandleFeedCheckComplete(const FeedCheck& feed_check);
+  void MergeFeeds(const std::vector<std::wstring>& sources);
+
+  void ProcessDownloadQueue();
+  void CompleteDownload(const TorrentDownload& download);
+
   FeedItem* FindFeedItemByLink(Feed& feed, const std::wstring& link);
-  void HandleFeedDownloadOpen(FeedItem& feed_item, const std::wstring& file);
-  bool IsMagnetLink(const FeedItem& feed_item) const;
+  void HandleFeedDownloadOpen(const TorrentDownload& download,
+                              const std::wstring& file);
+  bool IsMagnetLink(const TorrentDownload& download) const;
+
+  void UpdateFeedValidators(const std::wstring& source,
+                            const hypr::Response& http_response);
 
-  std::vector<std::wstring> download_queue_;
   Feed feed_;
+  std::vector<std::wstring> feed_sources_;
+  std::map<std::wstring, SourceFeed> source_feeds_;
+  std::optional<FeedCheck> feed_check_;
+  std::mutex mutex_;
+
+  std::map<std::wstring, ActiveDownload> active_downloads_;
+  std::mutex download_mutex_;
 };
 
 inline track::Aggregator aggregator;
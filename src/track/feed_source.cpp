@@ -106,22 +106,20 @@ void ParseFeedItemFromSource(const FeedSource source, FeedItem& feed_item) {
 
     case FeedSource::NyaaSi: {
       feed_item.info_link = feed_item.guid.value;
-      auto& elements = feed_item.namespace_elements;
-      if (elements.count(L"nyaa:size"))
-        feed_item.file_size = ParseSizeString(elements[L"nyaa:size"]);
-      if (elements.count(L"nyaa:seeders"))
-        feed_item.seeders = ToInt(elements[L"nyaa:seeders"]);
-      if (elements.count(L"nyaa:leechers"))
-        feed_item.leechers = ToInt(elements[L"nyaa:leechers"]);
-      if (elements.count(L"nyaa:downloads"))
-        feed_item.downloads = ToInt(elements[L"nyaa:downloads"]);
+      if (const auto value = feed_item.namespace_element(L"nyaa:size"))
+        feed_item.file_size = ParseSizeString(*value);
+      if (const auto value = feed_item.namespace_element(L"nyaa:seeders"))
+        feed_item.seeders = ToInt(*value);
+      if (const auto value = feed_item.namespace_element(L"nyaa:leechers"))
+        feed_item.leechers = ToInt(*value);
+      if (const auto value = feed_item.namespace_element(L"nyaa:downloads"))
+        feed_item.downloads = ToInt(*value);
       break;
     }
 
     case FeedSource::SubsPlease: {
-      auto& elements = feed_item.namespace_elements;
-      if (elements.count(L"subsplease:size"))
-        feed_item.file_size = ParseSizeString(elements[L"subsplease:size"]);
+      if (const auto value = feed_item.namespace_element(L"subsplease:size"))
+        feed_item.file_size = ParseSizeString(*value);
       break;
     }
 
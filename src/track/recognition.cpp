@@ -221,6 +221,34 @@ void Engine::InitializeTitles() {
   }
 }
 
+template <typename Function>
+void Engine::ForEachTitle(const anime::Item& anime_item, Function function) {
+  const auto call = [&function](const std::wstring& title,
+                                Titles::container_t Titles::*container) {
+    if (!title.empty())
+      function(title, container);
+  };
+
+  call(anime_item.GetTitle(), &Titles::main);
+  call(anime_item.GetEnglishTitle(), &Titles::main);
+  call(anime_item.GetJapaneseTitle(), &Titles::main);
+
+  const auto& date = anime_item.GetDateStart();
+  if (anime::IsValidDate(date)) {
+    std::wstring year = ToWstr(date.year());
+    if (anime_item.GetTitle().find(year) == std::wstring::npos) {
+      call(anime_item.GetTitle() + L" (" + year + L")", &Titles::alternative);
+    }
+  }
+
+  for (const auto& synonym : anime_item.GetSynonyms()) {
+    call(synonym, &Titles::alternative);
+  }
+  for (const auto& synonym : anime_item.GetUserSynonyms()) {
+    call(synonym, &Titles::user);
+  }
+}
+
 void Engine::UpdateTitles(const anime::Item& anime_item, bool erase_ids) {
   const int anime_id = anime_item.GetId();
 
@@ -242,42 +270,48 @@ void Engine::UpdateTitles(const anime::Item& anime_item, bool erase_ids) {
   }
 
   auto update_title = [&](std::wstring title,
-                          Titles::container_t& titles,
-                          Titles::container_t& normal_titles) {
-    if (!title.empty()) {
-      Normalize(title, kNormalizeForTrigrams, false);
-      trigram_container_t trigrams;
-      GetTrigrams(title, trigrams);
-      db_[anime_id].trigrams.push_back(trigrams);
-      db_[anime_id].normal_titles.push_back(title);
-
-      Normalize(title, kNormalizeForLookup, true);
-      titles[title].insert(anime_id);
-
-      Normalize(title, kNormalizeFull, true);
-      normal_titles[title].insert(anime_id);
-    }
+                          Titles::container_t Titles::*container) {
+    Normalize(title, kNormalizeForTrigrams, false);
+    trigram_container_t trigrams;
+    GetTrigrams(title, trigrams);
+    db_[anime_id].trigrams.push_back(trigrams);
+    db_[anime_id].normal_titles.push_back(title);
+
+    Normalize(title, kNormalizeForLookup, true);
+    (titles_.*container)[title].insert(anime_id);
+
+    Normalize(title, kNormalizeFull, true);
+    (normal_titles_.*container)[title].insert(anime_id);
   };
 
-  update_title(anime_item.GetTitle(), titles_.main, normal_titles_.main);
-  update_title(anime_item.GetEnglishTitle(), titles_.main, normal_titles_.main);
-  update_title(anime_item.GetJapaneseTitle(), titles_.main, normal_titles_.main);
+  ForEachTitle(anime_item, update_title);
+}
 
-  const auto& date = anime_item.GetDateStart();
-  if (anime::IsValidDate(date)) {
-    std::wstring year = ToWstr(date.year());
-    if (anime_item.GetTitle().find(year) == std::wstring::npos) {
-      update_title(anime_item.GetTitle() + L" (" + year + L")",
-                   titles_.alternative, normal_titles_.alternative);
+void Engine::EraseTitles(const anime::Item& anime_item) {
+  const int anime_id = anime_item.GetId();
+
+  // Only the titles of the item are looked up, rather than every title in the
+  // database
+  const auto erase_id = [&anime_id](const std::wstring& title,
+                                    Titles::container_t& titles) {
+    const auto it = titles.find(title);
+    if (it != titles.end()) {
+      it->second.erase(anime_id);
+      if (it->second.empty())
+        titles.erase(it);
     }
-  }
+  };
 
-  for (const auto& synonym : anime_item.GetSynonyms()) {
-    update_title(synonym, titles_.alternative, normal_titles_.alternative);
-  }
-  for (const auto& synonym : anime_item.GetUserSynonyms()) {
-    update_title(synonym, titles_.user, normal_titles_.user);
-  }
+  ForEachTitle(anime_item, [&](std::wstring title,
+                               Titles::container_t Titles::*container) {
+    Normalize(title, kNormalizeForTrigrams, false);
+    Normalize(title, kNormalizeForLookup, true);
+    erase_id(title, titles_.*container);
+    Normalize(title, kNormalizeFull, true);
+    erase_id(title, normal_titles_.*container);
+  });
+
+  db_.erase(anime_id);
 }
 
 int Engine::LookUpTitle(std::wstring title, std::set<int>& anime_ids) const {
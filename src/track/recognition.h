@@ -56,6 +56,7 @@ public:
 
   void InitializeTitles();
   void UpdateTitles(const anime::Item& anime_item, bool erase_ids = false);
+  void EraseTitles(const anime::Item& anime_item);
 
   sorted_scores_t GetScores() const;
 
@@ -106,6 +107,11 @@ private:
     container_t user;
   } normal_titles_, titles_;
 
+  // Calls the function with each title of the item, and the container that
+  // the title belongs to
+  template <typename Function>
+  static void ForEachTitle(const anime::Item& anime_item, Function function);
+
   struct ScoreStore {
     std::vector<std::wstring> normal_titles;
     std::vector<trigram_container_t> trigrams;
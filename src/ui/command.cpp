@@ -71,6 +71,37 @@ static std::pair<std::wstring, std::wstring> ParseCommand(std::wstring command)
   return {command, body};
 }
 
+static void ExportLibrary(
+    const std::wstring& extension,
+    bool (*export_function)(const std::wstring&,
+                            const library::ExportProgress&,
+                            const library::ExportCallback&)) {
+  std::wstring path;
+  if (!win::BrowseForFolder(ui::GetWindowHandle(ui::Dialog::Main),
+                            L"Select Export Location", L"", path)) {
+    return;
+  }
+
+  AddTrailingSlash(path);
+  path += L"animelist_{}.{}"_format(std::time(nullptr), extension);
+
+  const auto on_progress = [](size_t exported, size_t total) {
+    ui::ChangeStatusText(L"Exporting list... ({}/{})"_format(exported, total));
+  };
+
+  const auto on_complete = [path](bool success) {
+    if (success) {
+      ui::ChangeStatusText(L"Exported list to: " + path);
+    } else {
+      ui::ChangeStatusText(L"Could not export list to: " + path);
+    }
+  };
+
+  if (!export_function(path, on_progress, on_complete)) {
+    ui::ChangeStatusText(L"Please wait for the current export to finish.");
+  }
+}
+
 void ExecuteCommand(const std::wstring& str, WPARAM wParam, LPARAM lParam) {
   LOGD(str);
 
@@ -95,35 +126,25 @@ void ExecuteCommand(const std::wstring& str, WPARAM wParam, LPARAM lParam) {
   //////////////////////////////////////////////////////////////////////////////
   // Export
 
+  // ExportAsCsv()
+  //   Exports library in CSV format.
+  } else if (command == L"ExportAsCsv") {
+    ExportLibrary(L"csv", library::ExportAsCsv);
+
+  // ExportAsJson()
+  //   Exports library in JSON format.
+  } else if (command == L"ExportAsJson") {
+    ExportLibrary(L"json", library::ExportAsJson);
+
   // ExportAsMalXml()
   //   Exports library in MAL XML format.
   } else if (command == L"ExportAsMalXml") {
-    std::wstring path;
-    if (win::BrowseForFolder(ui::GetWindowHandle(ui::Dialog::Main),
-                             L"Select Export Location", L"", path)) {
-      AddTrailingSlash(path);
-      path += L"animelist_{}.xml"_format(std::time(nullptr));
-      if (library::ExportAsMalXml(path)) {
-        ui::ChangeStatusText(L"Exported list to: " + path);
-      } else {
-        ui::ChangeStatusText(L"Could not export list to: " + path);
-      }
-    }
+    ExportLibrary(L"xml", library::ExportAsMalXml);
 
   // ExportAsMarkdown()
   //   Exports library in Markdown format.
   } else if (command == L"ExportAsMarkdown") {
-    std::wstring path;
-    if (win::BrowseForFolder(ui::GetWindowHandle(ui::Dialog::Main),
-                             L"Select Export Location", L"", path)) {
-      AddTrailingSlash(path);
-      path += L"animelist_{}.md"_format(std::time(nullptr));
-      if (library::ExportAsMarkdown(path)) {
-        ui::ChangeStatusText(L"Exported list to: " + path);
-      } else {
-        ui::ChangeStatusText(L"Could not export list to: " + path);
-      }
-    }
+    ExportLibrary(L"md", library::ExportAsMarkdown);
 
   //////////////////////////////////////////////////////////////////////////////
   // Services
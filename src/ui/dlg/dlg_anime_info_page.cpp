@@ -198,7 +198,7 @@ void PageSeriesInfo::Refresh(int anime_id, bool connect) {
           L"Type:\nEpisodes:\nStatus:\nSeason:\nCategories:\nProducers:\nScore:");
       break;
   }
-  auto genres = anime_item->GetGenres();
+  std::vector<std::wstring> genres = anime_item->GetGenres();
   const auto tags = anime_item->GetTags();
   genres.insert(genres.end(), tags.begin(), tags.end());
   const auto producers = anime::GetStudiosAndProducers(*anime_item);
@@ -1392,6 +1392,8 @@ void AnimeListDialog::RefreshList(std::optional<anime::MyStatus> status) {
   std::map<anime::MyStatus, int> group_count;
   int group_index = -1;
   int item_index = 0;
+  const auto& filters = DlgMain.search_bar.filters;
+  const auto query = filters.GetQuery(kSidebarItemAnimeList);
   for (const auto& [anime_id, anime_item] : anime::db.items) {
     if (!anime_item.IsInList())
       continue;
@@ -1405,7 +1407,7 @@ void AnimeListDialog::RefreshList(std::optional<anime::MyStatus> status) {
         continue;
       }
     }
-    if (!DlgMain.search_bar.filters.CheckItem(anime_item, kSidebarItemAnimeList))
+    if (!filters.CheckItem(anime_item, query.get()))
       continue;
 
     group_count[anime_item.GetMyStatus()]++;
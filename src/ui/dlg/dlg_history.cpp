@@ -24,6 +24,7 @@
 #include "media/anime_util.h"
 #include "media/library/history.h"
 #include "media/library/queue.h"
+#include "taiga/persistence.h"
 #include "taiga/resource.h"
 #include "ui/dlg/dlg_history.h"
 #include "ui/dlg/dlg_main.h"
@@ -277,7 +278,7 @@ bool HistoryDialog::RemoveSelectedItems() {
     }
   }
 
-  library::history.Save();
+  taiga::persistence.MarkDirty(taiga::Store::History);
 
   ui::OnHistoryChange();
 
@@ -25,6 +25,7 @@
 #include "media/anime_db.h"
 #include "media/anime_util.h"
 #include "media/anime_season_db.h"
+#include "media/library/export.h"
 #include "media/library/queue.h"
 #include "ui/resource.h"
 #include "sync/myanimelist_util.h"
@@ -33,6 +34,7 @@
 #include "taiga/announce.h"
 #include "taiga/app.h"
 #include "taiga/config.h"
+#include "taiga/http.h"
 #include "taiga/resource.h"
 #include "taiga/script.h"
 #include "taiga/settings.h"
@@ -89,6 +91,9 @@ BOOL MainDialog::OnInitDialog() {
   // Start process timer
   taiga::timers.Initialize();
 
+  // Receive HTTP responses on the main thread
+  taiga::http::SetWindowHandle(GetWindowHandle());
+
   // Add icon to taskbar
   taskbar.Create(GetWindowHandle(), kAppSysTrayId, nullptr, TAIGA_APP_NAME);
 
@@ -106,6 +111,7 @@ BOOL MainDialog::OnInitDialog() {
   if (taiga::settings.GetAppBehaviorScanAvailableEpisodes()) {
     ScanAvailableEpisodesQuick();
   }
+  track::aggregator.ResumeDownloads();
 
   // Select default content page
   navigation.SetCurrentPage(kSidebarItemAnimeList);
@@ -305,6 +311,18 @@ INT_PTR MainDialog::DialogProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
       return TRUE;
     }
 
+    // Process HTTP responses
+    case taiga::http::WM_HTTPCALLBACK: {
+      taiga::http::ProcessCallbacks();
+      return TRUE;
+    }
+
+    // Process export progress
+    case library::WM_EXPORTCALLBACK: {
+      library::ProcessExportCallbacks();
+      return TRUE;
+    }
+
     // Show menu
     case WM_TAIGA_SHOWMENU: {
       toolbar_wm.ShowMenu();
@@ -492,7 +510,7 @@ BOOL MainDialog::PreTranslateMessage(MSG* pMsg) {
             case kSidebarItemFeeds: {
               // Check new torrents
               edit.SetText(L"");
-              track::aggregator.CheckFeed(taiga::settings.GetTorrentDiscoverySource());
+              track::aggregator.CheckFeeds(taiga::settings.GetTorrentDiscoverySources());
               return TRUE;
             }
           }
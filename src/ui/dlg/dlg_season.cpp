@@ -612,9 +612,9 @@ void SeasonDialog::EnableInput(bool enable) {
 }
 
 void SeasonDialog::RefreshData(const std::vector<int>& anime_ids) {
-  for (const auto& id : anime_ids) {
-    sync::GetMetadataById(id);
+  sync::GetMetadataByIds(anime_ids);
 
+  for (const auto& id : anime_ids) {
     if (const auto anime_item = anime::db.Find(id)) {
       if (!anime_item->GetImageUrl().empty()) {
         sync::DownloadImage(id, anime_item->GetImageUrl());
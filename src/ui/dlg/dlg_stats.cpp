@@ -227,6 +227,20 @@ void StatsDialog::Refresh() {
   text += ToWstr(taiga::stats.connections_succeeded + taiga::stats.connections_failed);
   if (taiga::stats.connections_failed > 0)
     text += L" (" + ToWstr(taiga::stats.connections_failed) + L" failed)";
+  if (taiga::stats.feed_checks_not_modified > 0)
+    text += L" (" + ToWstr(taiga::stats.feed_checks_not_modified) + L"/" +
+            ToWstr(taiga::stats.feed_checks) + L" feeds not modified)";
+  if (taiga::stats.http_cache_hits > 0)
+    text += L" (" + ToWstr(taiga::stats.http_cache_hits) + L"/" +
+            ToWstr(taiga::stats.http_cache_hits +
+                   taiga::stats.http_cache_misses) +
+            L" served from cache)";
+  if (taiga::stats.http_requests_dispatched > 0)
+    text += L" (avg. queue wait: " +
+            ToWstr(static_cast<int>(taiga::stats.http_queue_wait_time /
+                                    taiga::stats.http_requests_dispatched)) +
+            L" ms, max. queue depth: " +
+            ToWstr(static_cast<int>(taiga::stats.http_queue_depth_max)) + L")";
   text += L"\n";
   text += ToDateString(taiga::stats.uptime) + L"\n";
   text += ToWstr(taiga::stats.tigers_harmed);
@@ -134,14 +134,11 @@ BOOL TorrentDialog::OnCommand(WPARAM wParam, LPARAM lParam) {
     case 100: {
       DlgMain.edit.SetText(L"");
       if (GetKeyState(VK_CONTROL) & 0x8000) {
-        auto& feed = track::aggregator.GetFeed();
-        if (feed.channel.link.empty())
-          feed.channel.link = taiga::settings.GetTorrentDiscoverySource();
-        feed.Load();
-        track::aggregator.ExamineData(feed);
+        track::aggregator.ReloadFeeds(
+            taiga::settings.GetTorrentDiscoverySources());
         RefreshList();
       } else {
-        track::aggregator.CheckFeed(taiga::settings.GetTorrentDiscoverySource());
+        track::aggregator.CheckFeeds(taiga::settings.GetTorrentDiscoverySources());
       }
       return TRUE;
     }
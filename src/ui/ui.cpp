@@ -441,10 +441,15 @@ int OnHistoryProcessConfirmationQueue(anime::Episode& episode) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void OnAnimeDelete(int id, const std::wstring& title) {
-  ChangeStatusText(L"Anime is removed from the database: " + title);
+void OnAnimeDelete(const std::set<int>& ids, const std::wstring& title) {
+  if (ids.size() == 1) {
+    ChangeStatusText(L"Anime is removed from the database: " + title);
+  } else {
+    ChangeStatusText(
+        L"{} anime are removed from the database."_format(ids.size()));
+  }
 
-  if (DlgAnime.GetCurrentId() == id) {
+  if (ids.contains(DlgAnime.GetCurrentId())) {
     // We're posting a message rather than directly terminating the dialog,
     // because this function can be called from another thread, and it is not
     // possible to destroy a window created by a different thread.
@@ -454,7 +459,7 @@ void OnAnimeDelete(int id, const std::wstring& title) {
   DlgAnimeList.RefreshList();
   DlgAnimeList.RefreshTabs();
 
-  if (DlgNowPlaying.GetCurrentId() == id) {
+  if (ids.contains(DlgNowPlaying.GetCurrentId())) {
     DlgNowPlaying.SetCurrentId(anime::ID_UNKNOWN);
   } else {
     DlgNowPlaying.Refresh(false, false, false, false);
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -88,7 +89,7 @@ bool OnHistoryClear();
 int OnHistoryQueueClear();
 int OnHistoryProcessConfirmationQueue(anime::Episode& episode);
 
-void OnAnimeDelete(int id, const std::wstring& title);
+void OnAnimeDelete(const std::set<int>& ids, const std::wstring& title);
 void OnAnimeEpisodeNotFound(const std::wstring& title);
 bool OnAnimeFolderNotFound();
 void OnAnimeWatchingStart(const anime::Item& anime_item, const anime::Episode& episode);
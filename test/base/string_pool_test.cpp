@@ -0,0 +1,130 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "base/string_pool.h"
+
+namespace base {
+
+TEST(StringPoolTest, StoresStringsOnce) {
+  StringPool pool;
+
+  const auto action = pool.Intern(L"Action");
+  const auto drama = pool.Intern(L"Drama");
+  EXPECT_NE(action, drama);
+  EXPECT_EQ(pool.Intern(L"Action"), action);
+  EXPECT_EQ(pool.size(), 2u);
+
+  const auto ids = pool.Intern({L"Drama", L"Comedy", L"Action"});
+  EXPECT_EQ(ids, std::vector<StringPool::id_t>({drama, 2, action}));
+  EXPECT_EQ(pool.size(), 3u);
+
+  EXPECT_EQ(pool.Get(action), L"Action");
+  EXPECT_EQ(pool.Get(ids[1]), L"Comedy");
+  EXPECT_TRUE(pool.Get(100).empty());
+}
+
+TEST(StringPoolTest, KeepsReferencesValid) {
+  StringPool pool;
+
+  const auto& first = pool.Get(pool.Intern(L"First"));
+  for (int i = 0; i < 10000; ++i) {
+    pool.Intern(std::to_wstring(i));
+  }
+  EXPECT_EQ(first, L"First");
+}
+
+TEST(StringPoolTest, ViewsLookUpStrings) {
+  StringPool pool;
+
+  const auto ids = pool.Intern({L"Action", L"Drama", L"Action"});
+  const auto view = pool.Get(ids);
+  EXPECT_FALSE(view.empty());
+  EXPECT_EQ(view.size(), 3u);
+  EXPECT_EQ(view[1], L"Drama");
+
+  std::vector<std::wstring> strings;
+  for (const auto& str : view) {
+    strings.push_back(str);
+  }
+  EXPECT_EQ(strings,
+            std::vector<std::wstring>({L"Action", L"Drama", L"Action"}));
+
+  const std::vector<std::wstring> converted = view;
+  EXPECT_EQ(converted, strings);
+
+  const std::vector<StringPool::id_t> no_ids;
+  EXPECT_TRUE(pool.Get(no_ids).empty());
+  EXPECT_EQ(pool.Get(no_ids).begin(), pool.Get(no_ids).end());
+}
+
+TEST(StringPoolTest, FindsStringsIgnoringCase) {
+  StringPool pool;
+
+  const auto ids = pool.Intern({L"Slice of Life", L"Drama", L"Romance",
+                                L"Psychological", L"DRAMATIC"});
+  EXPECT_EQ(pool.FindContaining(L"drama"),
+            std::vector<StringPool::id_t>({ids[1], ids[4]}));
+  EXPECT_EQ(pool.FindContaining(L"O"),
+            std::vector<StringPool::id_t>({ids[0], ids[2], ids[3]}));
+  EXPECT_TRUE(pool.FindContaining(L"Mecha").empty());
+}
+
+TEST(StringPoolTest, CanBeUsedFromManyThreads) {
+  StringPool pool;
+
+  constexpr int kThreadCount = 8;
+  constexpr int kStringCount = 1000;
+
+  std::vector<std::vector<StringPool::id_t>> ids(kThreadCount);
+  std::vector<std::thread> threads;
+
+  // Every thread interns the same strings in a different order, and reads
+  // them back while the others are still adding theirs
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&pool, &ids, i]() {
+      for (int j = 0; j < kStringCount; ++j) {
+        const int n = (j * (i + 1) * 7919) % kStringCount;
+        const auto id = pool.Intern(std::to_wstring(n));
+        ids[i].push_back(id);
+        if (pool.Get(id) != std::to_wstring(n))
+          ids[i].push_back(static_cast<StringPool::id_t>(-1));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(pool.size(), static_cast<size_t>(kStringCount));
+
+  for (int i = 0; i < kThreadCount; ++i) {
+    ASSERT_EQ(ids[i].size(), static_cast<size_t>(kStringCount));
+    for (int j = 0; j < kStringCount; ++j) {
+      const int n = (j * (i + 1) * 7919) % kStringCount;
+      EXPECT_EQ(pool.Get(ids[i][j]), std::to_wstring(n));
+    }
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,163 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "media/anime_db.h"
+
+#include "base/format.h"
+#include "base/string.h"
+#include "media/library/history.h"
+#include "media/library/queue.h"
+#include "sync/service.h"
+#include "track/recognition.h"
+
+namespace anime {
+
+class AnimeDatabaseTest : public ::testing::Test {
+protected:
+  static constexpr int kItemCount = 20000;
+
+  void SetUp() override {
+    current_service_ = sync::GetCurrentServiceId();
+    other_service_ = current_service_ == sync::ServiceId::MyAnimeList
+                         ? sync::ServiceId::Kitsu
+                         : sync::ServiceId::MyAnimeList;
+
+    // Titles of the items that are added below are kept up to date one by one
+    Meow.InitializeTitles();
+
+    for (int id = 1; id <= kItemCount; ++id) {
+      auto& item = db.items[id];
+      item.SetId(ToWstr(id), current_service_);
+      item.SetId(GetOtherId(id), other_service_);
+      item.SetTitle(GetTitle(id));
+      Meow.UpdateTitles(item);
+
+      library::history.items.push_back({id, 1, L""});
+      library::QueueItem queue_item;
+      queue_item.anime_id = id;
+      queue_item.episode = 2;
+      library::queue.items.push_back(queue_item);
+    }
+    library::queue.RebuildIndex();
+  }
+
+  void TearDown() override {
+    for (const auto& [id, item] : db.items) {
+      Meow.EraseTitles(item);
+    }
+    db.Clear();
+    library::history.items.clear();
+    library::queue.items.clear();
+    library::queue.RebuildIndex();
+  }
+
+  static std::wstring GetOtherId(const int id) {
+    return L"other-{}"_format(id);
+  }
+
+  // Titles are made of letters only, so that they are not mistaken for one
+  // another when they are normalized
+  static std::wstring GetTitle(int id) {
+    std::wstring title = L"Deletion Test ";
+    for (; id > 0; id /= 10) {
+      title.push_back(L'a' + id % 10);
+    }
+    return title;
+  }
+
+  static bool IsRecognized(const int id) {
+    std::vector<int> anime_ids;
+    Meow.Search(GetTitle(id), anime_ids);
+    return std::find(anime_ids.begin(), anime_ids.end(), id) !=
+           anime_ids.end();
+  }
+
+  sync::ServiceId current_service_;
+  sync::ServiceId other_service_;
+};
+
+TEST_F(AnimeDatabaseTest, DeleteItemsRemovesDependentData) {
+  std::set<int> ids;
+  for (int id = 2; id <= kItemCount; id += 2) {
+    ids.insert(id);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(db.DeleteItems(ids), ids.size());
+  const auto duration = std::chrono::steady_clock::now() - start;
+  RecordProperty(
+      "DeleteItemsMilliseconds",
+      static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+              .count()));
+
+  EXPECT_EQ(db.items.size(), kItemCount - ids.size());
+
+  for (int id = 1; id <= kItemCount; ++id) {
+    const bool deleted = ids.contains(id);
+    EXPECT_EQ(db.Find(id, false) == nullptr, deleted) << id;
+    EXPECT_EQ(db.Find(ToWstr(id), current_service_, false) == nullptr,
+              deleted) << id;
+    EXPECT_EQ(db.Find(GetOtherId(id), other_service_, false) == nullptr,
+              deleted) << id;
+    EXPECT_EQ(library::queue.FindPendingChange(
+                  id, library::QueueSearch::Episode) == nullptr,
+              deleted) << id;
+  }
+
+  // Searching for titles is slow, so only some of them are checked
+  for (int id = 1; id <= kItemCount; id += 97) {
+    EXPECT_EQ(IsRecognized(id), !ids.contains(id)) << id;
+  }
+
+  const auto is_deleted = [&ids](const auto& item) {
+    return ids.contains(item.anime_id);
+  };
+  EXPECT_EQ(library::history.items.size(), kItemCount - ids.size());
+  EXPECT_TRUE(std::none_of(library::history.items.begin(),
+                           library::history.items.end(), is_deleted));
+  EXPECT_EQ(library::queue.items.size(), kItemCount - ids.size());
+  EXPECT_TRUE(std::none_of(library::queue.items.begin(),
+                           library::queue.items.end(), is_deleted));
+}
+
+TEST_F(AnimeDatabaseTest, DeleteItemsIgnoresUnknownIds) {
+  EXPECT_EQ(db.DeleteItems({kItemCount + 1, kItemCount + 2}), 0u);
+  EXPECT_EQ(db.items.size(), static_cast<size_t>(kItemCount));
+  EXPECT_EQ(library::history.items.size(), static_cast<size_t>(kItemCount));
+  EXPECT_EQ(library::queue.items.size(), static_cast<size_t>(kItemCount));
+}
+
+TEST_F(AnimeDatabaseTest, DeleteItemKeepsIdsThatWereReassigned) {
+  // The ID of the deleted item now belongs to another item
+  db.items[2].SetId(GetOtherId(1), other_service_);
+  EXPECT_EQ(db.Find(GetOtherId(1), other_service_, false), &db.items[2]);
+
+  EXPECT_TRUE(db.DeleteItem(1));
+  EXPECT_EQ(db.Find(GetOtherId(1), other_service_, false), &db.items[2]);
+}
+
+}  // namespace anime
@@ -0,0 +1,143 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "media/anime_search.h"
+
+#include "media/anime_db.h"
+#include "sync/service.h"
+
+namespace anime {
+
+class SearchIndexTest : public ::testing::Test {
+protected:
+  void TearDown() override {
+    db.Clear();
+    search_index.Build();
+    search_index.WaitForBuild();
+  }
+
+  static void AddItem(const int id, const std::wstring& title,
+                      const std::wstring& synopsis = {}) {
+    auto& item = db.items[id];
+    item.SetId(std::to_wstring(id), sync::GetCurrentServiceId());
+    item.SetTitle(title);
+    item.SetSynopsis(synopsis);
+  }
+
+  static void BuildIndex() {
+    search_index.Build();
+    search_index.WaitForBuild();
+  }
+
+  static int GetMilliseconds(
+      const std::chrono::steady_clock::duration duration) {
+    return static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+            .count());
+  }
+};
+
+TEST_F(SearchIndexTest, RanksWholeWordsAboveSynopsesAndPrefixes) {
+  AddItem(1, L"Fullmetal Alchemist");
+  AddItem(2, L"Fullmetal Alchemist: Brotherhood");
+  AddItem(3, L"Full Moon wo Sagashite");
+  AddItem(4, L"Hagane no Renkinjutsushi", L"An alchemist and his brother...");
+  BuildIndex();
+
+  EXPECT_EQ(search_index.Search(L"alchemist"), std::vector<int>({1, 2, 4}));
+  EXPECT_EQ(search_index.Search(L"Full"), std::vector<int>({3, 1, 2}));
+  EXPECT_EQ(search_index.Search(L"fullmetal bro"), std::vector<int>({2}));
+  EXPECT_EQ(search_index.Search(L"brother"), std::vector<int>({2, 4}));
+  EXPECT_TRUE(search_index.Search(L"mecha").empty());
+
+  // Words that are too short are not indexed
+  EXPECT_TRUE(search_index.Search(L"a").empty());
+}
+
+TEST_F(SearchIndexTest, AppliesChangesToItems) {
+  AddItem(1, L"Fullmetal Alchemist");
+  AddItem(2, L"Full Moon wo Sagashite");
+  BuildIndex();
+
+  const auto generation = search_index.generation();
+
+  db.items[2].SetTitle(L"Sailor Moon");
+  EXPECT_EQ(search_index.Search(L"full"), std::vector<int>({1}));
+  EXPECT_EQ(search_index.Search(L"sailor"), std::vector<int>({2}));
+  EXPECT_NE(search_index.generation(), generation);
+
+  EXPECT_TRUE(db.DeleteItem(1));
+  EXPECT_TRUE(search_index.Search(L"fullmetal").empty());
+}
+
+TEST_F(SearchIndexTest, SearchesLargeLists) {
+  const std::vector<std::wstring> words{
+      L"academy", L"adventure", L"alchemist", L"angel", L"blade",
+      L"blood", L"brother", L"castle", L"chronicle", L"city",
+      L"dragon", L"dream", L"eternal", L"fantasy", L"flower",
+      L"garden", L"ghost", L"girl", L"heart", L"hero",
+      L"island", L"journey", L"kingdom", L"knight", L"legend",
+      L"light", L"magic", L"moon", L"night", L"ocean",
+      L"princess", L"queen", L"rain", L"school", L"shadow",
+      L"sky", L"song", L"spirit", L"star", L"story",
+      L"summer", L"sword", L"tale", L"tower", L"wind",
+      L"winter", L"wish", L"witch", L"world", L"zero",
+  };
+
+  constexpr int kItemCount = 30000;
+  {
+    const auto batch = db.BatchChanges();
+    for (int id = 1; id <= kItemCount; ++id) {
+      const auto size = static_cast<int>(words.size());
+      AddItem(id,
+              words[id % size] + L" " + words[id / size % size] + L" " +
+                  words[id / (size * size) % size],
+              L"The " + words[(id * 7) % size] + L" of the " +
+                  words[(id * 13) % size] + L".");
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  BuildIndex();
+  RecordProperty("BuildMilliseconds",
+                 GetMilliseconds(std::chrono::steady_clock::now() - start));
+
+  size_t result_count = 0;
+  start = std::chrono::steady_clock::now();
+  for (const auto& word : words) {
+    result_count += search_index.Search(word).size();
+    result_count += search_index.Search(word.substr(0, 3)).size();
+    result_count += search_index.Search(word + L" " + words[0]).size();
+  }
+  RecordProperty("SearchMilliseconds",
+                 GetMilliseconds(std::chrono::steady_clock::now() - start));
+
+  EXPECT_GT(result_count, 0u);
+
+  // Every item with the word in its title is found
+  const auto results = search_index.Search(L"dragon");
+  EXPECT_GE(results.size(), static_cast<size_t>(kItemCount / words.size()));
+}
+
+}  // namespace anime
@@ -0,0 +1,199 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "media/library/export.h"
+
+#include "base/file.h"
+#include "base/format.h"
+#include "base/json.h"
+#include "base/string.h"
+#include "media/anime_db.h"
+#include "sync/service.h"
+
+namespace library {
+
+// Exports a list of 20,000 entries in every format, and records how long each
+// of them takes.
+class ExportTest : public ::testing::Test {
+protected:
+  static constexpr int kItemCount = 20000;
+
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() / L"taiga_export_test";
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+
+    constexpr anime::MyStatus statuses[] = {
+        anime::MyStatus::Watching, anime::MyStatus::Completed,
+        anime::MyStatus::OnHold,   anime::MyStatus::Dropped,
+        anime::MyStatus::PlanToWatch,
+    };
+
+    const auto batch = anime::db.BatchChanges();
+    for (int id = 1; id <= kItemCount; ++id) {
+      auto& item = anime::db.items[id];
+      item.SetId(ToWstr(id), sync::GetCurrentServiceId());
+      // Entries without a MAL ID are left out of MAL XML exports
+      if (id % 10)
+        item.SetId(ToWstr(id), sync::ServiceId::MyAnimeList);
+      item.SetTitle(L"Export Test {}"_format(id));
+      item.SetEpisodeCount(12);
+      item.AddtoUserList();
+      item.SetMyStatus(statuses[id % std::size(statuses)]);
+      item.SetMyLastWatchedEpisode(id % 13);
+      item.SetMyNotes(id % 2 ? L"" : L"Notes, with \"quotes\"");
+    }
+  }
+
+  void TearDown() override {
+    anime::db.Clear();
+    std::filesystem::remove_all(path_);
+  }
+
+  using ExportFunction = bool (*)(const std::wstring&, const ExportProgress&,
+                                  const ExportCallback&);
+
+  // Returns the contents of the exported file
+  std::string Export(const std::wstring& name, ExportFunction function) {
+    const auto path = (path_ / name).wstring();
+
+    size_t exported = 0;
+    std::optional<bool> success;
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(function(
+        path,
+        [&exported](size_t count, size_t total) {
+          EXPECT_GE(count, exported);
+          EXPECT_LE(count, total);
+          exported = count;
+        },
+        [&success](bool result) { success = result; }));
+    WaitForExport();
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    RecordProperty(
+        WstrToStr(name) + "_milliseconds",
+        static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+                .count()));
+
+    // Callbacks are queued for the main window, which tests do not have
+    ProcessExportCallbacks();
+    EXPECT_EQ(success, true);
+    EXPECT_GT(exported, 0u);
+
+    std::string output;
+    EXPECT_TRUE(ReadFromFile(path, output));
+    return output;
+  }
+
+  static std::vector<std::string> GetLines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (pos < text.size()) {
+      auto end = text.find('\n', pos);
+      if (end == text.npos)
+        end = text.size();
+      auto line = text.substr(pos, end - pos);
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      lines.push_back(std::move(line));
+      pos = end + 1;
+    }
+    return lines;
+  }
+
+  std::filesystem::path path_;
+};
+
+TEST_F(ExportTest, Csv) {
+  const auto lines = GetLines(Export(L"list.csv", ExportAsCsv));
+  ASSERT_EQ(lines.size(), static_cast<size_t>(kItemCount) + 1);
+  EXPECT_TRUE(lines[0].starts_with("id,"));
+
+  for (int id = 1; id <= kItemCount; ++id) {
+    const auto& line = lines[id];
+    ASSERT_TRUE(line.starts_with("{},"_format(id))) << line;
+    if (id % 2 == 0) {
+      EXPECT_TRUE(line.ends_with(",\"Notes, with \"\"quotes\"\"\"")) << line;
+    }
+  }
+}
+
+TEST_F(ExportTest, Json) {
+  Json root;
+  ASSERT_TRUE(JsonParseString(Export(L"list.json", ExportAsJson), root));
+
+  const auto& anime = root["anime"];
+  ASSERT_EQ(anime.size(), static_cast<size_t>(kItemCount));
+  for (int id = 1; id <= kItemCount; ++id) {
+    ASSERT_EQ(anime[id - 1]["id"].get<int>(), id);
+  }
+
+  int status_count = 0;
+  for (const auto& [status, count] : root["status_counts"].items()) {
+    status_count += count.get<int>();
+  }
+  EXPECT_EQ(status_count, kItemCount);
+}
+
+TEST_F(ExportTest, MalXml) {
+  const auto output = Export(L"list.xml", ExportAsMalXml);
+
+  std::vector<int> ids;
+  const std::string tag = "<series_animedb_id>";
+  for (auto pos = output.find(tag); pos != output.npos;
+       pos = output.find(tag, pos + 1)) {
+    const auto begin = pos + tag.size();
+    ids.push_back(ToInt(output.substr(begin, output.find('<', begin) - begin)));
+  }
+
+  EXPECT_EQ(ids.size(), static_cast<size_t>(kItemCount - kItemCount / 10));
+  EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+  EXPECT_TRUE(std::none_of(ids.begin(), ids.end(),
+                           [](int id) { return id % 10 == 0; }));
+  EXPECT_NE(output.find("<user_total_anime>{}</user_total_anime>"_format(
+                kItemCount)),
+            output.npos);
+}
+
+TEST_F(ExportTest, Markdown) {
+  const auto lines = GetLines(Export(L"list.md", ExportAsMarkdown));
+
+  const auto count = [&lines](const std::string& prefix) {
+    return std::count_if(lines.begin(), lines.end(),
+                         [&prefix](const std::string& line) {
+                           return line.starts_with(prefix);
+                         });
+  };
+  EXPECT_EQ(count("- "), kItemCount);
+  EXPECT_EQ(count("# "), 5);
+}
+
+}  // namespace library
@@ -0,0 +1,183 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+
+#include <gtest/gtest.h>
+
+#include "media/library/queue.h"
+
+namespace library {
+
+constexpr QueueSearch kSearchModes[] = {
+    QueueSearch::DateStart,      QueueSearch::DateEnd,
+    QueueSearch::Episode,        QueueSearch::Notes,
+    QueueSearch::RewatchedTimes, QueueSearch::Rewatching,
+    QueueSearch::Score,          QueueSearch::Status,
+};
+
+static std::optional<std::wstring> GetValue(const QueueItem& item,
+                                            const QueueSearch search_mode) {
+  const auto to_string = [](const auto& value) -> std::optional<std::wstring> {
+    if (!value)
+      return std::nullopt;
+    if constexpr (std::is_same_v<std::decay_t<decltype(*value)>, Date>) {
+      return value->to_string();
+    } else if constexpr (std::is_same_v<std::decay_t<decltype(*value)>,
+                                        std::wstring>) {
+      return *value;
+    } else {
+      return std::to_wstring(static_cast<int>(*value));
+    }
+  };
+
+  switch (search_mode) {
+    case QueueSearch::DateStart:
+      return to_string(item.date_start);
+    case QueueSearch::DateEnd:
+      return to_string(item.date_finish);
+    case QueueSearch::Episode:
+      return to_string(item.episode);
+    case QueueSearch::Notes:
+      return to_string(item.notes);
+    case QueueSearch::RewatchedTimes:
+      return to_string(item.rewatched_times);
+    case QueueSearch::Rewatching:
+      return to_string(item.enable_rewatching);
+    case QueueSearch::Score:
+      return to_string(item.score);
+    case QueueSearch::Status:
+      return to_string(item.status);
+  }
+
+  return std::nullopt;
+}
+
+// The way `Queue::FindItem` used to find items, before there was an index
+static QueueItem* FindItemByScanning(Queue& queue, const int anime_id,
+                                     const QueueSearch search_mode) {
+  for (auto it = queue.items.rbegin(); it != queue.items.rend(); ++it) {
+    if (it->anime_id == anime_id && it->enabled &&
+        GetValue(*it, search_mode)) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+class QueueTest : public ::testing::Test {
+protected:
+  static constexpr int kAnimeCount = 20;
+
+  // Random items for a few anime, most of which change only some fields
+  void AddRandomItems(Queue& queue, const size_t count) {
+    std::bernoulli_distribution has_value{0.3};
+    std::bernoulli_distribution enabled{0.8};
+    std::uniform_int_distribution<int> anime_id{1, kAnimeCount};
+    std::uniform_int_distribution<int> number{1, 12};
+
+    for (size_t i = 0; i < count; ++i) {
+      QueueItem item;
+      item.anime_id = anime_id(random_);
+      item.enabled = enabled(random_);
+      if (has_value(random_))
+        item.episode = number(random_);
+      if (has_value(random_))
+        item.status = static_cast<anime::MyStatus>(number(random_) % 5 + 1);
+      if (has_value(random_))
+        item.score = number(random_) * 10;
+      if (has_value(random_))
+        item.date_start = Date(2020, number(random_), number(random_));
+      if (has_value(random_))
+        item.date_finish = Date(2021, number(random_), number(random_));
+      if (has_value(random_))
+        item.enable_rewatching = number(random_) % 2 == 0;
+      if (has_value(random_))
+        item.rewatched_times = number(random_);
+      if (has_value(random_))
+        item.notes = std::to_wstring(number(random_));
+      queue.items.push_back(item);
+    }
+  }
+
+  static void ExpectSameAsScanning(Queue& queue) {
+    for (int anime_id = 1; anime_id <= kAnimeCount + 1; ++anime_id) {
+      for (const auto search_mode : kSearchModes) {
+        SCOPED_TRACE(::testing::Message()
+                     << "anime_id=" << anime_id
+                     << " search_mode=" << static_cast<int>(search_mode));
+
+        const auto expected = FindItemByScanning(queue, anime_id, search_mode);
+        EXPECT_EQ(queue.FindItem(anime_id, search_mode), expected);
+
+        const auto pending_change =
+            queue.FindPendingChange(anime_id, search_mode);
+        ASSERT_EQ(pending_change != nullptr, expected != nullptr);
+        if (expected) {
+          EXPECT_EQ(GetValue(*pending_change, search_mode),
+                    GetValue(*expected, search_mode));
+        }
+      }
+    }
+  }
+
+  std::mt19937 random_{2024};
+};
+
+TEST_F(QueueTest, IndexMatchesItems) {
+  Queue queue;
+  AddRandomItems(queue, 500);
+  queue.RebuildIndex();
+  ExpectSameAsScanning(queue);
+}
+
+TEST_F(QueueTest, IndexFollowsRemovedItems) {
+  Queue queue;
+  AddRandomItems(queue, 500);
+  queue.RebuildIndex();
+
+  std::uniform_int_distribution<int> index{0, 9};
+  while (!queue.items.empty()) {
+    const int i = std::min(index(random_),
+                           static_cast<int>(queue.items.size()) - 1);
+    queue.Remove(i, false, false, false);
+    if (queue.items.size() % 50 == 0)
+      ExpectSameAsScanning(queue);
+  }
+}
+
+TEST_F(QueueTest, IndexFollowsDisabledItems) {
+  Queue queue;
+  AddRandomItems(queue, 200);
+  queue.RebuildIndex();
+
+  for (size_t i = 0; i < queue.items.size(); i += 3) {
+    queue.items[i].enabled = false;
+  }
+  queue.RebuildIndex();
+  ExpectSameAsScanning(queue);
+
+  queue.RemoveDisabled(false, false);
+  ExpectSameAsScanning(queue);
+}
+
+}  // namespace library
@@ -0,0 +1,133 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "sync/api_server.h"
+
+#include <ws2tcpip.h>
+
+#include "base/format.h"
+
+namespace test {
+
+ApiServer::ApiServer(Handler handler) : handler_{std::move(handler)} {
+  WSADATA wsa_data;
+  ::WSAStartup(MAKEWORD(2, 2), &wsa_data);
+
+  socket_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+  // Port 0 lets the system pick a free port
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  ::bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  ::listen(socket_, SOMAXCONN);
+
+  int length = sizeof(address);
+  ::getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length);
+  port_ = ::ntohs(address.sin_port);
+
+  thread_ = std::thread([this]() { Accept(); });
+}
+
+ApiServer::~ApiServer() {
+  // Closing the socket makes `accept` fail, which ends the thread
+  ::closesocket(socket_);
+  if (thread_.joinable())
+    thread_.join();
+
+  {
+    std::lock_guard lock{workers_mutex_};
+    for (auto& worker : workers_) {
+      if (worker.joinable())
+        worker.join();
+    }
+  }
+
+  ::WSACleanup();
+}
+
+std::string ApiServer::url() const {
+  return "http://127.0.0.1:{}"_format(port_);
+}
+
+size_t ApiServer::max_active_requests() const {
+  return max_active_requests_;
+}
+
+size_t ApiServer::request_count() const {
+  return request_count_;
+}
+
+void ApiServer::Accept() {
+  while (true) {
+    const auto client = ::accept(socket_, nullptr, nullptr);
+    if (client == INVALID_SOCKET)
+      break;
+    std::lock_guard lock{workers_mutex_};
+    workers_.emplace_back([this, client]() { Serve(client); });
+  }
+}
+
+void ApiServer::Serve(SOCKET client) {
+  const auto active = ++active_requests_;
+  ++request_count_;
+  auto max_active = max_active_requests_.load();
+  while (active > max_active &&
+         !max_active_requests_.compare_exchange_weak(max_active, active)) {
+  }
+
+  // Only the request line is of interest, and the rest of the request is
+  // read until the empty line that ends the headers
+  std::string request;
+  char buffer[4096];
+  while (request.find("\r\n\r\n") == request.npos) {
+    const int length = ::recv(client, buffer, sizeof(buffer), 0);
+    if (length <= 0)
+      break;
+    request.append(buffer, length);
+  }
+
+  std::string target;
+  if (request.starts_with("GET ")) {
+    const auto end = request.find(' ', 4);
+    if (end != request.npos)
+      target = request.substr(4, end - 4);
+  }
+
+  const auto body = target.empty() ? std::string{} : handler_(target);
+  const auto status = target.empty() ? "400 Bad Request" : "200 OK";
+
+  const auto response =
+      "HTTP/1.1 {}\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: {}\r\n"
+      "Connection: close\r\n"
+      "\r\n"
+      "{}"_format(status, body.size(), body);
+  ::send(client, response.data(), static_cast<int>(response.size()), 0);
+
+  ::shutdown(client, SD_SEND);
+  ::closesocket(client);
+
+  --active_requests_;
+}
+
+}  // namespace test
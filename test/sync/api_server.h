@@ -0,0 +1,69 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <winsock2.h>
+
+namespace test {
+
+// A minimal HTTP server on the loopback interface, which stands in for the API
+// of a service. Each connection is served on its own thread, so that slow
+// responses do not hold back the others.
+class ApiServer final {
+public:
+  // Returns the body of the response to a GET request for the target
+  using Handler = std::function<std::string(const std::string& target)>;
+
+  explicit ApiServer(Handler handler);
+  ~ApiServer();
+
+  ApiServer(const ApiServer&) = delete;
+  ApiServer& operator=(const ApiServer&) = delete;
+
+  std::string url() const;
+
+  // Highest number of requests that were being served at the same time
+  size_t max_active_requests() const;
+  size_t request_count() const;
+
+private:
+  void Accept();
+  void Serve(SOCKET client);
+
+  Handler handler_;
+  SOCKET socket_ = INVALID_SOCKET;
+  unsigned short port_ = 0;
+
+  std::thread thread_;
+  std::vector<std::thread> workers_;
+  std::mutex workers_mutex_;
+
+  std::atomic<size_t> active_requests_ = 0;
+  std::atomic<size_t> max_active_requests_ = 0;
+  std::atomic<size_t> request_count_ = 0;
+};
+
+}  // namespace test
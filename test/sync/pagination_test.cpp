@@ -0,0 +1,287 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include "sync/pagination.h"
+
+#include "base/format.h"
+#include "base/json.h"
+#include "base/string.h"
+#include "sync/api_server.h"
+#include "taiga/http.h"
+
+namespace sync {
+
+static taiga::http::Response MakeResponse(const std::string& body) {
+  taiga::http::Response response;
+  response.set_status_code(hypp::status::k200_OK);
+  response.body() = body;
+  return response;
+}
+
+static std::vector<int> GetPageNumbers(
+    const std::vector<Pagination::Page>& pages) {
+  std::vector<int> numbers;
+  for (const auto& [page, response] : pages) {
+    numbers.push_back(page);
+  }
+  return numbers;
+}
+
+TEST(PaginationTest, HandsOutResponsesInOrder) {
+  Pagination pagination{4};
+  pagination.Add(0);
+  EXPECT_EQ(pagination.Next(), std::vector<int>({0}));
+  EXPECT_EQ(GetPageNumbers(pagination.Complete(0, MakeResponse("0"))),
+            std::vector<int>({0}));
+  EXPECT_TRUE(pagination.done());
+
+  pagination.Add(10);
+  pagination.Add(20);
+  pagination.Add(30);
+  EXPECT_FALSE(pagination.done());
+  EXPECT_EQ(pagination.Next(), std::vector<int>({10, 20, 30}));
+
+  EXPECT_TRUE(pagination.Complete(30, MakeResponse("30")).empty());
+  EXPECT_TRUE(pagination.Complete(20, MakeResponse("20")).empty());
+
+  const auto pages = pagination.Complete(10, MakeResponse("10"));
+  EXPECT_EQ(GetPageNumbers(pages), std::vector<int>({10, 20, 30}));
+  EXPECT_EQ(pages[1].second.body(), "20");
+  EXPECT_TRUE(pagination.done());
+}
+
+TEST(PaginationTest, LimitsConcurrentRequests) {
+  Pagination pagination{2};
+  for (int page = 0; page < 5; ++page) {
+    pagination.Add(page);
+  }
+
+  EXPECT_EQ(pagination.Next(), std::vector<int>({0, 1}));
+  EXPECT_TRUE(pagination.Next().empty());
+
+  pagination.Complete(1, MakeResponse("1"));
+  EXPECT_EQ(pagination.Next(), std::vector<int>({2}));
+
+  pagination.Complete(0, MakeResponse("0"));
+  pagination.Complete(2, MakeResponse("2"));
+  EXPECT_EQ(pagination.Next(), std::vector<int>({3, 4}));
+}
+
+TEST(PaginationTest, IgnoresKnownPages) {
+  Pagination pagination;
+  pagination.Add(0);
+  pagination.Add(0);
+  EXPECT_EQ(pagination.Next(), std::vector<int>({0}));
+  pagination.Complete(0, MakeResponse("0"));
+
+  // Every page tells us about the next one, including the ones before it
+  pagination.Add(0);
+  EXPECT_TRUE(pagination.Next().empty());
+  EXPECT_TRUE(pagination.done());
+
+  // Responses to pages that were never requested are not handed out
+  EXPECT_TRUE(pagination.Complete(10, MakeResponse("10")).empty());
+}
+
+TEST(PaginationTest, StopsAfterFailure) {
+  Pagination pagination;
+  pagination.Add(0);
+  pagination.Add(1);
+  pagination.Add(2);
+  EXPECT_EQ(pagination.Next().size(), 3u);
+
+  pagination.Fail();
+  EXPECT_TRUE(pagination.failed());
+  EXPECT_TRUE(pagination.Complete(0, MakeResponse("0")).empty());
+
+  pagination.Add(3);
+  EXPECT_TRUE(pagination.Next().empty());
+  EXPECT_TRUE(pagination.done());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Requests every page of a list from a stand-in API server, the same way the
+// services request the library pages of a user.
+class PaginatedRequestTest : public ::testing::Test {
+protected:
+  static constexpr int kPageSize = 10;
+  static constexpr int kItemCount = 95;
+
+  void SetUp() override {
+    WNDCLASS window_class{};
+    window_class.lpfnWndProc = WindowProc;
+    window_class.hInstance = ::GetModuleHandle(nullptr);
+    window_class.lpszClassName = L"TaigaPaginationTest";
+    ::RegisterClass(&window_class);
+
+    // Callbacks are processed on this thread, same as on the main thread of
+    // the application
+    window_ = ::CreateWindow(window_class.lpszClassName, nullptr, 0, 0, 0, 0,
+                             0, HWND_MESSAGE, nullptr,
+                             window_class.hInstance, nullptr);
+    taiga::http::SetWindowHandle(window_);
+    taiga::http::Init();
+  }
+
+  void TearDown() override {
+    taiga::http::Shutdown();
+    taiga::http::SetWindowHandle(nullptr);
+    ::DestroyWindow(window_);
+  }
+
+  static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam,
+                                     LPARAM lParam) {
+    if (msg == taiga::http::WM_HTTPCALLBACK) {
+      taiga::http::ProcessCallbacks();
+      return 0;
+    }
+    return ::DefWindowProc(hwnd, msg, wParam, lParam);
+  }
+
+  // Later pages are answered sooner, so that responses arrive out of order
+  static std::string HandleRequest(const std::string& target) {
+    const auto pos = target.find("offset=");
+    const int offset = pos != target.npos ? ToInt(target.substr(pos + 7)) : 0;
+
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds{(kItemCount - offset) * 2});
+
+    const int last = (kItemCount - 1) / kPageSize * kPageSize;
+
+    Json root = {{"offset", offset}, {"last", last}, {"data", Json::array()}};
+    for (int id = offset; id < offset + kPageSize && id < kItemCount; ++id) {
+      root["data"].push_back(id);
+    }
+    return root.dump();
+  }
+
+  struct State {
+    Pagination pagination{3};
+    std::vector<int> ids;
+  };
+
+  static void GetPages(const std::string& url, std::shared_ptr<State> state) {
+    for (const int page : state->pagination.Next()) {
+      taiga::http::Request request;
+      request.set_target("{}/anime?offset={}"_format(url, page));
+      request.set_header("Cache-Control", "no-store");
+
+      const auto on_response = [url, page,
+                                state](const taiga::http::Response& response) {
+        if (state->pagination.failed())
+          return;
+
+        if (response.error() || response.status_code() != 200) {
+          state->pagination.Fail();
+          return;
+        }
+
+        for (const auto& [page_number, page_response] :
+             state->pagination.Complete(page, response)) {
+          Json root;
+          if (!JsonParseString(page_response.body(), root)) {
+            state->pagination.Fail();
+            return;
+          }
+          for (const auto& id : root["data"]) {
+            state->ids.push_back(id.get<int>());
+          }
+          const int last = root["last"].get<int>();
+          for (int offset = page_number + kPageSize; offset <= last;
+               offset += kPageSize) {
+            state->pagination.Add(offset);
+          }
+        }
+
+        if (!state->pagination.done())
+          GetPages(url, state);
+      };
+
+      taiga::http::Send(request, nullptr, on_response);
+    }
+  }
+
+  static void WaitFor(const State& state) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds{30};
+
+    while (!state.pagination.done() && !state.pagination.failed() &&
+           std::chrono::steady_clock::now() < deadline) {
+      ::MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
+      MSG msg;
+      while (::PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+        ::TranslateMessage(&msg);
+        ::DispatchMessage(&msg);
+      }
+    }
+  }
+
+  HWND window_ = nullptr;
+};
+
+TEST_F(PaginatedRequestTest, MergesPagesInOrder) {
+  test::ApiServer server{HandleRequest};
+
+  auto state = std::make_shared<State>();
+  state->pagination.Add(0);
+  GetPages(server.url(), state);
+  WaitFor(*state);
+
+  ASSERT_TRUE(state->pagination.done());
+  EXPECT_FALSE(state->pagination.failed());
+
+  std::vector<int> expected_ids;
+  for (int id = 0; id < kItemCount; ++id) {
+    expected_ids.push_back(id);
+  }
+  EXPECT_EQ(state->ids, expected_ids);
+
+  EXPECT_EQ(server.request_count(),
+            static_cast<size_t>((kItemCount + kPageSize - 1) / kPageSize));
+  EXPECT_GT(server.max_active_requests(), 1u);
+  EXPECT_LE(server.max_active_requests(), 3u);
+}
+
+TEST_F(PaginatedRequestTest, StopsAfterFailedPage) {
+  test::ApiServer server{[](const std::string& target) -> std::string {
+    // Every page but the first one is malformed
+    if (target.ends_with("offset=0"))
+      return HandleRequest(target);
+    return "{";
+  }};
+
+  auto state = std::make_shared<State>();
+  state->pagination.Add(0);
+  GetPages(server.url(), state);
+  WaitFor(*state);
+
+  EXPECT_TRUE(state->pagination.failed());
+  EXPECT_EQ(state->ids.size(), static_cast<size_t>(kPageSize));
+}
+
+}  // namespace sync
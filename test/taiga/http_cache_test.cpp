@@ -0,0 +1,229 @@
+/**
+ * Taiga
+ * Copyright (C) 2010-2024, Eren Okka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "taiga/http_cache.h"
+
+#include "base/file.h"
+
+namespace taiga::http::detail {
+
+class HttpCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() / L"taiga_http_cache_test";
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(path_);
+  }
+
+  std::wstring GetPath() const {
+    return path_.wstring() + L"\\";
+  }
+
+  static Request MakeRequest(const std::string& url) {
+    Request request;
+    request.set_target(url);
+    return request;
+  }
+
+  static Response MakeResponse(const std::string& body,
+                               const std::string& cache_control) {
+    Response response;
+    response.set_status_code(hypp::status::k200_OK);
+    response.set_header("cache-control", cache_control);
+    response.body() = body;
+    return response;
+  }
+
+  std::filesystem::path path_;
+};
+
+TEST_F(HttpCacheTest, ServesFreshResponses) {
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  const auto request = MakeRequest("https://example.com/anime/1");
+  const auto response = MakeResponse("anime", "max-age=60");
+  cache.Put(request, response, response.body());
+
+  const auto cached_response = cache.GetFresh(request);
+  ASSERT_TRUE(cached_response.has_value());
+  EXPECT_EQ(cached_response->status_code(), hypp::status::k200_OK);
+  EXPECT_EQ(cached_response->body(), "anime");
+
+  EXPECT_FALSE(cache.GetFresh(MakeRequest("https://example.com/anime/2")));
+}
+
+TEST_F(HttpCacheTest, SkipsResponsesWithoutFreshnessOrValidators) {
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  const auto request = MakeRequest("https://example.com/anime/1");
+  const auto response = MakeResponse("anime", "");
+  EXPECT_FALSE(cache.IsStorable(response));
+
+  cache.Put(request, response, response.body());
+  EXPECT_FALSE(cache.GetFresh(request));
+  auto conditional_request = request;
+  EXPECT_FALSE(cache.AddValidators(conditional_request));
+}
+
+TEST_F(HttpCacheTest, EvictsLeastRecentlyUsedEntries) {
+  Cache cache{GetPath(), 10};
+  cache.Load();
+
+  const auto request_a = MakeRequest("https://example.com/a");
+  const auto request_b = MakeRequest("https://example.com/b");
+  const auto request_c = MakeRequest("https://example.com/c");
+
+  cache.Put(request_a, MakeResponse("aaaa", "max-age=60"), "aaaa");
+  cache.Put(request_b, MakeResponse("bbbb", "max-age=60"), "bbbb");
+
+  // Using A makes B the least recently used entry
+  ASSERT_TRUE(cache.GetFresh(request_a));
+
+  cache.Put(request_c, MakeResponse("cccc", "max-age=60"), "cccc");
+
+  EXPECT_TRUE(cache.GetFresh(request_a));
+  EXPECT_FALSE(cache.GetFresh(request_b));
+  EXPECT_TRUE(cache.GetFresh(request_c));
+}
+
+TEST_F(HttpCacheTest, StoresIdenticalBodiesOnce) {
+  Cache cache{GetPath(), 10};
+  cache.Load();
+
+  const auto request_a = MakeRequest("https://example.com/a");
+  const auto request_b = MakeRequest("https://example.com/b");
+  const auto request_c = MakeRequest("https://example.com/c");
+
+  // Both entries share a single body, so that the third one still fits
+  cache.Put(request_a, MakeResponse("same", "max-age=60"), "same");
+  cache.Put(request_b, MakeResponse("same", "max-age=60"), "same");
+  cache.Put(request_c, MakeResponse("cccc", "max-age=60"), "cccc");
+
+  EXPECT_TRUE(cache.GetFresh(request_a));
+  EXPECT_TRUE(cache.GetFresh(request_b));
+  EXPECT_TRUE(cache.GetFresh(request_c));
+
+  size_t file_count = 0;
+  for (const auto& entry : std::filesystem::directory_iterator{path_}) {
+    if (entry.path().filename() != L"cache.xml")
+      ++file_count;
+  }
+  EXPECT_EQ(file_count, 2);
+}
+
+TEST_F(HttpCacheTest, RevalidatesStaleResponses) {
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  const auto request = MakeRequest("https://example.com/anime/1");
+  auto response = MakeResponse("anime", "no-cache");
+  response.set_header("etag", "\"v1\"");
+  cache.Put(request, response, response.body());
+
+  EXPECT_FALSE(cache.GetFresh(request));
+
+  auto conditional_request = request;
+  ASSERT_TRUE(cache.AddValidators(conditional_request));
+  EXPECT_EQ(conditional_request.header("if-none-match"), "\"v1\"");
+
+  Response not_modified;
+  not_modified.set_status_code(hypp::status::k304_Not_Modified);
+  not_modified.set_header("etag", "\"v2\"");
+
+  const auto cached_response = cache.Revalidate(request, not_modified);
+  ASSERT_TRUE(cached_response.has_value());
+  EXPECT_EQ(cached_response->body(), "anime");
+  EXPECT_EQ(cached_response->header("etag"), "\"v2\"");
+}
+
+TEST_F(HttpCacheTest, KeepsAccountsApart) {
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  auto request = MakeRequest("https://example.com/library");
+  request.set_header("Authorization", "Bearer first");
+  auto response = MakeResponse("first", "max-age=60");
+  response.set_header("etag", "\"first\"");
+  cache.Put(request, response, response.body());
+
+  // Entries of authenticated requests are never served without revalidation
+  EXPECT_FALSE(cache.GetFresh(request));
+
+  auto conditional_request = request;
+  EXPECT_TRUE(cache.AddValidators(conditional_request));
+
+  auto other_request = MakeRequest("https://example.com/library");
+  other_request.set_header("Authorization", "Bearer second");
+  EXPECT_FALSE(cache.AddValidators(other_request));
+
+  auto anonymous_request = MakeRequest("https://example.com/library");
+  EXPECT_FALSE(cache.AddValidators(anonymous_request));
+}
+
+TEST_F(HttpCacheTest, StoresStreamedBodies) {
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  const auto request = MakeRequest("https://example.com/image.jpg");
+  const auto response = MakeResponse("", "max-age=60");
+
+  const auto temp_path = cache.CreateTempBodyPath();
+  ASSERT_TRUE(SaveToFile(std::string{"image"}, temp_path));
+
+  ContentHash hash;
+  hash.Update("ima");
+  hash.Update("ge");
+  cache.PutFile(request, response, temp_path, hash.str(), 5);
+
+  EXPECT_FALSE(std::filesystem::exists(temp_path));
+
+  const auto cached_response = cache.GetFresh(request);
+  ASSERT_TRUE(cached_response.has_value());
+  EXPECT_EQ(cached_response->body(), "image");
+}
+
+TEST_F(HttpCacheTest, PersistsEntries) {
+  const auto request = MakeRequest("https://example.com/anime/1");
+
+  {
+    Cache cache{GetPath(), 1024};
+    cache.Load();
+    cache.Put(request, MakeResponse("anime", "max-age=60"), "anime");
+    ASSERT_TRUE(cache.Save());
+  }
+
+  Cache cache{GetPath(), 1024};
+  cache.Load();
+
+  const auto cached_response = cache.GetFresh(request);
+  ASSERT_TRUE(cached_response.has_value());
+  EXPECT_EQ(cached_response->body(), "anime");
+}
+
+}  // namespace taiga::http::detail